@@ -3,6 +3,7 @@
 #include "ofxNatNet.h"
 
 ofxNatNet natnet;
+ofxNatNetPoseDrawer drawer;
 ofEasyCam cam;
 
 //--------------------------------------------------------------
@@ -30,68 +31,26 @@ void testApp::draw() {
 	
 	ofDrawAxis(100);
 
-	ofFill();
+	// one instanced draw call per section, see ofxNatNetPoseDrawer
+	const ofxNatNet::PoseBuffer& poses = natnet.getPoseBuffer();
+	drawer.update(poses);
 
-	// draw all markers set
-	ofSetColor(255, 128);
-	for (int i = 0; i < max(0, (int)natnet.getNumMarkersSet() - 1); i++) {
-		for (int j = 0; j < natnet.getMarkersSetAt(i).size(); j++) {
-			ofDrawBox(natnet.getMarkersSetAt(i)[j], 3);
-		}
-	}
-	
 	// draw all markers
 	ofSetColor(255, 30);
-	for (int i = 0; i < natnet.getNumMarker(); i++) {
-		ofDrawBox(natnet.getMarker(i), 3);
-	}
-
-	ofNoFill();
+	drawer.drawMarkers(0, poses.num_markers, 3);
 
 	// draw filtered markers
 	ofSetColor(255);
-	for (int i = 0; i < natnet.getNumFilterdMarker(); i++) {
-		ofDrawBox(natnet.getFilterdMarker(i), 10);
-	}
-
-	// draw rigidbodies
-	for (int i = 0; i < natnet.getNumRigidBody(); i++) {
-		const ofxNatNet::RigidBody &RB = natnet.getRigidBodyAt(i);
-
-		if (RB.isActive())
-			ofSetColor(0, 255, 0);
-		else
-			ofSetColor(255, 0, 0);
-
-		ofPushMatrix();
-		glMultMatrixf(RB.getMatrix().getPtr());
-		ofDrawAxis(30);
-		ofPopMatrix();
-
-		glBegin(GL_LINE_LOOP);
-		for (int n = 0; n < RB.markers.size(); n++) {
-			glVertex3fv(RB.markers[n].getPtr());
-		}
-		glEnd();
-
-		for (int n = 0; n < RB.markers.size(); n++) {
-			ofDrawBox(RB.markers[n], 5);
-		}
-	}
-	
+	drawer.drawMarkers(poses.num_markers, poses.num_filterd_markers, 6);
+
+	// draw rigidbodies, untracked ones dimmed
+	ofSetColor(0, 255, 0);
+	drawer.drawMarkers(poses.num_markers + poses.num_filterd_markers, poses.num_rigidbody_markers, 5);
+	drawer.drawAxes(0, poses.num_rigidbodies, 30);
+
 	// draw skeletons
-	for (int j = 0;  j < natnet.getNumSkeleton(); j++) {
-		const ofxNatNet::Skeleton &S = natnet.getSkeletonAt(j);
-		ofSetColor(0, 0, 255);
-		
-		for (int i = 0; i < S.joints.size(); i++) {
-			const ofxNatNet::RigidBody &RB = S.joints[i];
-			ofPushMatrix();
-			glMultMatrixf(RB.getMatrix().getPtr());
-			ofDrawBox(5);
-			ofPopMatrix();
-		}
-	}
+	ofSetColor(0, 0, 255);
+	drawer.drawBoxes(poses.num_rigidbodies, poses.num_joints, 5);
 
 	cam.end();
 
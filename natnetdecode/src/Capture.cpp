@@ -0,0 +1,241 @@
+#include "Capture.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <map>
+
+static inline uint16_t be16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+
+static inline uint32_t readU32(const uint8_t* p, bool swap)
+{
+	uint32_t v;
+	memcpy(&v, p, 4);
+	if (swap) v = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+	return v;
+}
+
+bool Capture::load(const std::string& path, int data_port, int command_port)
+{
+	datagrams.clear();
+	reassembled.clear();
+	error.clear();
+
+	FILE* fp = fopen(path.c_str(), "rb");
+	if (fp == NULL)
+	{
+		error = "can't open " + path;
+		return false;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	file.resize(size > 0 ? size : 0);
+	bool ok = file.empty() || fread(file.data(), file.size(), 1, fp) == 1;
+	fclose(fp);
+
+	if (!ok)
+	{
+		error = "can't read " + path;
+		return false;
+	}
+
+	if (file.size() >= 24)
+	{
+		uint32_t magic = readU32(file.data(), false);
+		if (magic == 0xa1b2c3d4 || magic == 0xd4c3b2a1
+			|| magic == 0xa1b23c4d || magic == 0x4d3cb2a1)
+			return loadPcap(data_port, command_port);
+	}
+
+	return loadRaw();
+}
+
+bool Capture::loadRaw()
+{
+	size_t offset = 0;
+
+	while (offset + 4 <= file.size())
+	{
+		uint32_t size = readU32(&file[offset], false);
+		offset += 4;
+
+		if (size > file.size() - offset)
+		{
+			error = "truncated raw capture";
+			return false;
+		}
+
+		Datagram d = { &file[offset], size, 0 };
+		datagrams.push_back(d);
+		offset += size;
+	}
+
+	return true;
+}
+
+namespace
+{
+	struct FragmentKey
+	{
+		uint32_t src, dst;
+		uint16_t id;
+
+		bool operator<(const FragmentKey& o) const
+		{
+			if (src != o.src) return src < o.src;
+			if (dst != o.dst) return dst < o.dst;
+			return id < o.id;
+		}
+	};
+
+	struct Fragments
+	{
+		std::vector<uint8_t> payload;
+		std::vector<char> received;  // per 8-byte unit
+		size_t total;  // 0 until the last fragment arrived
+		double time;
+
+		Fragments()
+			: total(0)
+			, time(0)
+		{
+		}
+
+		bool complete() const
+		{
+			if (total == 0) return false;
+			for (size_t i = 0; i < (total + 7) / 8; i++)
+				if (!received[i]) return false;
+			return true;
+		}
+	};
+}
+
+bool Capture::loadPcap(int data_port, int command_port)
+{
+	const uint8_t* p = file.data();
+	uint32_t magic = readU32(p, false);
+
+	const bool swap = magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1;
+	const bool nano = magic == 0xa1b23c4d || magic == 0x4d3cb2a1;
+	const uint32_t linktype = readU32(p + 20, swap) & 0xffff;
+
+	std::map<FragmentKey, Fragments> fragments;
+
+	size_t offset = 24;
+	while (offset + 16 <= file.size())
+	{
+		const uint8_t* rec = &file[offset];
+		uint32_t ts_sec = readU32(rec, swap);
+		uint32_t ts_frac = readU32(rec + 4, swap);
+		uint32_t incl_len = readU32(rec + 8, swap);
+		offset += 16;
+
+		if (incl_len > file.size() - offset) break;
+
+		const uint8_t* pkt = &file[offset];
+		const uint8_t* end = pkt + incl_len;
+		offset += incl_len;
+
+		double time = ts_sec + ts_frac * (nano ? 1e-9 : 1e-6);
+
+		// link layer
+		uint16_t ethertype = 0x0800;
+		switch (linktype)
+		{
+			case 0:  // BSD loopback
+				if (end - pkt < 4) continue;
+				pkt += 4;
+				break;
+			case 1:  // Ethernet
+				if (end - pkt < 14) continue;
+				ethertype = be16(pkt + 12);
+				pkt += 14;
+				while (ethertype == 0x8100 && end - pkt >= 4)
+				{
+					ethertype = be16(pkt + 2);
+					pkt += 4;
+				}
+				break;
+			case 12:
+			case 101:  // raw IP
+				break;
+			case 113:  // Linux cooked
+				if (end - pkt < 16) continue;
+				ethertype = be16(pkt + 14);
+				pkt += 16;
+				break;
+			case 276:  // Linux cooked v2
+				if (end - pkt < 20) continue;
+				ethertype = be16(pkt);
+				pkt += 20;
+				break;
+			default:
+				error = "unsupported pcap link type";
+				return false;
+		}
+
+		if (ethertype != 0x0800 || end - pkt < 20 || (pkt[0] >> 4) != 4) continue;
+
+		// IPv4
+		size_t ihl = (pkt[0] & 0x0f) * 4;
+		size_t total = be16(pkt + 2);
+		if (ihl < 20 || total < ihl || total > (size_t)(end - pkt) || pkt[9] != 17) continue;
+
+		uint16_t frag = be16(pkt + 6);
+		bool more = frag & 0x2000;
+		size_t frag_offset = (frag & 0x1fff) * 8;
+
+		const uint8_t* udp = pkt + ihl;
+		size_t udp_size = total - ihl;
+
+		if (more || frag_offset)
+		{
+			FragmentKey key;
+			memcpy(&key.src, pkt + 12, 4);
+			memcpy(&key.dst, pkt + 16, 4);
+			key.id = be16(pkt + 4);
+
+			Fragments& f = fragments[key];
+			if (frag_offset + udp_size > 0xffff) continue;
+			if (f.payload.size() < frag_offset + udp_size)
+			{
+				f.payload.resize(frag_offset + udp_size);
+				f.received.resize((f.payload.size() + 7) / 8, 0);
+			}
+			memcpy(&f.payload[frag_offset], udp, udp_size);
+			for (size_t i = frag_offset / 8; i < (frag_offset + udp_size + 7) / 8; i++)
+				f.received[i] = 1;
+			if (!more) f.total = frag_offset + udp_size;
+			if (frag_offset == 0) f.time = time;
+
+			if (!f.complete()) continue;
+
+			f.payload.resize(f.total);
+			reassembled.push_back(std::vector<uint8_t>());
+			reassembled.back().swap(f.payload);
+			time = f.time;
+			fragments.erase(key);
+
+			udp = reassembled.back().data();
+			udp_size = reassembled.back().size();
+		}
+
+		// UDP
+		if (udp_size < 8) continue;
+		int src_port = be16(udp);
+		int dst_port = be16(udp + 2);
+		size_t length = be16(udp + 4);
+		if (length < 8 || length > udp_size) continue;
+
+		if (dst_port != data_port && src_port != command_port) continue;
+
+		Datagram d = { udp + 8, length - 8, time };
+		datagrams.push_back(d);
+	}
+
+	return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+// NatNet datagrams extracted from a capture file.
+//
+// two formats are understood:
+//  - pcap (libpcap, micro- or nanosecond, either byte order) with
+//    Ethernet, raw IP, BSD loopback or Linux cooked link layers. IPv4
+//    fragments are reassembled; UDP datagrams to data_port or from
+//    command_port are kept.
+//  - raw: a sequence of { uint32_t size; uint8_t data[size]; } records,
+//    little-endian, one NatNet packet each.
+
+class Capture
+{
+public:
+	struct Datagram
+	{
+		const uint8_t* data;
+		size_t size;
+		double time;  // capture time in seconds, 0 for raw captures
+	};
+
+	std::vector<Datagram> datagrams;
+
+	bool load(const std::string& path, int data_port, int command_port);
+
+	inline const std::string& getError() const { return error; }
+
+private:
+	std::vector<uint8_t> file;
+	std::deque<std::vector<uint8_t> > reassembled;
+	std::string error;
+
+	bool loadPcap(int data_port, int command_port);
+	bool loadRaw();
+};
@@ -0,0 +1,444 @@
+// natnetdecode: batch decoder for captured NatNet traffic
+//
+// usage: natnetdecode [options] <capture> <output dir>
+//
+//   -f csv|bin    output format (default csv)
+//   -j N          decoder threads (default: number of cores)
+//   -v MAJ.MIN    NatNet version if the capture has no ping response (default 2.9)
+//   -s SCALE      scale applied to positions (default 1)
+//   -p PORT       data port for pcap captures (default 1511)
+//   -c PORT       command port for pcap captures (default 1510)
+//   -d LIST       sections to decode, comma separated: markersets, unlabeled,
+//                 rbmarkers, skeletons, labeled (default all)
+//   -r IDS        rigid body ids to decode, comma separated (default all)
+//   -k IDS        skeleton ids to decode, comma separated (default all)
+//
+// one output per entity:
+//   rigidbody_<id>                  x y z qx qy qz qw mean_marker_error active
+//   skeleton_<id>_joint_<joint id>  x y z qx qy qz qw
+//   markers                         index x y z (one row per marker)
+// each row is also tagged with the frame number and server timestamp.
+// csv writes <name>.csv; bin writes <name>.frame.i32, <name>.time.f64
+// and <name>.values.f32 (row-major floats). manifest.csv lists all of
+// them, descriptions.csv the names from the model definitions.
+//
+// frame packets are split into contiguous chunks, one NatNet::Client
+// offline decoder per thread, and merged in capture order. only the
+// openFrameworks-free core is used; build with the top-level CMakeLists.txt.
+
+#include "natnet/Client.h"
+
+#include "Capture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+struct Columns
+{
+	size_t stride;
+	vector<int32_t> frame;
+	vector<double> time;
+	vector<float> values;
+
+	Columns()
+		: stride(0)
+	{
+	}
+
+	float* addRow(int frame_number, double timestamp)
+	{
+		frame.push_back(frame_number);
+		time.push_back(timestamp);
+		values.resize(values.size() + stride);
+		return &values[values.size() - stride];
+	}
+
+	void append(const Columns& o)
+	{
+		stride = o.stride;
+		frame.insert(frame.end(), o.frame.begin(), o.frame.end());
+		time.insert(time.end(), o.time.begin(), o.time.end());
+		values.insert(values.end(), o.values.begin(), o.values.end());
+	}
+};
+
+static const char* RIGIDBODY_COLUMNS = "x,y,z,qx,qy,qz,qw,mean_marker_error,active";
+static const char* JOINT_COLUMNS = "x,y,z,qx,qy,qz,qw";
+static const char* MARKER_COLUMNS = "index,x,y,z";
+
+static void writePose(float* dst, const NatNet::RigidBody& RB)
+{
+	const NatNet::Vec3& p = RB.position;
+	const NatNet::Quat& q = RB.orientation;
+	dst[0] = p.x;
+	dst[1] = p.y;
+	dst[2] = p.z;
+	dst[3] = q.x;
+	dst[4] = q.y;
+	dst[5] = q.z;
+	dst[6] = q.w;
+}
+
+class Worker
+{
+public:
+	map<string, Columns> columns;
+	size_t num_frames;
+
+	Worker()
+		: num_frames(0)
+	{
+	}
+
+	void run(const Capture& capture, const vector<size_t>& packets,
+			 int major, int minor, float scale, const NatNet::Subscription& subscription)
+	{
+		NatNet::Client client;
+		client.setFrameCallback([this](const NatNet::Frame& frame) { onFrame(frame); });
+		client.setupOffline(major, minor);
+		client.setTransform(NatNet::makeScaleMatrix(scale, scale, scale));
+		client.setSubscription(subscription);
+
+		for (size_t i = 0; i < packets.size(); i++)
+		{
+			const Capture::Datagram& d = capture.datagrams[packets[i]];
+			client.decodePacket(d.data, d.size);
+		}
+	}
+
+	void onFrame(const NatNet::Frame& frame)
+	{
+		num_frames++;
+
+		for (size_t i = 0; i < frame.rigidbodies.size(); i++)
+		{
+			const NatNet::RigidBody& RB = frame.rigidbodies[i];
+			float* row = get("rigidbody_" + to_string(RB.id), 9)
+							 .addRow(frame.frame_number, frame.timestamp);
+			writePose(row, RB);
+			row[7] = RB.mean_marker_error;
+			row[8] = RB.active ? 1 : 0;
+		}
+
+		for (size_t i = 0; i < frame.skeletons.size(); i++)
+		{
+			const NatNet::Skeleton& S = frame.skeletons[i];
+			for (size_t j = 0; j < S.joints.size(); j++)
+			{
+				const NatNet::RigidBody& RB = S.joints[j];
+				string name = "skeleton_" + to_string(S.id) + "_joint_" + to_string(RB.id & 0xffff);
+				writePose(get(name, 7).addRow(frame.frame_number, frame.timestamp), RB);
+			}
+		}
+
+		Columns& markers = get("markers", 4);
+		for (size_t i = 0; i < frame.markers.size(); i++)
+		{
+			float* row = markers.addRow(frame.frame_number, frame.timestamp);
+			row[0] = i;
+			row[1] = frame.markers[i].x;
+			row[2] = frame.markers[i].y;
+			row[3] = frame.markers[i].z;
+		}
+	}
+
+private:
+	Columns& get(const string& name, size_t stride)
+	{
+		map<string, Columns>::iterator it = columns.find(name);
+		if (it == columns.end())
+		{
+			it = columns.insert(make_pair(name, Columns())).first;
+			it->second.stride = stride;
+		}
+		return it->second;
+	}
+};
+
+static const char* columnNames(const string& name)
+{
+	if (name == "markers") return MARKER_COLUMNS;
+	if (name.compare(0, 9, "skeleton_") == 0) return JOINT_COLUMNS;
+	return RIGIDBODY_COLUMNS;
+}
+
+static bool writeCsv(const string& path, const Columns& c, const char* names)
+{
+	FILE* fp = fopen(path.c_str(), "w");
+	if (fp == NULL) return false;
+
+	fprintf(fp, "frame,timestamp,%s\n", names);
+	for (size_t i = 0; i < c.frame.size(); i++)
+	{
+		fprintf(fp, "%d,%.6f", c.frame[i], c.time[i]);
+		for (size_t k = 0; k < c.stride; k++) fprintf(fp, ",%.9g", c.values[i * c.stride + k]);
+		fputc('\n', fp);
+	}
+
+	fclose(fp);
+	return true;
+}
+
+template <typename T>
+static bool writeArray(const string& path, const vector<T>& v)
+{
+	FILE* fp = fopen(path.c_str(), "wb");
+	if (fp == NULL) return false;
+	bool ok = v.empty() || fwrite(v.data(), sizeof(T), v.size(), fp) == v.size();
+	fclose(fp);
+	return ok;
+}
+
+static int usage()
+{
+	fprintf(stderr,
+			"usage: natnetdecode [-f csv|bin] [-j threads] [-v major.minor] [-s scale]\n"
+			"                    [-p data port] [-c command port] [-d sections]\n"
+			"                    [-r rigid body ids] [-k skeleton ids] <capture> <output dir>\n");
+	return 1;
+}
+
+static vector<string> split(const string& str)
+{
+	vector<string> items;
+	size_t begin = 0;
+	while (begin <= str.size())
+	{
+		size_t end = str.find(',', begin);
+		if (end == string::npos) end = str.size();
+		if (end > begin) items.push_back(str.substr(begin, end - begin));
+		begin = end + 1;
+	}
+	return items;
+}
+
+static bool parseSections(const string& str, unsigned int& sections)
+{
+	static const struct
+	{
+		const char* name;
+		unsigned int section;
+	} names[] = {
+		{ "markersets", NatNet::DECODE_MARKERSETS },
+		{ "unlabeled", NatNet::DECODE_UNLABELED_MARKERS },
+		{ "rbmarkers", NatNet::DECODE_RIGIDBODY_MARKERS },
+		{ "skeletons", NatNet::DECODE_SKELETONS },
+		{ "labeled", NatNet::DECODE_LABELED_MARKERS },
+	};
+
+	sections = 0;
+
+	vector<string> items = split(str);
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		size_t k = 0;
+		while (k < sizeof(names) / sizeof(names[0]) && items[i] != names[k].name) k++;
+		if (k == sizeof(names) / sizeof(names[0])) return false;
+		sections |= names[k].section;
+	}
+	return true;
+}
+
+static vector<int> parseIds(const string& str)
+{
+	vector<int> ids;
+	vector<string> items = split(str);
+	for (size_t i = 0; i < items.size(); i++) ids.push_back(atoi(items[i].c_str()));
+	return ids;
+}
+
+int main(int argc, char* argv[])
+{
+	string format = "csv";
+	int num_threads = std::thread::hardware_concurrency();
+	int major = 2, minor = 9;
+	float scale = 1;
+	int data_port = 1511, command_port = 1510;
+	NatNet::Subscription subscription;
+
+	vector<string> args;
+	for (int i = 1; i < argc; i++)
+	{
+		string a = argv[i];
+		bool has_value = i + 1 < argc;
+
+		if (a == "-f" && has_value) format = argv[++i];
+		else if (a == "-j" && has_value) num_threads = atoi(argv[++i]);
+		else if (a == "-v" && has_value) sscanf(argv[++i], "%d.%d", &major, &minor);
+		else if (a == "-s" && has_value) scale = atof(argv[++i]);
+		else if (a == "-p" && has_value) data_port = atoi(argv[++i]);
+		else if (a == "-c" && has_value) command_port = atoi(argv[++i]);
+		else if (a == "-d" && has_value)
+		{
+			if (!parseSections(argv[++i], subscription.sections)) return usage();
+		}
+		else if (a == "-r" && has_value) subscription.rigidbody_ids = parseIds(argv[++i]);
+		else if (a == "-k" && has_value) subscription.skeleton_ids = parseIds(argv[++i]);
+		else if (a.size() && a[0] == '-') return usage();
+		else args.push_back(a);
+	}
+
+	if (args.size() != 2 || (format != "csv" && format != "bin")) return usage();
+	if (num_threads < 1) num_threads = 1;
+
+	const string output_dir = args[1];
+#if defined(_WIN32)
+	_mkdir(output_dir.c_str());
+#else
+	mkdir(output_dir.c_str(), 0755);
+#endif
+
+	Capture capture;
+	if (!capture.load(args[0], data_port, command_port))
+	{
+		fprintf(stderr, "%s\n", capture.getError().c_str());
+		return 1;
+	}
+
+	// NatNet version from the first ping response, if any
+	// (sSender: name[256], Version[4], NatNetVersion[4])
+	for (size_t i = 0; i < capture.datagrams.size(); i++)
+	{
+		const Capture::Datagram& d = capture.datagrams[i];
+		if (d.size >= 4 + 256 + 8 && d.data[0] == 1 && d.data[1] == 0)
+		{
+			major = d.data[4 + 256 + 4];
+			minor = d.data[4 + 256 + 5];
+			break;
+		}
+	}
+
+	// frame packets go to the workers, model definitions are decoded here
+	NatNet::Client descriptions;
+	descriptions.setupOffline(major, minor);
+
+	vector<size_t> frames;
+	for (size_t i = 0; i < capture.datagrams.size(); i++)
+	{
+		const Capture::Datagram& d = capture.datagrams[i];
+		if (d.size < 4) continue;
+
+		uint16_t message = d.data[0] | (d.data[1] << 8);
+		if (message == 7) frames.push_back(i);
+		else if (message == 5) descriptions.decodePacket(d.data, d.size);
+	}
+
+	printf("%zu datagrams, %zu frames, NatNet %d.%d, %d threads\n",
+		   capture.datagrams.size(), frames.size(), major, minor, num_threads);
+
+	// decode
+	vector<Worker> workers(num_threads);
+	vector<vector<size_t> > chunks(num_threads);
+	for (int t = 0; t < num_threads; t++)
+	{
+		size_t begin = frames.size() * t / num_threads;
+		size_t end = frames.size() * (t + 1) / num_threads;
+		chunks[t].assign(frames.begin() + begin, frames.begin() + end);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	vector<std::thread> threads;
+	for (int t = 0; t < num_threads; t++)
+	{
+		threads.push_back(std::thread(&Worker::run, &workers[t], std::cref(capture),
+									  std::cref(chunks[t]), major, minor, scale, std::cref(subscription)));
+	}
+	for (int t = 0; t < num_threads; t++) threads[t].join();
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	size_t num_frames = 0;
+	for (int t = 0; t < num_threads; t++) num_frames += workers[t].num_frames;
+
+	printf("decoded %zu frames in %.3f s: %.0f frames/s, %.0f frames/s/core\n",
+		   num_frames, elapsed, num_frames / elapsed, num_frames / elapsed / num_threads);
+
+	// merge in capture order
+	map<string, Columns> merged;
+	for (int t = 0; t < num_threads; t++)
+	{
+		map<string, Columns>::iterator it = workers[t].columns.begin();
+		while (it != workers[t].columns.end())
+		{
+			merged[it->first].append(it->second);
+			it++;
+		}
+		workers[t].columns.clear();
+	}
+
+	// write
+	FILE* manifest = fopen((output_dir + "/manifest.csv").c_str(), "w");
+	if (manifest) fprintf(manifest, "name,rows,stride,columns\n");
+
+	map<string, Columns>::iterator it = merged.begin();
+	while (it != merged.end())
+	{
+		const string base = output_dir + "/" + it->first;
+		const Columns& c = it->second;
+		const char* names = columnNames(it->first);
+
+		bool ok;
+		if (format == "csv")
+		{
+			ok = writeCsv(base + ".csv", c, names);
+		}
+		else
+		{
+			ok = writeArray(base + ".frame.i32", c.frame)
+				&& writeArray(base + ".time.f64", c.time)
+				&& writeArray(base + ".values.f32", c.values);
+		}
+
+		if (!ok) fprintf(stderr, "failed to write %s\n", base.c_str());
+		if (manifest)
+			fprintf(manifest, "%s,%zu,%zu,\"%s\"\n", it->first.c_str(), c.frame.size(), c.stride, names);
+
+		it++;
+	}
+
+	if (manifest) fclose(manifest);
+
+	FILE* fp = fopen((output_dir + "/descriptions.csv").c_str(), "w");
+	if (fp)
+	{
+		fprintf(fp, "type,id,name\n");
+
+		descriptions.lock();
+		const NatNet::Descriptions& descs = descriptions.getState().descriptions;
+
+		const vector<NatNet::MarkerSetDescription>& ms = descs.markersets;
+		for (size_t i = 0; i < ms.size(); i++) fprintf(fp, "markerset,,%s\n", ms[i].name.c_str());
+
+		const vector<NatNet::RigidBodyDescription>& rb = descs.rigidbodies;
+		for (size_t i = 0; i < rb.size(); i++) fprintf(fp, "rigidbody,%d,%s\n", rb[i].id, rb[i].name.c_str());
+
+		const vector<NatNet::SkeletonDescription>& sk = descs.skeletons;
+		for (size_t i = 0; i < sk.size(); i++)
+		{
+			fprintf(fp, "skeleton,%d,%s\n", sk[i].id, sk[i].name.c_str());
+			for (size_t j = 0; j < sk[i].joints.size(); j++)
+				fprintf(fp, "joint,%d,%s\n", sk[i].joints[j].id, sk[i].joints[j].name.c_str());
+		}
+
+		descriptions.unlock();
+
+		fclose(fp);
+	}
+
+	return 0;
+}
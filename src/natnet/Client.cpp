@@ -0,0 +1,1358 @@
+#include "Client.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include "Log.h"
+#include "Thread.h"
+#include "../ofxNatNetCompactFrame.h"
+
+using namespace std;
+
+namespace NatNet
+{
+	Client::Client()
+		: connected(false)
+		, running(false)
+		, wait_mode(WAIT_SLEEP)
+		, spin_usec(200)
+		, receiver_cpu(-1)
+		, receiver_priority(0)
+		, busy_poll_usec(0)
+		, thread_settings_version(0)
+		, thread_settings_applied(-1)
+		, subscription_version(0)
+		, subscription_applied(0)
+		, config(make_shared<DecodeConfig>())
+		, config_version(0)
+		, config_applied(0)
+		, server_clock_frequency(0)
+		, protocol_version(0)
+		, protocol_applied(0)
+		, parallel_threads(0)
+		, parallel_min_bytes(32768)
+		, parallel_version(0)
+		, parallel_applied(0)
+		, descriptions_version(0)
+		, solve_descriptions_applied(0)
+		, coalesce_frames(false)
+		, num_coalesced_frames(0)
+		, buffer_time(0)
+		, packet_pool(Parser::PACKET_BUFFER_SIZE)
+		, last_packet_arrival(0)
+		, data_rate(0)
+		, receive_buffer_request(0x100000)
+		, receive_buffer_size(0)
+		, receive_buffer_max(0)
+		, receive_buffer_stuck(false)
+		, num_kernel_drops(0)
+		, kernel_drop_counter(false)
+		, receive_buffer_applied(0)
+		, last_socket_drops(0)
+		, last_buffer_grow(0)
+		, lazy_frames(false)
+		, marker_index_enabled(false)
+		, num_relay_drops(0)
+		, frame_serial(0)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			natnet_version[i] = 0;
+			server_version[i] = 0;
+		}
+	}
+
+	Client::~Client() { close(); }
+
+	bool Client::setup(const string& interface_name, const string& target_host,
+					   const string& multicast_group, int command_port, int data_port)
+	{
+		close();
+
+		Address interface_addr, group_addr, target_addr;
+
+		if (!Address::fromInterface(interface_name, interface_addr))
+			error_str = "unknown interface: " + interface_name;
+		else if (!Address::resolve(multicast_group, data_port, group_addr))
+			error_str = "invalid multicast group: " + multicast_group;
+		else if (!Address::resolve(target_host, command_port, target_addr))
+			error_str = "can't resolve " + target_host;
+
+		if (error_str.empty())
+		{
+			Address data_addr;
+			data_addr.port = data_port;
+
+			if (!data_socket.open() || !data_socket.bind(data_addr, true)
+				|| !data_socket.joinGroup(group_addr, interface_addr)
+				|| !data_socket.setBlocking(false))
+			{
+				error_str = "data socket: " + UdpSocket::getLastError();
+			}
+			else
+			{
+				applyReceiveBufferSize(receive_buffer_request);
+
+				kernel_drop_counter = data_socket.enableDropCounter();
+				data_socket.enableTimestamps();
+				num_kernel_drops = 0;
+				last_socket_drops = 0;
+			}
+		}
+
+		if (error_str.empty())
+		{
+			if (!command_socket.open() || !command_socket.bind(interface_addr, true)
+				|| !command_socket.connect(target_addr))
+			{
+				error_str = "command socket: " + UdpSocket::getLastError();
+			}
+			else
+			{
+				command_socket.setReceiveBufferSize(0x100000);
+				command_socket.setSendBufferSize(0x100000);
+				command_socket.setBroadcast(true);
+			}
+		}
+
+		if (!error_str.empty())
+		{
+			logMessage(LOG_ERROR, "%s", error_str.c_str());
+			data_socket.close();
+			command_socket.close();
+			return false;
+		}
+
+		thread_settings_applied = -1;
+		running = true;
+		thread = std::thread(&Client::threadedFunction, this);
+
+		sendPing();
+		return true;
+	}
+
+	void Client::setupOffline(int natnet_major, int natnet_minor)
+	{
+		close();
+		setNatNetVersion(natnet_major, natnet_minor);
+
+		// no receiver thread, decodePacket() decodes on this one
+		applyDecodeSettings();
+		connected = true;
+	}
+
+	void Client::close()
+	{
+		if (thread.joinable())
+		{
+			running = false;
+			thread.join();
+		}
+
+		data_socket.close();
+		command_socket.close();
+		receive_buffer_size = 0;
+		kernel_drop_counter = false;
+
+		buffer.clear();
+		filter.reset();
+		marker_tracker.reset();
+		tracking_ids.clear();
+		tracking_active.clear();
+		connected = false;
+		error_str.clear();
+
+		// descriptions go with the connection; the version keeps counting
+		// so consumers notice
+		lock_guard<std::mutex> guard(mutex);
+		frame_view.reset();
+		marker_index.reset();
+		filterd_marker_index.reset();
+		int version = state.description_version;
+		state = State();
+		state.description_version = version + 1;
+		descriptions_version = state.description_version;
+		markerset_slot_names.clear();
+	}
+
+	bool Client::decodePacket(const void* data, size_t size)
+	{
+		if (running)
+		{
+			logMessage(LOG_ERROR, "call setupOffline() first");
+			return false;
+		}
+
+		if (size < 4 || size > Parser::PACKET_BUFFER_SIZE) return false;
+
+		if (lazy_frames && Parser::getMessageId((const char*)data) == NAT_FRAMEOFDATA)
+		{
+			// the view keeps the packet, so it goes into a pool buffer
+			PacketPool::Buffer packet = packet_pool.acquire();
+			memcpy(packet->data(), data, size);
+
+			Nanos t = getTimeNanos();
+			publishFrameView(packet, t);
+			last_packet_arrival = t;
+			return true;
+		}
+
+		// copied so the parser can rely on a full, zero-filled packet buffer
+		// behind the data
+		packet_buffer.resize(Parser::PACKET_BUFFER_SIZE, 0);
+		memcpy(packet_buffer.data(), data, size);
+
+		const char* packet = packet_buffer.data();
+		int message = Parser::getMessageId(packet);
+
+		Nanos t = getTimeNanos();
+
+		bool decoded = true;
+		if (message == NAT_PINGRESPONSE)
+			parser.parsePingResponse(packet);
+		else if (message == NAT_FRAMEOFDATA || message == NAT_MODELDEF)
+			unpack(packet, size, t);
+		else
+			decoded = false;
+
+		// zero what this packet wrote so the next one sees a clean tail
+		memset(packet_buffer.data(), 0, size);
+
+		if (decoded && message != NAT_PINGRESPONSE)
+			last_packet_arrival = t;
+
+		return decoded;
+	}
+
+	void Client::threadedFunction()
+	{
+		while (running)
+		{
+			if (thread_settings_applied != thread_settings_version) applyThreadSettings();
+
+			WaitMode mode = (WaitMode)wait_mode.load();
+			bool ready = mode == WAIT_SLEEP ? data_socket.poll(0) : waitForPacket(mode);
+
+			Nanos t = getTimeNanos();
+
+			bool coalesce = coalesce_frames;
+
+			if (ready)
+			{
+				receivePacket(t);
+
+				// take everything the kernel has queued, up to a bound so a
+				// flood can't starve decoding
+				if (coalesce)
+				{
+					for (int i = 0; i < 256 && data_socket.poll(0); i++)
+						receivePacket(getTimeNanos());
+				}
+			}
+
+			if (receive_buffer_request != receive_buffer_applied)
+				applyReceiveBufferSize(receive_buffer_request);
+
+			Nanos target_time = t - buffer_time;
+			if (coalesce)
+				decodeNewestDuePacket(target_time);
+			else
+				decodeDuePackets(target_time);
+
+			if (mode == WAIT_SLEEP) this_thread::sleep_for(chrono::milliseconds(1));
+		}
+	}
+
+	void Client::receivePacket(Nanos t)
+	{
+		buffer.push_back(Packet());
+		Packet& packet = buffer.back();
+		packet.data = packet_pool.acquire();
+
+		int n = data_socket.receive(packet.data->data(), packet.data->size());
+
+		if (kernel_drop_counter) countKernelDrops(t);
+
+		if (n > 0)
+		{
+			packet.arrival = t;
+			packet.size = n;
+
+			if (data_socket.hasTimestamps())
+			{
+				Nanos wake = getWallTimeNanos() - data_socket.getLastTimestamp();
+				lock_guard<std::mutex> guard(stats_mutex);
+				latency_stats.wake.add(wake);
+			}
+
+			Nanos last = last_packet_arrival;
+			if (last > 0 && t > last)
+			{
+				double r = NANOS_PER_SECOND / (double)(t - last);
+				data_rate = data_rate + (r - data_rate) * 0.1;
+			}
+			last_packet_arrival = t;
+		}
+		else
+		{
+			if (n < 0)
+				logMessage(LOG_ERROR, "udp socket error: %s", UdpSocket::getLastError().c_str());
+
+			buffer.pop_back();
+		}
+	}
+
+	void Client::decodeDuePackets(Nanos target_time)
+	{
+		while (buffer.size())
+		{
+			Packet& packet = buffer.front();
+			if (packet.arrival > target_time)
+			{
+				break;
+			}
+
+			unpack(packet);
+			buffer.pop_front();
+		}
+	}
+
+	void Client::decodeNewestDuePacket(Nanos target_time)
+	{
+		// newest due frame by frame number
+		int num_due = 0;
+		int newest = -1;
+		int newest_number = 0;
+
+		for (; num_due < buffer.size() && buffer[num_due].arrival <= target_time; num_due++)
+		{
+			const char* data = buffer[num_due].data->data();
+			if (Parser::getMessageId(data) != NAT_FRAMEOFDATA) continue;
+
+			// difference in unsigned arithmetic, read back as signed: defined
+			// for any two numbers, and newer across a wrap
+			int number = Parser::getFrameNumber(data);
+			if (newest < 0 || (int32_t)((uint32_t)number - (uint32_t)newest_number) >= 0)
+			{
+				newest = num_due;
+				newest_number = number;
+			}
+		}
+
+		// everything else that is due is dropped, except descriptions
+		for (int i = 0; i < num_due; i++)
+		{
+			Packet& packet = buffer.front();
+			int message = Parser::getMessageId(packet.data->data());
+
+			if (message != NAT_FRAMEOFDATA || i == newest)
+				unpack(packet);
+			else
+				num_coalesced_frames++;
+
+			buffer.pop_front();
+		}
+	}
+
+	bool Client::waitForPacket(WaitMode mode)
+	{
+		// wake up for the next jitter buffer deadline, and often enough to
+		// notice close()
+		Nanos timeout = 10 * 1000 * 1000;
+		if (buffer.size())
+		{
+			Nanos due = buffer.front().arrival + buffer_time - getTimeNanos();
+			timeout = due < 0 ? 0 : (due < timeout ? due : timeout);
+		}
+
+		if (mode == WAIT_SPIN)
+		{
+			Nanos start = getTimeNanos();
+			Nanos spin = (Nanos)spin_usec * 1000;
+			if (spin > timeout) spin = timeout;
+
+			do
+			{
+				if (data_socket.poll(0)) return true;
+			} while (getTimeNanos() - start < spin);
+
+			timeout -= spin;
+		}
+
+		return data_socket.poll((int)(timeout / 1000));
+	}
+
+	void Client::applyThreadSettings()
+	{
+		thread_settings_applied = thread_settings_version;
+
+		int cpu = receiver_cpu;
+		if (!setThreadAffinity(cpu))
+			logMessage(LOG_WARNING, "can't pin the receiver thread to cpu %d", cpu);
+
+		int priority = receiver_priority;
+		if (!setThreadRealtimePriority(priority))
+			logMessage(LOG_WARNING, "can't set the receiver thread priority to %d", priority);
+
+		int usec = busy_poll_usec;
+		if (!data_socket.setBusyPoll(usec))
+			logMessage(LOG_WARNING, "can't enable busy polling: %s", UdpSocket::getLastError().c_str());
+	}
+
+	void Client::setSubscription(const Subscription& subscription)
+	{
+		lock_guard<std::mutex> guard(mutex);
+		this->subscription = subscription;
+		subscription_version++;
+	}
+
+	Subscription Client::getSubscription()
+	{
+		lock_guard<std::mutex> guard(mutex);
+		return subscription;
+	}
+
+	void Client::setConfig(const DecodeConfig& config)
+	{
+		lock_guard<std::mutex> guard(config_mutex);
+		atomic_store(&this->config, DecodeConfigPtr(make_shared<DecodeConfig>(config)));
+		config_version++;
+	}
+
+	DecodeConfigPtr Client::getConfig() const { return atomic_load(&config); }
+
+	void Client::setTransform(const Matrix4x4& m)
+	{
+		lock_guard<std::mutex> guard(config_mutex);
+		shared_ptr<DecodeConfig> c = make_shared<DecodeConfig>(*atomic_load(&config));
+		c->setTransform(m);
+		atomic_store(&config, DecodeConfigPtr(c));
+		config_version++;
+	}
+
+	void Client::setDuplicatedPointRemovalDistance(float v)
+	{
+		lock_guard<std::mutex> guard(config_mutex);
+		shared_ptr<DecodeConfig> c = make_shared<DecodeConfig>(*atomic_load(&config));
+		c->setDuplicatedPointRemovalDistance(v);
+		atomic_store(&config, DecodeConfigPtr(c));
+		config_version++;
+	}
+
+	void Client::setSkeletonLocalCoordinates(bool yn)
+	{
+		lock_guard<std::mutex> guard(config_mutex);
+		shared_ptr<DecodeConfig> c = make_shared<DecodeConfig>(*atomic_load(&config));
+		c->setSkeletonLocalCoordinates(yn);
+		atomic_store(&config, DecodeConfigPtr(c));
+		config_version++;
+	}
+
+	void Client::setNatNetVersion(int major, int minor)
+	{
+		lock_guard<std::mutex> guard(mutex);
+		natnet_version[0] = major;
+		natnet_version[1] = minor;
+		protocol_version++;
+	}
+
+	void Client::applyDecodeSettings()
+	{
+		if (protocol_applied != protocol_version)
+		{
+			lock_guard<std::mutex> guard(mutex);
+			parser.setNatNetVersion(natnet_version[0], natnet_version[1]);
+			parser.setServerVersion(server_version[0], server_version[1]);
+			parser.setServerClockFrequency(server_clock_frequency);
+			protocol_applied = protocol_version;
+		}
+
+		// version first: a snapshot published after it was read is taken
+		// now or on the next call
+		if (config_applied != config_version)
+		{
+			config_applied = config_version;
+			parser.setConfig(atomic_load(&config));
+		}
+	}
+
+	void Client::setParallelDecode(int num_threads, size_t min_frame_bytes)
+	{
+		lock_guard<std::mutex> guard(mutex);
+		parallel_threads = num_threads;
+		parallel_min_bytes = min_frame_bytes;
+		parallel_version++;
+	}
+
+	void Client::setLazyFrames(bool yn) { lazy_frames = yn; }
+
+	FrameViewPtr Client::getFrameView()
+	{
+		lock_guard<std::mutex> guard(mutex);
+		return frame_view;
+	}
+
+	void Client::setMarkerIndexEnabled(bool yn)
+	{
+		marker_index_enabled = yn;
+		if (yn) return;
+
+		lock_guard<std::mutex> guard(mutex);
+		marker_index.reset();
+		filterd_marker_index.reset();
+	}
+
+	MarkerIndexPtr Client::getMarkerIndex(bool filterd)
+	{
+		lock_guard<std::mutex> guard(mutex);
+		return filterd ? filterd_marker_index : marker_index;
+	}
+
+	void Client::setCoalesceFrames(bool yn) { coalesce_frames = yn; }
+
+	void Client::setWaitMode(WaitMode mode, int spin_usec)
+	{
+		this->spin_usec = spin_usec < 0 ? 0 : spin_usec;
+		wait_mode = mode;
+	}
+
+	void Client::setReceiverAffinity(int cpu)
+	{
+		receiver_cpu = cpu;
+		thread_settings_version++;
+	}
+
+	void Client::setReceiverPriority(int priority)
+	{
+		receiver_priority = priority;
+		thread_settings_version++;
+	}
+
+	void Client::setBusyPoll(int usec)
+	{
+		busy_poll_usec = usec;
+		thread_settings_version++;
+	}
+
+	Client::LatencyStats Client::getLatencyStats()
+	{
+		lock_guard<std::mutex> guard(stats_mutex);
+		return latency_stats;
+	}
+
+	void Client::resetLatencyStats()
+	{
+		lock_guard<std::mutex> guard(stats_mutex);
+		latency_stats = LatencyStats();
+	}
+
+	void Client::applyReceiveBufferSize(int size)
+	{
+		data_socket.setReceiveBufferSize(size);
+		receive_buffer_applied = size;
+
+		int granted = data_socket.getReceiveBufferSize();
+		if (granted < size)
+			logMessage(LOG_WARNING, "receive buffer is %d bytes, %d requested (see net.core.rmem_max)",
+					   granted, size);
+
+		receive_buffer_size = granted;
+	}
+
+	void Client::countKernelDrops(Nanos t)
+	{
+		uint32_t drops = data_socket.getNumDrops();
+		if (drops == last_socket_drops) return;
+
+		// unsigned difference survives the 32-bit counter wrapping
+		num_kernel_drops += (uint32_t)(drops - last_socket_drops);
+		last_socket_drops = drops;
+
+		int limit = receive_buffer_max;
+		int size = receive_buffer_size;
+		if (size >= limit || receive_buffer_stuck || t - last_buffer_grow < NANOS_PER_SECOND) return;
+
+		last_buffer_grow = t;
+		receive_buffer_request = size > limit / 2 ? limit : size * 2;
+		applyReceiveBufferSize(receive_buffer_request);
+
+		// clamped by the kernel, don't retry until the settings change
+		if (receive_buffer_size <= size)
+			receive_buffer_stuck = true;
+		else
+			logMessage(LOG_NOTICE, "kernel dropped datagrams, receive buffer grown to %d bytes",
+					   (int)receive_buffer_size);
+	}
+
+	void Client::setReceiveBufferSize(int bytes)
+	{
+		receive_buffer_request = bytes;
+		receive_buffer_stuck = false;
+	}
+
+	void Client::setReceiveBufferAutoGrow(int max_bytes)
+	{
+		receive_buffer_max = max_bytes;
+		receive_buffer_stuck = false;
+	}
+
+	void Client::sendRequestDescription()
+	{
+		if (!command_socket.isOpen()) return;
+
+		vector<char> packet(Parser::PACKET_BUFFER_SIZE, 0);
+		unsigned short header[2] = { NAT_REQUEST_MODELDEF, 0 };
+
+		for (int i = 0; i < 3; i++)
+		{
+			command_socket.send(header, sizeof(header));
+
+			if (command_socket.poll(100 * 1000))
+			{
+				int n = command_socket.receive(packet.data(), packet.size());
+				if (n <= 4 || Parser::getMessageId(packet.data()) != NAT_MODELDEF) continue;
+
+				// decoded here with the current version, the receiver
+				// thread's parser is left alone
+				Parser parser;
+				{
+					lock_guard<std::mutex> guard(mutex);
+					parser.setNatNetVersion(natnet_version[0], natnet_version[1]);
+					parser.setServerVersion(server_version[0], server_version[1]);
+				}
+
+				Descriptions descriptions;
+				if (parser.parseDescriptions(packet.data(), descriptions)) publishDescriptions(descriptions);
+			}
+		}
+	}
+
+	void Client::sendPing()
+	{
+		if (!command_socket.isOpen()) return;
+
+		vector<char> packet(Parser::PACKET_BUFFER_SIZE, 0);
+		unsigned short header[2] = { NAT_PING, 0 };
+
+		connected = false;
+
+		for (int i = 0; i < 3; i++)
+		{
+			int n = command_socket.send(header, sizeof(header));
+			if (n > 0 && connected) break;
+
+			if (command_socket.poll(100 * 1000))
+			{
+				int n = command_socket.receive(packet.data(), packet.size());
+
+				// parsed here, applied by the receiver thread
+				Parser ping;
+				if (n > 0 && ping.parsePingResponse(packet.data()))
+				{
+					{
+						lock_guard<std::mutex> guard(mutex);
+						natnet_version[0] = ping.getNatNetMajor();
+						natnet_version[1] = ping.getNatNetMinor();
+						server_version[0] = ping.getServerMajor();
+						server_version[1] = ping.getServerMinor();
+						server_clock_frequency = ping.getServerClockFrequency();
+						protocol_version++;
+					}
+
+					connected = true;
+
+					logMessage(LOG_NOTICE, "connected. NatNet: v%i.%i, Server: v%i.%i",
+							   ping.getNatNetMajor(), ping.getNatNetMinor(),
+							   ping.getServerMajor(), ping.getServerMinor());
+					return;
+				}
+				else if (n < 0)
+				{
+					logMessage(LOG_ERROR, "udp socket error: %s", UdpSocket::getLastError().c_str());
+				}
+			}
+
+			logMessage(LOG_WARNING, "No route to host. count: %d", i);
+		}
+	}
+
+	bool Client::isConnected(float timeout_sec) const
+	{
+		return connected && getNanosSinceLastPacket() < secondsToNanos(timeout_sec);
+	}
+
+	Nanos Client::getNanosSinceLastPacket() const
+	{
+		Nanos last = last_packet_arrival;
+		if (last == 0) return numeric_limits<Nanos>::max();
+		return getTimeNanos() - last;
+	}
+
+	uint64_t Client::getFrameSerial()
+	{
+		lock_guard<std::mutex> guard(frame_mutex);
+		return frame_serial;
+	}
+
+	void Client::setEviction(const Eviction& eviction)
+	{
+		lock_guard<std::mutex> guard(mutex);
+		this->eviction = eviction;
+	}
+
+	Client::Eviction Client::getEviction()
+	{
+		lock_guard<std::mutex> guard(mutex);
+		return eviction;
+	}
+
+	Client::Footprint Client::getFootprint()
+	{
+		lock_guard<std::mutex> guard(mutex);
+
+		Footprint footprint;
+		footprint.num_rigidbodies = state.rigidbodies.size();
+		footprint.num_skeletons = state.skeletons.size();
+		footprint.bytes = state.entity_bytes;
+		footprint.num_evicted = state.num_evicted;
+		return footprint;
+	}
+
+	void Client::fillPoseBuffer(PoseBuffer& buffer)
+	{
+		lock_guard<std::mutex> guard(mutex);
+		buffer.fill(state.frame_number, state.markers, state.filterd_markers,
+					state.rigidbodies, state.skeletons);
+	}
+
+	bool Client::waitForFrame(uint64_t& serial, float timeout_sec)
+	{
+		unique_lock<std::mutex> guard(frame_mutex);
+
+		uint64_t seen = serial;
+		bool arrived = frame_condition.wait_for(
+			guard, chrono::duration<float>(timeout_sec),
+			[&] { return frame_serial != seen; });
+
+		serial = frame_serial;
+		return arrived;
+	}
+
+	void Client::setBufferTime(float sec)
+	{
+		sec = sec < 0 ? 0 : (sec > 10 ? 10 : sec);
+		buffer_time = secondsToNanos(sec);
+	}
+
+	void Client::unpack(const Packet& packet)
+	{
+		if (lazy_frames && Parser::getMessageId(packet.data->data()) == NAT_FRAMEOFDATA)
+			publishFrameView(packet.data, packet.arrival);
+		else
+			unpack(packet.data->data(), packet.size, packet.arrival);
+	}
+
+	void Client::publishFrameView(const PacketPool::Buffer& packet, Nanos arrival)
+	{
+		applyDecodeSettings();
+
+		shared_ptr<FrameView> view = make_shared<FrameView>();
+		if (!parser.indexFrame(packet, *view)) return;
+		view->arrival = arrival;
+
+		{
+			lock_guard<std::mutex> guard(mutex);
+			frame_view = view;
+			state.frame_number = view->getFrameNumber();
+			state.latency = view->getLatency();
+		}
+
+		if (frame_view_callback) frame_view_callback(view);
+
+		Nanos publish = getTimeNanos() - arrival;
+		{
+			lock_guard<std::mutex> guard(stats_mutex);
+			latency_stats.publish.add(publish);
+		}
+
+		{
+			lock_guard<std::mutex> guard(frame_mutex);
+			frame_serial++;
+		}
+		frame_condition.notify_all();
+	}
+
+	void Client::unpack(const char* packet, size_t size, Nanos arrival)
+	{
+		applyDecodeSettings();
+
+		int message = Parser::getMessageId(packet);
+
+		if (message == NAT_FRAMEOFDATA)
+		{
+			if (subscription_applied != subscription_version)
+			{
+				lock_guard<std::mutex> guard(mutex);
+				parser.setSubscription(subscription);
+				subscription_applied = subscription_version;
+			}
+
+			if (parallel_applied != parallel_version)
+			{
+				int num_threads;
+				size_t min_bytes;
+				{
+					lock_guard<std::mutex> guard(mutex);
+					num_threads = parallel_threads;
+					min_bytes = parallel_min_bytes;
+					parallel_applied = parallel_version;
+				}
+
+				// the old pool, if any, is joined when the parser lets it go
+				shared_ptr<WorkerPool> pool;
+				if (num_threads > 1) pool = make_shared<WorkerPool>(num_threads);
+				parser.setParallelDecode(pool, min_bytes);
+			}
+
+			if (parser.parseFrame(packet, frame, size))
+			{
+				frame.arrival = arrival;
+				publishFrame();
+
+				Nanos publish = getTimeNanos() - arrival;
+				lock_guard<std::mutex> guard(stats_mutex);
+				latency_stats.publish.add(publish);
+			}
+		}
+		else if (message == NAT_MODELDEF)
+		{
+			Descriptions descriptions;
+			if (parser.parseDescriptions(packet, descriptions)) publishDescriptions(descriptions);
+		}
+		else
+		{
+			logMessage(LOG_ERROR, "Unrecognized Packet Type");
+		}
+	}
+
+	void Client::publishDescriptions(const Descriptions& descriptions)
+	{
+		// copy to consumers
+		lock_guard<std::mutex> guard(mutex);
+		state.descriptions = descriptions;
+		state.description_version++;
+		descriptions_version = state.description_version;
+	}
+
+	// one strcmp per marker set, cheaper than resolving the names again
+	static bool sameNames(const vector<const char*>& names, const vector<string>& cached)
+	{
+		if (names.size() != cached.size()) return false;
+		for (int i = 0; i < names.size(); i++)
+			if (strcmp(names[i], cached[i].c_str()) != 0) return false;
+		return true;
+	}
+
+	void Client::solveSkeletons()
+	{
+		if (solve_descriptions_applied != descriptions_version)
+		{
+			lock_guard<std::mutex> guard(mutex);
+			solve_descriptions = state.descriptions;
+			solve_descriptions_applied = state.description_version;
+		}
+
+		const Descriptions& descs = solve_descriptions;
+
+		for (int i = 0; i < frame.skeletons.size(); i++)
+		{
+			map<int, int>::const_iterator it = descs.skeleton_index_by_id.find(frame.skeletons[i].id);
+			if (it != descs.skeleton_index_by_id.end())
+				parser.solveSkeleton(frame.skeletons[i], descs.skeletons[it->second]);
+			else
+			{
+				frame.skeletons[i].local_matrices.clear();
+				frame.skeletons[i].world_matrices.clear();
+			}
+		}
+	}
+
+	void Client::publishFrame()
+	{
+		shared_ptr<ofxNatNetFrameRing> frame_ring;
+		shared_ptr<ofxNatNetSharedMemory> relay_memory;
+		vector<Address> relay_targets;
+
+		updateTrackingChanges();
+
+		if (filter.isEnabled())
+		{
+			// server time when the stream has it, arrival otherwise
+			double t = frame.timestamp > 0 ? frame.timestamp : nanosToSeconds(frame.arrival);
+			filter.apply(frame.rigidbodies, t, *parser.getConfig());
+			frame.invalidateMatrices();
+		}
+
+		solveSkeletons();
+
+		if (marker_tracker.isEnabled())
+			marker_tracker.apply(frame.markers.data(), frame.num_unlabeled_markers, frame.frame_number,
+								 frame.marker_ids, frame.marker_ages);
+		else
+		{
+			frame.marker_ids.clear();
+			frame.marker_ages.clear();
+		}
+
+		// the frame is complete: subscribers first, before the state copy
+		// and the history / relay work
+		if (frame_callback) frame_callback(frame);
+
+		{
+			lock_guard<std::mutex> guard(mutex);
+
+			// waiters woken here take the state lock next, so they see this
+			// frame once the copy below is done
+			{
+				lock_guard<std::mutex> frame_guard(frame_mutex);
+				frame_serial++;
+			}
+			frame_condition.notify_all();
+
+			frame_ring = this->frame_ring;
+			relay_memory = this->relay_memory;
+			relay_targets = this->relay_targets;
+
+			const Descriptions& descs = state.descriptions;
+
+			state.latency = frame.latency;
+			state.frame_number = frame.frame_number;
+			state.markers_set = frame.markers_set;
+			state.markers = frame.markers;
+			state.filterd_markers = frame.filterd_markers;
+			state.marker_ids = frame.marker_ids;
+			state.marker_ages = frame.marker_ages;
+
+			if (state.markerset_slots_version != state.description_version
+				|| !sameNames(frame.markerset_names, markerset_slot_names))
+			{
+				state.markerset_slots.assign(descs.markersets.size(), -1);
+
+				for (int i = 0; i < frame.markerset_names.size(); i++)
+				{
+					NameIndex::const_iterator it = descs.markerset_index.find(frame.markerset_names[i]);
+					if (it != descs.markerset_index.end()) state.markerset_slots[it->second] = i;
+				}
+
+				state.markerset_slots_version = state.description_version;
+				markerset_slot_names.assign(frame.markerset_names.begin(), frame.markerset_names.end());
+			}
+
+			storeEntities();
+			evictEntities();
+		}
+
+		// built outside the lock; the ones replaced go back to the pool
+		// once the last consumer lets go of them
+		if (marker_index_enabled)
+		{
+			shared_ptr<MarkerIndex> m = marker_index_pool.acquire();
+			m->build(frame.markers, frame.frame_number);
+			MarkerIndexPtr index = m;
+
+			shared_ptr<MarkerIndex> f = marker_index_pool.acquire();
+			f->build(frame.filterd_markers, frame.frame_number);
+			MarkerIndexPtr filterd_index = f;
+
+			lock_guard<std::mutex> guard(mutex);
+			marker_index.swap(index);
+			filterd_marker_index.swap(filterd_index);
+		}
+
+		if (frame_ring || relay_memory || relay_targets.size())
+		{
+			packCompactFrame();
+
+			if (frame_ring)
+				frame_ring->write(compact_buffer.data(), compact_buffer.size());
+
+			relayCompactFrame(relay_memory, relay_targets);
+		}
+	}
+
+	// rb-tree node links and color, roughly
+	static const size_t MAP_NODE_BYTES = 4 * sizeof(void*);
+
+	// per id: the pose map node and the EntityInfo node
+	static const size_t ENTITY_OVERHEAD_BYTES = 2 * MAP_NODE_BYTES + 2 * sizeof(int) + sizeof(Client::EntityInfo);
+
+	static size_t getHeapBytes(const RigidBody& RB)
+	{
+		return sizeof(RigidBody) + RB.markers.capacity() * sizeof(Marker);
+	}
+
+	static size_t getHeapBytes(const Skeleton& S)
+	{
+		size_t bytes = sizeof(Skeleton) + S.joints.capacity() * sizeof(RigidBody)
+			+ (S.local_matrices.capacity() + S.world_matrices.capacity()) * sizeof(Matrix4x4);
+		for (int i = 0; i < S.joints.size(); i++) bytes += S.joints[i].markers.capacity() * sizeof(Marker);
+		return bytes;
+	}
+
+	template <typename T>
+	static void storeEntity(const T& src, int frame_number, map<int, T>& entities,
+							map<int, Client::EntityInfo>& info, size_t& total_bytes)
+	{
+		T& dst = entities[src.id];
+		dst = src;
+
+		Client::EntityInfo& I = info[src.id];
+		total_bytes -= I.bytes;
+		I.bytes = ENTITY_OVERHEAD_BYTES + getHeapBytes(dst);
+		I.last_seen = frame_number;
+		total_bytes += I.bytes;
+	}
+
+	template <typename T>
+	static int evictUnseen(int frame_number, int max_unseen_frames, map<int, T>& entities,
+						   map<int, Client::EntityInfo>& info, size_t& total_bytes)
+	{
+		int num_evicted = 0;
+
+		map<int, Client::EntityInfo>::iterator it = info.begin();
+		while (it != info.end())
+		{
+			Client::EntityInfo& I = it->second;
+
+			// frame numbers went back (take looped, server restarted):
+			// count from here
+			if (I.last_seen > frame_number) I.last_seen = frame_number;
+
+			if (max_unseen_frames > 0 && frame_number - I.last_seen >= max_unseen_frames)
+			{
+				total_bytes -= I.bytes;
+				entities.erase(it->first);
+				info.erase(it++);
+				num_evicted++;
+			}
+			else
+				++it;
+		}
+
+		return num_evicted;
+	}
+
+	void Client::storeEntities()
+	{
+		for (int i = 0; i < frame.rigidbodies.size(); i++)
+			storeEntity(frame.rigidbodies[i], frame.frame_number, state.rigidbodies,
+						state.rigidbody_info, state.entity_bytes);
+
+		for (int i = 0; i < frame.skeletons.size(); i++)
+			storeEntity(frame.skeletons[i], frame.frame_number, state.skeletons,
+						state.skeleton_info, state.entity_bytes);
+	}
+
+	void Client::evictEntities()
+	{
+		int f = state.frame_number;
+
+		state.num_evicted += evictUnseen(f, eviction.max_unseen_frames, state.rigidbodies,
+										 state.rigidbody_info, state.entity_bytes);
+		state.num_evicted += evictUnseen(f, eviction.max_unseen_frames, state.skeletons,
+										 state.skeleton_info, state.entity_bytes);
+
+		if (eviction.max_bytes == 0 || state.entity_bytes <= eviction.max_bytes) return;
+
+		// over budget: least recently seen first, down to the ids of the
+		// current frame, which always stay. (last seen, id), skeletons
+		// with negated ids - 1
+		vector<pair<int, int> > order;
+		order.reserve(state.rigidbody_info.size() + state.skeleton_info.size());
+
+		map<int, EntityInfo>::const_iterator it;
+		for (it = state.rigidbody_info.begin(); it != state.rigidbody_info.end(); ++it)
+			if (it->second.last_seen < f) order.push_back(make_pair(it->second.last_seen, it->first));
+		for (it = state.skeleton_info.begin(); it != state.skeleton_info.end(); ++it)
+			if (it->second.last_seen < f) order.push_back(make_pair(it->second.last_seen, -it->first - 1));
+
+		sort(order.begin(), order.end());
+
+		for (int i = 0; i < order.size() && state.entity_bytes > eviction.max_bytes; i++)
+		{
+			int id = order[i].second;
+			if (id >= 0)
+			{
+				state.entity_bytes -= state.rigidbody_info[id].bytes;
+				state.rigidbody_info.erase(id);
+				state.rigidbodies.erase(id);
+			}
+			else
+			{
+				id = -id - 1;
+				state.entity_bytes -= state.skeleton_info[id].bytes;
+				state.skeleton_info.erase(id);
+				state.skeletons.erase(id);
+			}
+			state.num_evicted++;
+		}
+	}
+
+	void Client::updateTrackingChanges()
+	{
+		int n = frame.rigidbodies.size();
+		size_t words = (n + 63) / 64;
+
+		frame.tracking_gained.assign(words, 0);
+		frame.tracking_lost.assign(words, 0);
+		frame.num_tracking_changes = 0;
+
+		int num_prev = tracking_ids.size();
+
+		for (int i = 0; i < n; i++)
+		{
+			const RigidBody& RB = frame.rigidbodies[i];
+
+			// bodies normally keep their order from frame to frame
+			int prev = -1;
+			if (i < num_prev && tracking_ids[i] == RB.id)
+				prev = i;
+			else
+			{
+				for (int j = 0; j < num_prev; j++)
+				{
+					if (tracking_ids[j] == RB.id)
+					{
+						prev = j;
+						break;
+					}
+				}
+			}
+
+			bool was_active = prev >= 0 && tracking_active[prev];
+			if (RB.active == was_active) continue;
+
+			uint64_t bit = (uint64_t)1 << (i & 63);
+			if (RB.active)
+				frame.tracking_gained[i >> 6] |= bit;
+			else
+				frame.tracking_lost[i >> 6] |= bit;
+			frame.num_tracking_changes++;
+		}
+
+		tracking_ids.resize(n);
+		tracking_active.resize(n);
+		for (int i = 0; i < n; i++)
+		{
+			tracking_ids[i] = frame.rigidbodies[i].id;
+			tracking_active[i] = frame.rigidbodies[i].active;
+		}
+	}
+
+	static void packRigidBody(ofxNatNetCompactFrame::RigidBody& dst,
+							  const RigidBody& RB, uint32_t flags = 0)
+	{
+		const Vec3& p = RB.position;
+		const Quat& q = RB.orientation;
+
+		dst.id = RB.id;
+		dst.position[0] = p.x;
+		dst.position[1] = p.y;
+		dst.position[2] = p.z;
+		dst.orientation[0] = q.x;
+		dst.orientation[1] = q.y;
+		dst.orientation[2] = q.z;
+		dst.orientation[3] = q.w;
+		dst.mean_marker_error = RB.mean_marker_error;
+		dst.flags = flags | (RB.active ? ofxNatNetCompactFrame::RIGIDBODY_ACTIVE : 0);
+	}
+
+	// flattens the decoded frame into compact_buffer (see ofxNatNetCompactFrame.h)
+	void Client::packCompactFrame()
+	{
+		typedef ofxNatNetCompactFrame CF;
+
+		size_t num_markerset_markers = 0;
+		for (int i = 0; i < frame.markers_set.size(); i++)
+			num_markerset_markers += frame.markers_set[i].size();
+
+		size_t num_joints = 0;
+		for (int i = 0; i < frame.skeletons.size(); i++)
+			num_joints += frame.skeletons[i].joints.size();
+
+		size_t size = CF::computeSize(
+			frame.markers.size() + frame.filterd_markers.size() + num_markerset_markers,
+			frame.markers_set.size(), frame.rigidbodies.size(), frame.skeletons.size(), num_joints);
+
+		compact_buffer.resize(size);
+		char* ptr = compact_buffer.data();
+
+		CF::Header& h = *(CF::Header*)ptr;
+		memset(&h, 0, sizeof(h));
+		h.magic = CF::MAGIC;
+		h.version = CF::VERSION;
+		h.header_size = sizeof(CF::Header);
+		h.size = size;
+		h.frame_number = frame.frame_number;
+		h.timestamp = frame.timestamp;
+		h.latency = frame.latency;
+		h.timecode = frame.timecode;
+		h.timecode_sub = frame.timecode_sub;
+		h.flags = frame.num_tracking_changes ? CF::FRAME_TRACKING_CHANGED : 0;
+		h.num_markers = frame.markers.size();
+		h.num_filterd_markers = frame.filterd_markers.size();
+		h.num_markerset_markers = num_markerset_markers;
+		h.num_markersets = frame.markers_set.size();
+		h.num_rigidbodies = frame.rigidbodies.size();
+		h.num_skeletons = frame.skeletons.size();
+		h.num_joints = num_joints;
+		ptr += sizeof(CF::Header);
+
+		// Vec3 and CF::Marker are both three packed floats
+		CF::Marker* m = (CF::Marker*)ptr;
+		if (frame.markers.size())
+			memcpy(m, frame.markers.data(), frame.markers.size() * sizeof(CF::Marker));
+		m += frame.markers.size();
+		if (frame.filterd_markers.size())
+			memcpy(m, frame.filterd_markers.data(), frame.filterd_markers.size() * sizeof(CF::Marker));
+		m += frame.filterd_markers.size();
+		for (int i = 0; i < frame.markers_set.size(); i++)
+		{
+			const vector<Marker>& set = frame.markers_set[i];
+			if (set.size()) memcpy(m, set.data(), set.size() * sizeof(CF::Marker));
+			m += set.size();
+		}
+
+		CF::MarkerSet* ms = (CF::MarkerSet*)m;
+		uint32_t first_marker = 0;
+		for (int i = 0; i < frame.markers_set.size(); i++, ms++)
+		{
+			ms->first_marker = first_marker;
+			ms->num_markers = frame.markers_set[i].size();
+			first_marker += ms->num_markers;
+		}
+
+		CF::RigidBody* rb = (CF::RigidBody*)ms;
+		for (int i = 0; i < frame.rigidbodies.size(); i++, rb++)
+		{
+			uint32_t flags = 0;
+			if (frame.num_tracking_changes)
+			{
+				if (testBit(frame.tracking_gained, i)) flags |= CF::RIGIDBODY_TRACKING_GAINED;
+				if (testBit(frame.tracking_lost, i)) flags |= CF::RIGIDBODY_TRACKING_LOST;
+			}
+			packRigidBody(*rb, frame.rigidbodies[i], flags);
+		}
+
+		CF::Skeleton* sk = (CF::Skeleton*)rb;
+		uint32_t first_joint = 0;
+		for (int i = 0; i < frame.skeletons.size(); i++, sk++)
+		{
+			sk->id = frame.skeletons[i].id;
+			sk->first_joint = first_joint;
+			sk->num_joints = frame.skeletons[i].joints.size();
+			first_joint += sk->num_joints;
+		}
+
+		CF::RigidBody* joint = (CF::RigidBody*)sk;
+		for (int i = 0; i < frame.skeletons.size(); i++)
+		{
+			const vector<RigidBody>& joints = frame.skeletons[i].joints;
+			for (int j = 0; j < joints.size(); j++, joint++)
+				packRigidBody(*joint, joints[j]);
+		}
+	}
+
+	void Client::relayCompactFrame(const shared_ptr<ofxNatNetSharedMemory>& memory,
+								   const vector<Address>& targets)
+	{
+		if (memory && !memory->write(compact_buffer.data(), compact_buffer.size()))
+			num_relay_drops++;
+
+		if (targets.empty()) return;
+
+		// largest UDP payload over IPv4
+		if (compact_buffer.size() > 65507)
+		{
+			num_relay_drops += targets.size();
+			return;
+		}
+
+		for (int i = 0; i < targets.size(); i++)
+		{
+			if (relay_socket.sendTo(compact_buffer.data(), compact_buffer.size(), targets[i]) < 0)
+				num_relay_drops++;
+		}
+	}
+
+	void Client::setFrameHistorySize(size_t num_frames, size_t max_frame_bytes)
+	{
+		shared_ptr<ofxNatNetFrameRing> ring;
+		if (num_frames > 0)
+			ring = make_shared<ofxNatNetFrameRing>(num_frames, max_frame_bytes);
+
+		lock_guard<std::mutex> guard(mutex);
+		frame_ring = ring;
+	}
+
+	size_t Client::getFrameHistorySize()
+	{
+		lock_guard<std::mutex> guard(mutex);
+		return frame_ring ? frame_ring->getNumSlots() : 0;
+	}
+
+	ofxNatNetFrameRing::Reader Client::createFrameReader()
+	{
+		lock_guard<std::mutex> guard(mutex);
+		return ofxNatNetFrameRing::Reader(frame_ring);
+	}
+
+	bool Client::setRelaySharedMemory(const string& name, size_t num_frames,
+									  size_t max_frame_bytes)
+	{
+		shared_ptr<ofxNatNetSharedMemory> memory = make_shared<ofxNatNetSharedMemory>();
+		if (!memory->create(name, num_frames, max_frame_bytes))
+		{
+			logMessage(LOG_ERROR, "failed to create shared memory: %s", name.c_str());
+			return false;
+		}
+
+		lock_guard<std::mutex> guard(mutex);
+		relay_memory = memory;
+		return true;
+	}
+
+	void Client::closeRelaySharedMemory()
+	{
+		lock_guard<std::mutex> guard(mutex);
+		relay_memory.reset();
+	}
+
+	bool Client::addRelayTarget(const string& host, int port)
+	{
+		Address addr;
+		if (!Address::resolve(host, port, addr))
+		{
+			logMessage(LOG_ERROR, "invalid relay target: %s", host.c_str());
+			return false;
+		}
+
+		lock_guard<std::mutex> guard(mutex);
+		if (!relay_socket.isOpen() && !relay_socket.open())
+		{
+			logMessage(LOG_ERROR, "relay socket: %s", UdpSocket::getLastError().c_str());
+			return false;
+		}
+		relay_targets.push_back(addr);
+		return true;
+	}
+
+	void Client::clearRelayTargets()
+	{
+		lock_guard<std::mutex> guard(mutex);
+		relay_targets.clear();
+	}
+}
@@ -0,0 +1,537 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Clock.h"
+#include "Filter.h"
+#include "Frame.h"
+#include "FrameView.h"
+#include "MarkerIndex.h"
+#include "MarkerTracker.h"
+#include "PacketPool.h"
+#include "Parser.h"
+#include "PoseBuffer.h"
+#include "Socket.h"
+
+#include "../ofxNatNetFrameRing.h"
+#include "../ofxNatNetSharedMemory.h"
+
+// NatNet client: command / data sockets, a receiver thread that decodes
+// frames, and the latest decoded state for consumers.
+//
+// consumers either take the state under lock() / unlock(), or subscribe
+// to every frame with setFrameCallback(), the frame history ring or the
+// relay.
+
+namespace NatNet
+{
+	class Client
+	{
+	public:
+		// when State::rigidbodies / skeletons entries no longer streamed are
+		// dropped. by default nothing is: ids that leave the stream (deleted
+		// assets, or ones the subscription filters out) keep their last pose.
+		struct Eviction
+		{
+			int max_unseen_frames;  // evict after this many frames unseen, 0 never
+			size_t max_bytes;       // beyond this, least recently seen first. 0 for no limit
+
+			Eviction()
+				: max_unseen_frames(0)
+				, max_bytes(0)
+			{
+			}
+		};
+
+		struct EntityInfo
+		{
+			int last_seen;  // frame number
+			size_t bytes;   // approximate memory held for the id, map nodes included
+
+			EntityInfo()
+				: last_seen(0)
+				, bytes(0)
+			{
+			}
+		};
+
+		// memory held by the per-id entries of State
+		struct Footprint
+		{
+			size_t num_rigidbodies;
+			size_t num_skeletons;
+			size_t bytes;           // sum of EntityInfo::bytes
+			uint64_t num_evicted;   // since setup()
+
+			Footprint()
+				: num_rigidbodies(0)
+				, num_skeletons(0)
+				, bytes(0)
+				, num_evicted(0)
+			{
+			}
+		};
+
+		// latest decoded state, guarded by lock() / unlock()
+		struct State
+		{
+			int frame_number;
+			float latency;
+
+			std::vector<std::vector<Marker> > markers_set;
+			std::vector<Marker> markers;
+			std::vector<Marker> filterd_markers;
+
+			// see Frame::marker_ids, empty while marker tracking is off
+			std::vector<int> marker_ids;
+			std::vector<int> marker_ages;
+
+			// last seen pose per id, see setEviction()
+			std::map<int, RigidBody> rigidbodies;
+			std::map<int, Skeleton> skeletons;
+
+			// same keys as above
+			std::map<int, EntityInfo> rigidbody_info;
+			std::map<int, EntityInfo> skeleton_info;
+
+			size_t entity_bytes;
+			uint64_t num_evicted;
+
+			Descriptions descriptions;
+			int description_version;
+
+			// description slot -> index in markers_set, resolved by name again
+			// when the descriptions or the frame's marker set names change
+			// (count, order or spelling). valid while
+			// markerset_slots_version == description_version.
+			std::vector<int> markerset_slots;
+			int markerset_slots_version;
+
+			State()
+				: frame_number(0)
+				, latency(0)
+				, entity_bytes(0)
+				, num_evicted(0)
+				, description_version(0)
+				, markerset_slots_version(-1)
+			{
+			}
+		};
+
+		// how the receiver thread waits for datagrams
+		enum WaitMode
+		{
+			WAIT_SLEEP,  // polls, then sleeps 1 ms. adds up to ~1 ms latency
+			WAIT_BLOCK,  // blocks on the socket until a datagram or a jitter buffer deadline
+			WAIT_SPIN    // polls for spin_usec before blocking. burns a core
+		};
+
+		// latency distribution in nanoseconds
+		struct LatencyStat
+		{
+			uint64_t count;
+			Nanos last;
+			Nanos min;
+			Nanos max;
+			double mean;
+			double m2;  // sum of squared deviations, see getStdDev()
+
+			LatencyStat()
+				: count(0)
+				, last(0)
+				, min(0)
+				, max(0)
+				, mean(0)
+				, m2(0)
+			{
+			}
+
+			void add(Nanos ns)
+			{
+				if (count == 0 || ns < min) min = ns;
+				if (ns > max) max = ns;
+				last = ns;
+				count++;
+
+				double d = ns - mean;
+				mean += d / count;
+				m2 += d * (ns - mean);
+			}
+
+			inline double getStdDev() const { return count > 1 ? sqrt(m2 / (count - 1)) : 0; }
+		};
+
+		struct LatencyStats
+		{
+			// kernel receive -> receiver thread has the datagram. this is
+			// what the wait mode, affinity and priority change. needs
+			// kernel timestamps (Linux), count stays 0 elsewhere.
+			LatencyStat wake;
+
+			// receiver thread has the datagram -> frame published, i.e.
+			// buffer time + decode + frame callback
+			LatencyStat publish;
+		};
+
+		// called on the decoding thread right after a frame is decoded,
+		// filtered, tracked and its skeletons solved; before it is copied
+		// to the state, the marker index, the history ring and the relay.
+		// the frame is only valid during the call; copy what you need to
+		// keep. must not call back into the client.
+		typedef std::function<void(const Frame&)> FrameCallback;
+
+		// lazy frames: called on the decoding thread with each new view
+		typedef std::function<void(const FrameViewPtr&)> FrameViewCallback;
+
+		Client();
+		~Client();
+
+		bool setup(const std::string& interface_name, const std::string& target_host,
+				   const std::string& multicast_group = "239.255.42.99",
+				   int command_port = 1510, int data_port = 1511);
+
+		// offline decoding
+		//
+		// no sockets and no receiver thread: packets captured from the data
+		// or command port are handed to decodePacket() and decoded
+		// synchronously, the frame callback runs on the calling thread. a
+		// ping response in the stream overrides natnet_major / natnet_minor.
+		void setupOffline(int natnet_major, int natnet_minor);
+		bool decodePacket(const void* data, size_t size);
+
+		void close();
+
+		// set before setup() / setupOffline()
+		inline void setFrameCallback(const FrameCallback& callback) { frame_callback = callback; }
+		inline void setFrameViewCallback(const FrameViewCallback& callback) { frame_view_callback = callback; }
+
+		// block on the command socket for the response. the versions and
+		// descriptions are decoded here and published under the lock; the
+		// receiver thread's parser is never touched.
+		void sendPing();
+		void sendRequestDescription();
+
+		// connected, and a data packet arrived within timeout_sec
+		bool isConnected(float timeout_sec) const;
+
+		// data packets per second, exponential moving average
+		inline double getDataRate() const { return data_rate; }
+
+		// getTimeNanos() of the last data packet, 0 before the first one
+		inline Nanos getLastPacketArrivalNanos() const { return last_packet_arrival; }
+		Nanos getNanosSinceLastPacket() const;
+		inline const std::string& getError() const { return error_str; }
+
+		// data socket receive buffer
+		//
+		// bytes requested, before setup() or while running (1 MB by
+		// default). the kernel may grant less (net.core.rmem_max on Linux);
+		// getReceiveBufferSize() has the granted size, 0 while not set up.
+		void setReceiveBufferSize(int bytes);
+		inline int getRequestedReceiveBufferSize() const { return receive_buffer_request; }
+		inline int getReceiveBufferSize() const { return receive_buffer_size; }
+
+		// doubles the buffer, at most once a second and up to max_bytes,
+		// while the kernel keeps dropping datagrams. 0 disables (default).
+		void setReceiveBufferAutoGrow(int max_bytes);
+		inline int getReceiveBufferAutoGrow() const { return receive_buffer_max; }
+
+		// datagrams the kernel dropped on the data socket since setup()
+		// because the receive buffer was full. Linux only (SO_RXQ_OVFL);
+		// hasKernelDropCounter() is false elsewhere and the count stays 0.
+		inline uint64_t getNumKernelDrops() const { return num_kernel_drops; }
+		inline bool hasKernelDropCounter() const { return kernel_drop_counter; }
+
+		inline void lock() { mutex.lock(); }
+		inline void unlock() { mutex.unlock(); }
+		inline const State& getState() const { return state; }
+
+		// eviction of ids that left the stream, see Eviction. applies from
+		// the next frame.
+		void setEviction(const Eviction& eviction);
+		Eviction getEviction();
+
+		Footprint getFootprint();
+
+		// copies the state's markers and poses into buffer for instanced
+		// drawing, under the lock. from the frame callback, fill it from
+		// the frame instead (PoseBuffer::fill(const Frame&)).
+		void fillPoseBuffer(PoseBuffer& buffer);
+
+		// number of frames decoded so far
+		uint64_t getFrameSerial();
+
+		// blocks until getFrameSerial() != serial. returns false on timeout.
+		// serial is updated to the current value either way. wakes before
+		// the state holds the new frame; lock() / getState() wait for it.
+		bool waitForFrame(uint64_t& serial, float timeout_sec);
+
+		// what the receiver thread decodes, see Subscription. may be
+		// called at any time; applies from the next frame.
+		void setSubscription(const Subscription& subscription);
+		Subscription getSubscription();
+
+		// decodes frames of at least min_frame_bytes with num_threads threads
+		// (the receiver thread included), see Parser::setParallelDecode().
+		// worth it for frames with thousands of markers or hundreds of
+		// bodies; 0 or 1 thread turns it off, the default. applies from
+		// the next frame.
+		void setParallelDecode(int num_threads, size_t min_frame_bytes = 32768);
+		inline int getParallelDecodeThreads() const { return parallel_threads; }
+
+		// decoder settings, see DecodeConfig. may be called from any thread
+		// at any time: each change publishes a new snapshot that the
+		// receiver thread swaps in before its next frame, without locking.
+		void setConfig(const DecodeConfig& config);
+		DecodeConfigPtr getConfig() const;
+
+		void setTransform(const Matrix4x4& m);
+		void setDuplicatedPointRemovalDistance(float v);
+		void setSkeletonLocalCoordinates(bool yn);
+
+		// decode as NatNet major.minor until the next ping response.
+		// applies from the next packet.
+		void setNatNetVersion(int major, int minor);
+
+		// the receiver thread's decoder. its getters are for that thread
+		// and for offline decoding; change settings through the calls above.
+		inline Parser& getParser() { return parser; }
+
+		// pose smoothing on the receiver thread, see RigidBodyFilter. off
+		// until getRigidBodyFilter().setEnabled(true).
+		inline RigidBodyFilter& getRigidBodyFilter() { return filter; }
+
+		// persistent ids for markers across frames on the receiver thread,
+		// see MarkerTracker. off until getMarkerTracker().setEnabled(true).
+		inline MarkerTracker& getMarkerTracker() { return marker_tracker; }
+
+		// receiver thread scheduling
+		//
+		// the thread receives and decodes, so these cover both. settings
+		// take effect on the thread's next iteration; setReceiverAffinity()
+		// and setReceiverPriority() log a warning when the OS refuses.
+		void setWaitMode(WaitMode mode, int spin_usec = 200);
+		inline WaitMode getWaitMode() const { return (WaitMode)wait_mode.load(); }
+
+		void setReceiverAffinity(int cpu);         // core index, -1 for any core
+		void setReceiverPriority(int priority);    // SCHED_FIFO 1..99, 0 for normal
+		void setBusyPoll(int usec);                // SO_BUSY_POLL on the data socket, Linux
+
+		LatencyStats getLatencyStats();
+		void resetLatencyStats();
+
+		// lazy frames
+		//
+		// the receiver thread only indexes each frame packet and publishes
+		// a FrameView of it; consumers decode what they read. this skips
+		// parseFrame() and everything built on it: the poses in State
+		// (frame_number and latency are still set), skeleton solving,
+		// filtering, tracking changes, the frame history, the relay and the
+		// frame callback. descriptions are decoded as usual.
+		void setLazyFrames(bool yn);
+		inline bool getLazyFrames() const { return lazy_frames; }
+
+		// newest view, empty before the first one or when not lazy
+		FrameViewPtr getFrameView();
+
+		// spatial indices over each frame's markers, see MarkerIndex. built
+		// on the receiver thread when enabled (off by default), right after
+		// the state is published, so they may trail it by a frame; compare
+		// MarkerIndex::getFrameNumber(). the indices returned stay valid and
+		// unchanged while held. not built for lazy frames.
+		void setMarkerIndexEnabled(bool yn);
+		inline bool isMarkerIndexEnabled() const { return marker_index_enabled; }
+
+		// over State::markers (unlabeled, then labeled markers) and
+		// State::filterd_markers. empty while disabled.
+		MarkerIndexPtr getMarkerIndex(bool filterd = false);
+
+		// coalescing: each time the receiver thread runs it takes every
+		// datagram waiting in the kernel and decodes only the newest due
+		// frame, skipping the older ones. keeps the published state as fresh
+		// as possible under bursts; the frame callback, history and relay
+		// then see only the frames that were decoded.
+		void setCoalesceFrames(bool yn);
+		inline bool getCoalesceFrames() const { return coalesce_frames; }
+		inline uint64_t getNumCoalescedFrames() const { return num_coalesced_frames; }
+
+		// jitter buffer: packets are decoded this long after they arrived
+		void setBufferTime(float sec);
+		inline float getBufferTime() const { return nanosToSeconds(buffer_time); }
+
+		// frame history, see ofxNatNetFrameRing
+		void setFrameHistorySize(size_t num_frames, size_t max_frame_bytes = 0x10000);
+		size_t getFrameHistorySize();
+		ofxNatNetFrameRing::Reader createFrameReader();
+
+		// relay, see ofxNatNetCompactFrame / ofxNatNetSharedMemory
+		bool setRelaySharedMemory(const std::string& name, size_t num_frames = 64,
+								  size_t max_frame_bytes = 0x10000);
+		void closeRelaySharedMemory();
+
+		bool addRelayTarget(const std::string& host, int port);
+		void clearRelayTargets();
+
+		inline size_t getNumRelayDrops() const { return num_relay_drops; }
+
+	private:
+		struct Packet
+		{
+			Nanos arrival;
+			size_t size;  // datagram length
+			PacketPool::Buffer data;
+		};
+
+		Parser parser;
+		RigidBodyFilter filter;
+		MarkerTracker marker_tracker;
+
+		std::atomic<bool> connected;
+		std::string error_str;
+
+		UdpSocket data_socket;
+		UdpSocket command_socket;
+
+		std::thread thread;
+		std::atomic<bool> running;
+
+		std::atomic<int> wait_mode;
+		std::atomic<int> spin_usec;
+		std::atomic<int> receiver_cpu;
+		std::atomic<int> receiver_priority;
+		std::atomic<int> busy_poll_usec;
+		std::atomic<int> thread_settings_version;
+		int thread_settings_applied;  // receiver thread
+
+		std::mutex stats_mutex;
+		LatencyStats latency_stats;
+
+		// guarded by mutex, handed to the parser when the version moves
+		Subscription subscription;
+		std::atomic<int> subscription_version;
+		int subscription_applied;  // receiver thread
+
+		// decoder snapshot, swapped with atomic_store / atomic_load.
+		// config_mutex only orders the writers' read-modify-write.
+		DecodeConfigPtr config;
+		std::mutex config_mutex;
+		std::atomic<int> config_version;
+		int config_applied;  // receiver thread
+
+		// server protocol from sendPing() / setNatNetVersion(), guarded
+		// by mutex, handed to the parser when the version moves
+		int natnet_version[2];
+		int server_version[2];
+		uint64_t server_clock_frequency;
+		std::atomic<int> protocol_version;
+		int protocol_applied;  // receiver thread
+
+		// same for the parallel decoder
+		std::atomic<int> parallel_threads;
+		size_t parallel_min_bytes;
+		std::atomic<int> parallel_version;
+		int parallel_applied;  // receiver thread
+
+		// state.description_version, mirrored so the receiver thread
+		// copies the descriptions it solves skeletons against only when
+		// they change, and never solves under the lock
+		std::atomic<int> descriptions_version;
+		Descriptions solve_descriptions;  // receiver thread
+		int solve_descriptions_applied;   // receiver thread
+
+		std::atomic<bool> coalesce_frames;
+		std::atomic<uint64_t> num_coalesced_frames;
+
+		std::atomic<Nanos> buffer_time;
+		std::deque<Packet> buffer;
+		PacketPool packet_pool;
+
+		std::atomic<Nanos> last_packet_arrival;
+		std::atomic<double> data_rate;
+
+		std::atomic<int> receive_buffer_request;
+		std::atomic<int> receive_buffer_size;
+		std::atomic<int> receive_buffer_max;
+		std::atomic<bool> receive_buffer_stuck;  // granted size stopped growing
+		std::atomic<uint64_t> num_kernel_drops;
+		std::atomic<bool> kernel_drop_counter;
+
+		// receiver thread
+		int receive_buffer_applied;
+		uint32_t last_socket_drops;
+		Nanos last_buffer_grow;
+
+		// guards state and the frame ring / relay settings
+		std::mutex mutex;
+		State state;
+		std::vector<std::string> markerset_slot_names;  // the frame names state.markerset_slots was resolved from
+		Eviction eviction;
+
+		FrameCallback frame_callback;
+		FrameViewCallback frame_view_callback;
+
+		std::atomic<bool> lazy_frames;
+		FrameViewPtr frame_view;  // guarded by mutex
+
+		std::atomic<bool> marker_index_enabled;
+		MarkerIndexPool marker_index_pool;
+		MarkerIndexPtr marker_index;          // guarded by mutex
+		MarkerIndexPtr filterd_marker_index;  // guarded by mutex
+
+		Frame frame;
+		std::vector<char> packet_buffer;
+
+		// rigid body ids and active states of the previous frame, in frame order
+		std::vector<int> tracking_ids;
+		std::vector<unsigned char> tracking_active;
+
+		std::shared_ptr<ofxNatNetFrameRing> frame_ring;
+		std::vector<char> compact_buffer;
+
+		std::shared_ptr<ofxNatNetSharedMemory> relay_memory;
+		std::vector<Address> relay_targets;
+		UdpSocket relay_socket;
+		std::atomic<size_t> num_relay_drops;
+
+		// incremented for every decoded frame, guarded by frame_mutex
+		uint64_t frame_serial;
+		std::mutex frame_mutex;
+		std::condition_variable frame_condition;
+
+		void threadedFunction();
+		void applyThreadSettings();
+		void applyDecodeSettings();
+		bool waitForPacket(WaitMode mode);
+		void receivePacket(Nanos t);
+		void decodeDuePackets(Nanos target_time);
+		void decodeNewestDuePacket(Nanos target_time);
+		void applyReceiveBufferSize(int size);
+		void countKernelDrops(Nanos t);
+		void unpack(const char* packet, size_t size, Nanos arrival);
+		void unpack(const Packet& packet);
+		void publishFrameView(const PacketPool::Buffer& packet, Nanos arrival);
+		void publishDescriptions(const Descriptions& descriptions);
+		void updateTrackingChanges();
+		void solveSkeletons();
+		void publishFrame();
+		void storeEntities();
+		void evictEntities();
+		void packCompactFrame();
+		void relayCompactFrame(const std::shared_ptr<ofxNatNetSharedMemory>& memory,
+							   const std::vector<Address>& targets);
+
+		Client(const Client&);
+		Client& operator=(const Client&);
+	};
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+
+// monotonic time for everything in the receive path. 64-bit nanoseconds
+// keep full resolution for centuries of uptime, where float seconds fall
+// to millisecond steps after a few hours.
+
+namespace NatNet
+{
+	typedef int64_t Nanos;
+
+	static const Nanos NANOS_PER_SECOND = 1000000000;
+
+	// steady clock, arbitrary epoch; only differences are meaningful
+	inline Nanos getTimeNanos()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// system clock, unix epoch. only for comparing with kernel timestamps
+	inline Nanos getWallTimeNanos()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	inline Nanos secondsToNanos(double sec) { return (Nanos)(sec * NANOS_PER_SECOND); }
+	inline double nanosToSeconds(Nanos ns) { return ns / (double)NANOS_PER_SECOND; }
+}
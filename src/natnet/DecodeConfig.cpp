@@ -0,0 +1,57 @@
+#include "DecodeConfig.h"
+
+#include <string.h>
+
+namespace NatNet
+{
+	DecodeConfig::DecodeConfig()
+		: duplicated_point_removal_distance(0)
+		, skeleton_local_coordinates(true)
+	{
+		setTransform(identityMatrix());
+	}
+
+	void DecodeConfig::setTransform(const Matrix4x4& m)
+	{
+		transform = m;
+		rotation = getRotate(m);
+		scale = NatNet::getScale(m);
+		translation = NatNet::getTranslation(m);
+
+		const float* e = m.m;
+
+		// no rotation, shear, mirroring or projection
+		axis_aligned = e[1] == 0 && e[2] == 0 && e[3] == 0
+			&& e[4] == 0 && e[6] == 0 && e[7] == 0
+			&& e[8] == 0 && e[9] == 0 && e[11] == 0
+			&& e[0] > 0 && e[5] > 0 && e[10] > 0 && e[15] == 1;
+
+		if (axis_aligned)
+		{
+			// exact, for the scale-only kernel
+			rotation = identityQuat();
+			scale = makeVec3(e[0], e[5], e[10]);
+		}
+
+		uniform_scale = scale.x == scale.y && scale.y == scale.z;
+
+		identity = axis_aligned && uniform_scale && scale.x == 1
+			&& translation.x == 0 && translation.y == 0 && translation.z == 0;
+	}
+
+	void DecodeConfig::transformPoints(const char* data, int count, Vec3* out) const
+	{
+		if (identity)
+		{
+			memcpy(out, data, count * sizeof(Vec3));
+			return;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			Vec3 p;
+			memcpy(&p, data + i * sizeof(Vec3), sizeof(p));
+			out[i] = transformPoint(p);
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+
+#include "Types.h"
+
+// decoder settings as one immutable snapshot.
+//
+// the parser decodes every frame against a single snapshot, and changing
+// a setting means publishing a new one (see Client::setTransform()), so
+// the decoding thread neither locks nor sees a half-written transform.
+// the transform is decomposed once per snapshot, and flags pick cheaper
+// point transforms for the common identity / scale-only cases.
+
+namespace NatNet
+{
+	class DecodeConfig
+	{
+	public:
+		DecodeConfig();
+
+		void setTransform(const Matrix4x4& m);
+		inline const Matrix4x4& getTransform() const { return transform; }
+
+		// decomposition of the transform
+		inline const Quat& getRotation() const { return rotation; }
+		inline const Vec3& getScale() const { return scale; }
+		inline const Vec3& getTranslation() const { return translation; }
+
+		inline bool isIdentity() const { return identity; }
+		inline bool isAxisAligned() const { return axis_aligned; }  // positive scale and translation only
+		inline bool isUniformScale() const { return uniform_scale; }
+
+		inline void setDuplicatedPointRemovalDistance(float v) { duplicated_point_removal_distance = v < 0 ? 0 : v; }
+		inline float getDuplicatedPointRemovalDistance() const { return duplicated_point_removal_distance; }
+
+		// see Parser::setSkeletonLocalCoordinates()
+		inline void setSkeletonLocalCoordinates(bool yn) { skeleton_local_coordinates = yn; }
+		inline bool getSkeletonLocalCoordinates() const { return skeleton_local_coordinates; }
+
+		inline Vec3 transformPoint(const Vec3& p) const
+		{
+			if (identity) return p;
+			if (axis_aligned)
+				return makeVec3(p.x * scale.x + translation.x, p.y * scale.y + translation.y,
+								p.z * scale.z + translation.z);
+			return NatNet::transformPoint(transform, p);
+		}
+
+		// count points stored as packed floats at data
+		void transformPoints(const char* data, int count, Vec3* out) const;
+
+		// streamed orientation in the output frame
+		inline Quat transformRotation(const Quat& q) const
+		{
+			return axis_aligned ? q : compose(q, rotation);
+		}
+
+	private:
+		Matrix4x4 transform;
+		Quat rotation;
+		Vec3 scale;
+		Vec3 translation;
+
+		bool identity;
+		bool axis_aligned;
+		bool uniform_scale;
+
+		float duplicated_point_removal_distance;
+		bool skeleton_local_coordinates;
+	};
+
+	typedef std::shared_ptr<const DecodeConfig> DecodeConfigPtr;
+}
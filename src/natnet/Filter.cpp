@@ -0,0 +1,210 @@
+#include "Filter.h"
+
+#include <math.h>
+
+using namespace std;
+
+namespace NatNet
+{
+	enum SlotState
+	{
+		SLOT_EMPTY,
+		SLOT_TRACKING,
+		SLOT_HOLDING  // tracking lost, last pose held
+	};
+
+	static const float TWO_PI = 6.28318530717958647692f;
+
+	// restart instead of smoothing across gaps longer than this
+	static const double MAX_GAP = 0.5;
+
+	static inline float smoothingFactor(float cutoff, float dt)
+	{
+		float tau = 1.0f / (TWO_PI * cutoff);
+		return 1.0f / (1.0f + tau / dt);
+	}
+
+	RigidBodyFilter::RigidBodyFilter()
+		: enabled(false)
+		, settings_version(0)
+		, reset_requested(false)
+		, applied_version(-1)
+	{
+	}
+
+	void RigidBodyFilter::setEnabled(bool yn)
+	{
+		if (yn && !enabled) reset();
+		enabled = yn;
+	}
+
+	void RigidBodyFilter::setDefaultSettings(const Settings& settings)
+	{
+		lock_guard<mutex> guard(settings_mutex);
+		default_settings = settings;
+		settings_version++;
+	}
+
+	RigidBodyFilter::Settings RigidBodyFilter::getDefaultSettings()
+	{
+		lock_guard<mutex> guard(settings_mutex);
+		return default_settings;
+	}
+
+	void RigidBodyFilter::setSettings(int id, const Settings& settings)
+	{
+		lock_guard<mutex> guard(settings_mutex);
+		id_settings[id] = settings;
+		settings_version++;
+	}
+
+	void RigidBodyFilter::clearSettings(int id)
+	{
+		lock_guard<mutex> guard(settings_mutex);
+		id_settings.erase(id);
+		settings_version++;
+	}
+
+	void RigidBodyFilter::clearAllSettings()
+	{
+		lock_guard<mutex> guard(settings_mutex);
+		id_settings.clear();
+		settings_version++;
+	}
+
+	void RigidBodyFilter::reset() { reset_requested = true; }
+
+	void RigidBodyFilter::refreshSettings()
+	{
+		{
+			lock_guard<mutex> guard(settings_mutex);
+			applied_default = default_settings;
+			applied_settings = id_settings;
+			applied_version = settings_version;
+		}
+
+		unordered_map<int, int>::const_iterator it = slot_by_id.begin();
+		for (; it != slot_by_id.end(); ++it)
+		{
+			unordered_map<int, Settings>::const_iterator s = applied_settings.find(it->first);
+			slot_settings[it->second] = s != applied_settings.end() ? s->second : applied_default;
+		}
+	}
+
+	int RigidBodyFilter::getSlot(int id)
+	{
+		unordered_map<int, int>::const_iterator it = slot_by_id.find(id);
+		if (it != slot_by_id.end()) return it->second;
+
+		int slot = initialized.size();
+		slot_by_id[id] = slot;
+
+		unordered_map<int, Settings>::const_iterator s = applied_settings.find(id);
+		slot_settings.push_back(s != applied_settings.end() ? s->second : applied_default);
+		initialized.push_back(SLOT_EMPTY);
+		last_time.push_back(0);
+		px.push_back(0);
+		py.push_back(0);
+		pz.push_back(0);
+		dx.push_back(0);
+		dy.push_back(0);
+		dz.push_back(0);
+		qx.push_back(0);
+		qy.push_back(0);
+		qz.push_back(0);
+		qw.push_back(1);
+		angular_speed.push_back(0);
+		return slot;
+	}
+
+	void RigidBodyFilter::apply(vector<RigidBody>& rigidbodies, double time, const DecodeConfig& config)
+	{
+		if (reset_requested.exchange(false))
+		{
+			slot_by_id.clear();
+			slot_settings.clear();
+			initialized.clear();
+			last_time.clear();
+			px.clear(); py.clear(); pz.clear();
+			dx.clear(); dy.clear(); dz.clear();
+			qx.clear(); qy.clear(); qz.clear(); qw.clear();
+			angular_speed.clear();
+		}
+
+		if (applied_version != settings_version) refreshSettings();
+
+		for (int i = 0; i < rigidbodies.size(); i++)
+		{
+			RigidBody& RB = rigidbodies[i];
+			int s = getSlot(RB.id);
+			const Settings& settings = slot_settings[s];
+
+			if (!settings.enabled)
+			{
+				initialized[s] = SLOT_EMPTY;
+				continue;
+			}
+
+			if (!RB.active)
+			{
+				if (initialized[s] == SLOT_EMPTY) continue;
+
+				// hold the last filtered pose, restart on reacquire
+				initialized[s] = SLOT_HOLDING;
+				RB.position = config.transformPoint(makeVec3(px[s], py[s], pz[s]));
+				RB.orientation = config.transformRotation(makeQuat(qx[s], qy[s], qz[s], qw[s]));
+				continue;
+			}
+
+			const Vec3& p = RB.raw_position;
+			Quat q = RB.raw_orientation;
+
+			double dt = time - last_time[s];
+			last_time[s] = time;
+
+			if (initialized[s] != SLOT_TRACKING || dt <= 0 || dt > MAX_GAP)
+			{
+				initialized[s] = SLOT_TRACKING;
+				px[s] = p.x; py[s] = p.y; pz[s] = p.z;
+				dx[s] = 0; dy[s] = 0; dz[s] = 0;
+				qx[s] = q.x; qy[s] = q.y; qz[s] = q.z; qw[s] = q.w;
+				angular_speed[s] = 0;
+				continue;
+			}
+
+			float t = (float)dt;
+
+			// noisier bodies get lower cutoffs
+			float k = 1;
+			if (settings.error_reference > 0)
+				k = 1 / (1 + RB.mean_marker_error / settings.error_reference);
+
+			float ad = smoothingFactor(settings.derivative_cutoff, t);
+
+			// position
+			dx[s] += ad * ((p.x - px[s]) / t - dx[s]);
+			dy[s] += ad * ((p.y - py[s]) / t - dy[s]);
+			dz[s] += ad * ((p.z - pz[s]) / t - dz[s]);
+
+			float speed = sqrtf(dx[s] * dx[s] + dy[s] * dy[s] + dz[s] * dz[s]);
+			float a = smoothingFactor((settings.min_cutoff + settings.beta * speed) * k, t);
+
+			px[s] += a * (p.x - px[s]);
+			py[s] += a * (p.y - py[s]);
+			pz[s] += a * (p.z - pz[s]);
+
+			// rotation
+			Quat prev = makeQuat(qx[s], qy[s], qz[s], qw[s]);
+			angular_speed[s] += ad * (angleBetween(prev, q) / t - angular_speed[s]);
+
+			float ar = smoothingFactor(
+				(settings.rotation_min_cutoff + settings.rotation_beta * angular_speed[s]) * k, t);
+			q = slerp(prev, q, ar);
+
+			qx[s] = q.x; qy[s] = q.y; qz[s] = q.z; qw[s] = q.w;
+
+			RB.position = config.transformPoint(makeVec3(px[s], py[s], pz[s]));
+			RB.orientation = config.transformRotation(q);
+		}
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "DecodeConfig.h"
+#include "Frame.h"
+
+// optional smoothing of rigid body poses, run by the client on the
+// decoding thread before a frame is published.
+//
+// position uses a One-Euro filter (a low pass whose cutoff rises with
+// speed: steady when still, little lag when moving), rotation the same
+// scheme with slerp and angular speed. cutoffs drop as mean_marker_error
+// grows, and a body that loses tracking holds its last filtered pose and
+// restarts from the next tracked sample.
+//
+// per-body state is kept as parallel arrays indexed by slot.
+
+namespace NatNet
+{
+	class RigidBodyFilter
+	{
+	public:
+		struct Settings
+		{
+			bool enabled;
+
+			float min_cutoff;           // Hz, position cutoff at rest
+			float beta;                 // Hz added per m/s of speed
+			float rotation_min_cutoff;  // Hz, rotation cutoff at rest
+			float rotation_beta;        // Hz added per rad/s of angular speed
+			float derivative_cutoff;    // Hz, smoothing of the speed estimates
+
+			// mean marker error (m) at which the cutoffs are halved, 0 ignores the error
+			float error_reference;
+
+			Settings()
+				: enabled(true)
+				, min_cutoff(1.0f)
+				, beta(1.0f)
+				, rotation_min_cutoff(1.0f)
+				, rotation_beta(0.5f)
+				, derivative_cutoff(1.0f)
+				, error_reference(0)
+			{
+			}
+		};
+
+		RigidBodyFilter();
+
+		// the settings calls may come from any thread; they reach the
+		// decoding thread on its next frame
+
+		// off by default; the per-id settings still decide per body
+		void setEnabled(bool yn);
+		inline bool isEnabled() const { return enabled; }
+
+		void setDefaultSettings(const Settings& settings);
+		Settings getDefaultSettings();
+
+		void setSettings(int id, const Settings& settings);
+		void clearSettings(int id);
+		void clearAllSettings();
+
+		// drops the filter state of every body, on the next frame
+		void reset();
+
+		// decoding thread. filters raw_position / raw_orientation and
+		// writes the result to position / orientation with config's
+		// transform; raw_* keep the streamed values. time in seconds.
+		void apply(std::vector<RigidBody>& rigidbodies, double time, const DecodeConfig& config);
+
+	private:
+		std::atomic<bool> enabled;
+
+		// written by the setters, copied by apply() when settings_version moves
+		std::mutex settings_mutex;
+		Settings default_settings;
+		std::unordered_map<int, Settings> id_settings;
+		std::atomic<int> settings_version;
+		std::atomic<bool> reset_requested;
+
+		// decoding thread only
+		int applied_version;
+		Settings applied_default;
+		std::unordered_map<int, Settings> applied_settings;
+
+		std::unordered_map<int, int> slot_by_id;
+
+		std::vector<Settings> slot_settings;
+		std::vector<unsigned char> initialized;
+		std::vector<double> last_time;
+		std::vector<float> px, py, pz;     // filtered position
+		std::vector<float> dx, dy, dz;     // filtered velocity
+		std::vector<float> qx, qy, qz, qw; // filtered orientation
+		std::vector<float> angular_speed;  // filtered, rad/s
+
+		int getSlot(int id);
+		void refreshSettings();
+	};
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Types.h"
+
+// decoded NatNet data, shared by the parser, the client and the
+// openFrameworks adapter. positions and matrices are in the client's
+// output space (the transform applied); raw_* keep the streamed values.
+
+namespace NatNet
+{
+	typedef Vec3 Marker;
+
+	struct RigidBody
+	{
+		int id;
+
+		// pose with the output transform applied. matrices are built on
+		// request: getMatrix(), Frame::getRigidBodyMatrices() or
+		// makePoseMatrices() for a batch.
+		Vec3 position;
+		Quat orientation;
+
+		std::vector<Marker> markers;
+
+		float mean_marker_error;
+		bool active;  // tracked in this frame (NatNet 2.6+), mean_marker_error > 0 before
+
+		Vec3 raw_position;
+		Quat raw_orientation;
+
+		RigidBody()
+			: id(0)
+			, position(makeVec3(0, 0, 0))
+			, orientation(identityQuat())
+			, mean_marker_error(0)
+			, active(false)
+			, raw_position(makeVec3(0, 0, 0))
+			, raw_orientation(identityQuat())
+		{
+		}
+
+		inline Matrix4x4 getMatrix() const { return makePoseMatrix(position, orientation); }
+	};
+
+	struct Skeleton
+	{
+		int id;
+		std::vector<RigidBody> joints;
+
+		// solved joint transforms, indexed like SkeletonDescription::joints.
+		// empty until the skeleton description has been received.
+		std::vector<Matrix4x4> local_matrices;
+		std::vector<Matrix4x4> world_matrices;
+
+		Skeleton()
+			: id(0)
+		{
+		}
+	};
+
+	struct RigidBodyDescription
+	{
+		std::string name;
+		int id;
+		int parent_id;
+		Vec3 offset;
+
+		// 3.0 and later: marker positions in the body's frame, names from 4.0
+		std::vector<Vec3> marker_offsets;
+		std::vector<std::string> marker_names;
+
+		RigidBodyDescription()
+			: id(0)
+			, parent_id(-1)
+			, offset(makeVec3(0, 0, 0))
+		{
+		}
+	};
+
+	struct SkeletonDescription
+	{
+		std::string name;
+		int id;
+		std::vector<RigidBodyDescription> joints;
+
+		// precomputed hierarchy, indices into joints
+		std::vector<int> parent_indices;     // -1 for roots
+		std::vector<int> joint_order;        // parents always precede their children
+		std::vector<int> joint_index_by_id;  // (joint id & 0xffff) -> index, -1 if unused
+
+		SkeletonDescription()
+			: id(0)
+		{
+		}
+	};
+
+	struct MarkerSetDescription
+	{
+		std::string name;
+		std::vector<std::string> marker_names;
+	};
+
+	typedef std::unordered_map<std::string, int> NameIndex;
+
+	struct Descriptions
+	{
+		std::vector<MarkerSetDescription> markersets;
+		std::vector<RigidBodyDescription> rigidbodies;
+		std::vector<SkeletonDescription> skeletons;
+
+		// name -> index in the vectors above, first description wins
+		NameIndex markerset_index;
+		NameIndex rigidbody_index;
+		NameIndex skeleton_index;
+
+		// skeleton id -> index in skeletons
+		std::map<int, int> skeleton_index_by_id;
+
+		void buildIndex();
+	};
+
+	inline bool testBit(const std::vector<uint64_t>& bits, int index)
+	{
+		return (bits[index >> 6] >> (index & 63)) & 1;
+	}
+
+	struct Frame
+	{
+		int frame_number;
+		float latency;
+		double timestamp;  // server timestamp in seconds
+		unsigned int timecode;
+		unsigned int timecode_sub;
+
+		// getTimeNanos() when the packet was received
+		int64_t arrival;
+
+		std::vector<std::vector<Marker> > markers_set;
+		// point into the datagram: only valid while the frame is, i.e. for
+		// the duration of the frame callback. copy them into strings to keep
+		std::vector<const char*> markerset_names;
+		std::vector<Marker> markers;  // unlabeled, then labeled (2.3 and later)
+		std::vector<Marker> filterd_markers;
+		std::vector<RigidBody> rigidbodies;
+		std::vector<Skeleton> skeletons;
+
+		// markers[0, num_unlabeled_markers) are the unlabeled ones
+		int num_unlabeled_markers;
+
+		// MarkerTracker output, parallel to the unlabeled markers: the
+		// persistent id of each marker (-1 untracked) and the frames since
+		// its track started. empty while tracking is off.
+		std::vector<int> marker_ids;
+		std::vector<int> marker_ages;
+
+		// rigid bodies whose active state changed since the previous frame,
+		// one bit per index in rigidbodies (see testBit). a body seen for
+		// the first time counts as gained when it is active.
+		std::vector<uint64_t> tracking_gained;
+		std::vector<uint64_t> tracking_lost;
+		int num_tracking_changes;
+
+		// rigidbodies[i].getMatrix() for every body, built in one batch on
+		// the first call and cached until the frame is decoded again (or
+		// invalidateMatrices()). not safe to call concurrently on one frame.
+		inline const std::vector<Matrix4x4>& getRigidBodyMatrices() const
+		{
+			if (!matrices_valid)
+			{
+				rigidbody_matrices.resize(rigidbodies.size());
+				if (rigidbodies.size())
+					makePoseMatrices(&rigidbodies[0].position, sizeof(RigidBody),
+									 &rigidbodies[0].orientation, sizeof(RigidBody),
+									 rigidbodies.size(), rigidbody_matrices.data());
+				matrices_valid = true;
+			}
+			return rigidbody_matrices;
+		}
+
+		inline const Matrix4x4& getRigidBodyMatrix(int index) const { return getRigidBodyMatrices()[index]; }
+
+		// after changing poses in rigidbodies
+		inline void invalidateMatrices() { matrices_valid = false; }
+
+		// cache for getRigidBodyMatrices()
+		mutable std::vector<Matrix4x4> rigidbody_matrices;
+		mutable bool matrices_valid;
+
+		Frame()
+			: frame_number(0)
+			, latency(0)
+			, timestamp(0)
+			, timecode(0)
+			, timecode_sub(0)
+			, arrival(0)
+			, num_unlabeled_markers(0)
+			, num_tracking_changes(0)
+			, matrices_valid(false)
+		{
+		}
+	};
+}
@@ -0,0 +1,96 @@
+#include "FrameView.h"
+
+#include <string.h>
+
+#include "Parser.h"
+
+using namespace std;
+
+namespace NatNet
+{
+	FrameView::FrameView()
+		: data(NULL)
+		, major(0)
+		, minor(0)
+		, frame_number(0)
+		, latency(0)
+		, timestamp(0)
+		, timecode(0)
+		, timecode_sub(0)
+		, arrival(0)
+		, labeled_marker_stride(0)
+	{
+	}
+
+	Marker FrameView::readMarker(uint32_t offset) const
+	{
+		Vec3 p;
+		memcpy(&p, data + offset, sizeof(p));
+		return config->transformPoint(p);
+	}
+
+	Marker FrameView::getMarkerSetMarker(int set, int index) const
+	{
+		return readMarker(markersets[set].offset + index * sizeof(Vec3));
+	}
+
+	void FrameView::getMarkerSetMarkers(int set, vector<Marker>& markers) const
+	{
+		const MarkerSetSection& s = markersets[set];
+		markers.resize(s.count);
+		if (s.count) config->transformPoints(data + s.offset, s.count, markers.data());
+	}
+
+	Marker FrameView::getMarker(int index) const
+	{
+		return readMarker(markers.offset + index * sizeof(Vec3));
+	}
+
+	int FrameView::getLabeledMarkerId(int index) const
+	{
+		int id = 0;
+		memcpy(&id, data + labeled_markers.offset + index * labeled_marker_stride, sizeof(id));
+		return id;
+	}
+
+	Marker FrameView::getLabeledMarker(int index) const
+	{
+		return readMarker(labeled_markers.offset + index * labeled_marker_stride + sizeof(int));
+	}
+
+	int FrameView::findRigidBody(int id) const
+	{
+		for (int i = 0; i < rigidbodies.size(); i++)
+			if (rigidbodies[i].id == id) return i;
+		return -1;
+	}
+
+	void FrameView::getRigidBody(int index, RigidBody& RB, bool decode_markers) const
+	{
+		Parser::unpackRigidBody(data + rigidbodies[index].offset, RB, major, minor, *config, decode_markers);
+	}
+
+	int FrameView::findSkeleton(int id) const
+	{
+		for (int i = 0; i < skeletons.size(); i++)
+			if (skeletons[i].id == id) return i;
+		return -1;
+	}
+
+	void FrameView::getSkeleton(int index, Skeleton& S) const
+	{
+		const char* ptr = data + skeletons[index].offset;
+
+		int nJoints = 0;
+		memcpy(&nJoints, ptr, sizeof(nJoints));
+		ptr += sizeof(nJoints);
+
+		S.id = skeletons[index].id;
+		S.joints.resize(nJoints);
+		S.local_matrices.clear();
+		S.world_matrices.clear();
+
+		for (int i = 0; i < nJoints; i++)
+			ptr = Parser::unpackRigidBody(ptr, S.joints[i], major, minor, *config, true);
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "Clock.h"
+#include "DecodeConfig.h"
+#include "Frame.h"
+#include "PacketPool.h"
+
+// a frame of data read in place from the datagram it arrived in.
+//
+// Parser::indexFrame() walks the packet once and records where each
+// section and entity starts; the accessors decode just what they are asked
+// for, applying the DecodeConfig the parser had when the view was built.
+// the view keeps its packet buffer and config alive and is immutable, so
+// it can be shared across threads.
+
+namespace NatNet
+{
+	class FrameView
+	{
+	public:
+		FrameView();
+
+		inline int getFrameNumber() const { return frame_number; }
+		inline float getLatency() const { return latency; }
+		inline double getTimestamp() const { return timestamp; }
+		inline unsigned int getTimecode() const { return timecode; }
+		inline unsigned int getTimecodeSub() const { return timecode_sub; }
+		inline Nanos getArrival() const { return arrival; }
+
+		// marker sets
+		inline int getNumMarkerSets() const { return markersets.size(); }
+		inline const char* getMarkerSetName(int set) const { return data + markersets[set].name; }
+		inline int getNumMarkerSetMarkers(int set) const { return markersets[set].count; }
+		Marker getMarkerSetMarker(int set, int index) const;
+		void getMarkerSetMarkers(int set, std::vector<Marker>& markers) const;
+
+		// unlabeled markers
+		inline int getNumMarkers() const { return markers.count; }
+		Marker getMarker(int index) const;
+
+		// labeled markers (NatNet 2.3+)
+		inline int getNumLabeledMarkers() const { return labeled_markers.count; }
+		int getLabeledMarkerId(int index) const;
+		Marker getLabeledMarker(int index) const;
+
+		// rigid bodies, in stream order
+		inline int getNumRigidBodies() const { return rigidbodies.size(); }
+		inline int getRigidBodyId(int index) const { return rigidbodies[index].id; }
+		int findRigidBody(int id) const;  // index, -1 if absent
+		void getRigidBody(int index, RigidBody& RB, bool decode_markers = true) const;
+
+		// skeletons, joints only; see Parser::solveSkeleton()
+		inline int getNumSkeletons() const { return skeletons.size(); }
+		inline int getSkeletonId(int index) const { return skeletons[index].id; }
+		int findSkeleton(int id) const;
+		void getSkeleton(int index, Skeleton& S) const;
+
+		inline const PacketPool::Buffer& getPacket() const { return packet; }
+
+	private:
+		friend class Parser;
+		friend class Client;
+
+		// offsets into the packet
+		struct Section
+		{
+			uint32_t offset;
+			int count;
+
+			Section()
+				: offset(0)
+				, count(0)
+			{
+			}
+		};
+
+		struct MarkerSetSection
+		{
+			uint32_t name;
+			uint32_t offset;
+			int count;
+		};
+
+		struct Entity
+		{
+			int id;
+			uint32_t offset;
+		};
+
+		PacketPool::Buffer packet;
+		const char* data;
+
+		int major;
+		int minor;
+		DecodeConfigPtr config;
+
+		int frame_number;
+		float latency;
+		double timestamp;
+		unsigned int timecode;
+		unsigned int timecode_sub;
+		Nanos arrival;
+
+		std::vector<MarkerSetSection> markersets;
+		Section markers;
+		Section labeled_markers;
+		uint32_t labeled_marker_stride;
+		std::vector<Entity> rigidbodies;
+		std::vector<Entity> skeletons;  // offset of the joint count
+
+		Marker readMarker(uint32_t offset) const;
+	};
+
+	typedef std::shared_ptr<const FrameView> FrameViewPtr;
+}
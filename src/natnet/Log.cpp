@@ -0,0 +1,35 @@
+#include "Log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <atomic>
+
+namespace NatNet
+{
+	static void defaultHandler(LogLevel level, const char* message)
+	{
+		static const char* names[] = { "verbose", "notice", "warning", "error" };
+		fprintf(stderr, "[natnet %s] %s\n", names[level], message);
+	}
+
+	static std::atomic<LogHandler> log_handler(defaultHandler);
+
+	void setLogHandler(LogHandler handler)
+	{
+		log_handler = handler ? handler : defaultHandler;
+	}
+
+	void logMessage(LogLevel level, const char* format, ...)
+	{
+		char message[1024];
+
+		va_list args;
+		va_start(args, format);
+		vsnprintf(message, sizeof(message), format, args);
+		va_end(args);
+
+		LogHandler handler = log_handler;
+		handler(level, message);
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+// minimal logging for the core. messages go to stderr unless a handler is
+// installed (the openFrameworks adapter forwards them to ofLog).
+
+namespace NatNet
+{
+	enum LogLevel
+	{
+		LOG_VERBOSE,
+		LOG_NOTICE,
+		LOG_WARNING,
+		LOG_ERROR
+	};
+
+	typedef void (*LogHandler)(LogLevel level, const char* message);
+
+	// NULL restores the default stderr handler
+	void setLogHandler(LogHandler handler);
+
+	void logMessage(LogLevel level, const char* format, ...)
+#if defined(__GNUC__)
+		__attribute__((format(printf, 2, 3)))
+#endif
+		;
+}
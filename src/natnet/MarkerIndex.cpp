@@ -0,0 +1,185 @@
+#include "MarkerIndex.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace NatNet
+{
+	static inline float component(const Vec3& v, int axis) { return (&v.x)[axis]; }
+
+	static inline float distanceSquared(const Vec3& a, const Vec3& b) { return lengthSquared(a - b); }
+
+	MarkerIndex::MarkerIndex()
+		: frame_number(0)
+	{
+	}
+
+	void MarkerIndex::build(const vector<Marker>& points, int frame_number)
+	{
+		this->frame_number = frame_number;
+
+		int n = points.size();
+		entries.resize(n);
+		axes.resize(n);
+		positions.resize(n);
+
+		for (int i = 0; i < n; i++)
+		{
+			entries[i].point = points[i];
+			entries[i].index = i;
+		}
+
+		build(0, n);
+
+		for (int i = 0; i < n; i++) positions[entries[i].index] = i;
+	}
+
+	void MarkerIndex::build(int begin, int end)
+	{
+		if (end - begin <= LEAF_SIZE) return;
+
+		// split on the widest axis, markers often lie on a plane
+		Vec3 lo = entries[begin].point;
+		Vec3 hi = lo;
+		for (int i = begin + 1; i < end; i++)
+		{
+			const Vec3& p = entries[i].point;
+			lo = makeVec3(min(lo.x, p.x), min(lo.y, p.y), min(lo.z, p.z));
+			hi = makeVec3(max(hi.x, p.x), max(hi.y, p.y), max(hi.z, p.z));
+		}
+
+		Vec3 extent = hi - lo;
+		int axis = 0;
+		if (extent.y > component(extent, axis)) axis = 1;
+		if (extent.z > component(extent, axis)) axis = 2;
+
+		int middle = begin + (end - begin) / 2;
+		nth_element(entries.begin() + begin, entries.begin() + middle, entries.begin() + end,
+					[axis](const Entry& a, const Entry& b) {
+						return component(a.point, axis) < component(b.point, axis);
+					});
+		axes[middle] = axis;
+
+		build(begin, middle);
+		build(middle + 1, end);
+	}
+
+	int MarkerIndex::findInRadius(const Vec3& center, float radius, vector<int>& result) const
+	{
+		result.clear();
+		if (radius >= 0) findInRadius(0, entries.size(), center, radius * radius, result);
+		return result.size();
+	}
+
+	void MarkerIndex::findInRadius(int begin, int end, const Vec3& center, float radius2,
+								   vector<int>& result) const
+	{
+		if (end - begin <= LEAF_SIZE)
+		{
+			for (int i = begin; i < end; i++)
+				if (distanceSquared(entries[i].point, center) <= radius2) result.push_back(entries[i].index);
+			return;
+		}
+
+		int middle = begin + (end - begin) / 2;
+		const Entry& e = entries[middle];
+		float d = component(center, axes[middle]) - component(e.point, axes[middle]);
+
+		if (distanceSquared(e.point, center) <= radius2) result.push_back(e.index);
+		if (d <= 0 || d * d <= radius2) findInRadius(begin, middle, center, radius2, result);
+		if (d >= 0 || d * d <= radius2) findInRadius(middle + 1, end, center, radius2, result);
+	}
+
+	int MarkerIndex::findInBox(const Vec3& min, const Vec3& max, vector<int>& result) const
+	{
+		result.clear();
+		findInBox(0, entries.size(), min, max, result);
+		return result.size();
+	}
+
+	void MarkerIndex::findInBox(int begin, int end, const Vec3& min, const Vec3& max,
+								vector<int>& result) const
+	{
+		if (end - begin <= LEAF_SIZE)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				const Vec3& p = entries[i].point;
+				if (p.x >= min.x && p.y >= min.y && p.z >= min.z
+					&& p.x <= max.x && p.y <= max.y && p.z <= max.z)
+					result.push_back(entries[i].index);
+			}
+			return;
+		}
+
+		int middle = begin + (end - begin) / 2;
+		int axis = axes[middle];
+		const Vec3& p = entries[middle].point;
+		float split = component(p, axis);
+
+		if (p.x >= min.x && p.y >= min.y && p.z >= min.z
+			&& p.x <= max.x && p.y <= max.y && p.z <= max.z)
+			result.push_back(entries[middle].index);
+
+		if (component(min, axis) <= split) findInBox(begin, middle, min, max, result);
+		if (component(max, axis) >= split) findInBox(middle + 1, end, min, max, result);
+	}
+
+	int MarkerIndex::findNearest(const Vec3& p, int k, vector<int>& result) const
+	{
+		result.clear();
+		if (k <= 0) return 0;
+
+		NearestHeap heap;
+		heap.reserve(k);
+		findNearest(0, entries.size(), p, k, heap);
+
+		sort_heap(heap.begin(), heap.end());
+		for (int i = 0; i < heap.size(); i++) result.push_back(heap[i].second);
+		return result.size();
+	}
+
+	static inline void pushNearest(vector<pair<float, int> >& heap, int k, float d2, int index)
+	{
+		if (heap.size() < k)
+		{
+			heap.push_back(make_pair(d2, index));
+			push_heap(heap.begin(), heap.end());
+		}
+		else if (d2 < heap.front().first)
+		{
+			pop_heap(heap.begin(), heap.end());
+			heap.back() = make_pair(d2, index);
+			push_heap(heap.begin(), heap.end());
+		}
+	}
+
+	void MarkerIndex::findNearest(int begin, int end, const Vec3& p, int k, NearestHeap& heap) const
+	{
+		if (end - begin <= LEAF_SIZE)
+		{
+			for (int i = begin; i < end; i++)
+				pushNearest(heap, k, distanceSquared(entries[i].point, p), entries[i].index);
+			return;
+		}
+
+		int middle = begin + (end - begin) / 2;
+		const Entry& e = entries[middle];
+		float d = component(p, axes[middle]) - component(e.point, axes[middle]);
+
+		pushNearest(heap, k, distanceSquared(e.point, p), e.index);
+
+		// the side p is on first, the other only if it can still be closer
+		if (d <= 0)
+		{
+			findNearest(begin, middle, p, k, heap);
+			if (heap.size() < k || d * d < heap.front().first) findNearest(middle + 1, end, p, k, heap);
+		}
+		else
+		{
+			findNearest(middle + 1, end, p, k, heap);
+			if (heap.size() < k || d * d < heap.front().first) findNearest(begin, middle, p, k, heap);
+		}
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Frame.h"
+#include "Pool.h"
+
+// k-d tree over the markers of one frame, for proximity tests, picking and
+// clustering without scanning every marker.
+//
+// the tree is implicit: build() reorders a copy of the points so that the
+// middle of every range splits it on its widest axis, and queries descend
+// by index arithmetic. radius and box queries cost O(n^(2/3) + k) in the
+// worst case for k points found, and close to O(log n + k) for small
+// regions over evenly spread markers; nearest neighbour queries are about
+// O(log n) per neighbour on such data. build() is O(n log n) and reuses
+// the storage of earlier builds.
+//
+// queries return indices into the points given to build(). an index is
+// immutable once built and can be queried from any thread; see
+// Client::setMarkerIndexEnabled() and Client::getMarkerIndex().
+
+namespace NatNet
+{
+	class MarkerIndex
+	{
+	public:
+		MarkerIndex();
+
+		void build(const std::vector<Marker>& points, int frame_number);
+
+		inline int getFrameNumber() const { return frame_number; }
+		inline int size() const { return entries.size(); }
+
+		// the i-th point given to build()
+		inline const Marker& getPoint(int index) const { return entries[positions[index]].point; }
+
+		// each fills result with the matching indices and returns their number
+
+		// points within radius of center, in no particular order
+		int findInRadius(const Vec3& center, float radius, std::vector<int>& result) const;
+
+		// the k points closest to p, nearest first
+		int findNearest(const Vec3& p, int k, std::vector<int>& result) const;
+
+		// points inside the box [min, max], in no particular order
+		int findInBox(const Vec3& min, const Vec3& max, std::vector<int>& result) const;
+
+	private:
+		struct Entry
+		{
+			Marker point;
+			int index;  // in the points given to build()
+		};
+
+		// ranges this small are scanned instead of split
+		static const int LEAF_SIZE = 8;
+
+		int frame_number;
+
+		std::vector<Entry> entries;          // tree order
+		std::vector<unsigned char> axes;     // split axis of the range whose middle is at i
+		std::vector<int> positions;          // build() index -> position in entries
+
+		void build(int begin, int end);
+
+		void findInRadius(int begin, int end, const Vec3& center, float radius2,
+						  std::vector<int>& result) const;
+		void findInBox(int begin, int end, const Vec3& min, const Vec3& max,
+					   std::vector<int>& result) const;
+
+		// max-heap of (squared distance, index), at most k entries
+		typedef std::vector<std::pair<float, int> > NearestHeap;
+		void findNearest(int begin, int end, const Vec3& p, int k, NearestHeap& heap) const;
+	};
+
+	typedef std::shared_ptr<const MarkerIndex> MarkerIndexPtr;
+
+	// indices shared by reference count: an index goes back to the pool
+	// when its last reference is dropped, so the decoding thread rebuilds
+	// into storage consumers are done with.
+	class MarkerIndexPool : public Pool<MarkerIndex>
+	{
+	public:
+		// at most max_free are kept for reuse
+		explicit MarkerIndexPool(size_t max_free = 4)
+			: Pool<MarkerIndex>(max_free)
+		{
+		}
+	};
+}
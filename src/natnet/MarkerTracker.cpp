@@ -0,0 +1,358 @@
+#include "MarkerTracker.h"
+
+#include <limits.h>
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "Log.h"
+
+using namespace std;
+
+namespace NatNet
+{
+	// saturated, so a tiny cell or a stray coordinate can't overflow the
+	// conversion; far points then share the edge cells, which only costs
+	// distance tests. the margin leaves room for the +-1 neighbour cells
+	static inline int cellOf(float v, float inv_cell_size)
+	{
+		static const float LIMIT = 1 << 30;
+		float c = floorf(v * inv_cell_size);
+		if (!(c > -LIMIT)) return -(1 << 30);
+		if (c > LIMIT) return 1 << 30;
+		return (int)c;
+	}
+
+	static inline unsigned int hashCell(int x, int y, int z)
+	{
+		unsigned int h = (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ^ (unsigned int)z * 83492791u;
+
+		// the buckets take the low bits, which the products alone leave
+		// poorly mixed
+		h ^= h >> 16;
+		h *= 0x45d9f3bu;
+		h ^= h >> 16;
+		return h;
+	}
+
+	MarkerTracker::MarkerTracker()
+		: enabled(false)
+		, settings_version(0)
+		, reset_requested(false)
+		, num_tracks(0)
+		, last_update_nanos(0)
+		, applied_version(-1)
+		, last_frame(-1)
+		, next_id(0)
+	{
+	}
+
+	void MarkerTracker::setEnabled(bool yn)
+	{
+		if (yn && !enabled) reset();
+		enabled = yn;
+	}
+
+	void MarkerTracker::setSettings(const Settings& settings)
+	{
+		lock_guard<mutex> guard(settings_mutex);
+
+		// a distance of 0 or less matches nothing and has no cell size
+		float max_distance = this->settings.max_distance;
+		if (settings.max_distance > 0)
+			max_distance = settings.max_distance;
+		else
+			logMessage(LOG_WARNING, "marker tracker: max_distance %f ignored, must be > 0", settings.max_distance);
+
+		this->settings = settings;
+		this->settings.max_distance = max_distance;
+		this->settings.max_misses = max(settings.max_misses, 0);
+		this->settings.max_tracks = max(settings.max_tracks, 0);
+		this->settings.velocity_smoothing = min(max(settings.velocity_smoothing, 0.0f), 1.0f);
+		settings_version++;
+	}
+
+	MarkerTracker::Settings MarkerTracker::getSettings()
+	{
+		lock_guard<mutex> guard(settings_mutex);
+		return settings;
+	}
+
+	void MarkerTracker::reset() { reset_requested = true; }
+
+	void MarkerTracker::clearTracks()
+	{
+		track_ids.clear();
+		first_frames.clear();
+		misses.clear();
+		px.clear(); py.clear(); pz.clear();
+		vx.clear(); vy.clear(); vz.clear();
+		qx.clear(); qy.clear(); qz.clear();
+		last_frame = -1;
+	}
+
+	void MarkerTracker::apply(const Marker* markers, int num_markers, int frame_number,
+							  vector<int>& ids, vector<int>& ages)
+	{
+		Nanos start = getTimeNanos();
+
+		if (reset_requested.exchange(false)) clearTracks();
+
+		if (applied_version != settings_version)
+		{
+			lock_guard<mutex> guard(settings_mutex);
+			applied = settings;
+			applied_version = settings_version;
+		}
+
+		// frames since the last one; restart after a jump back (take
+		// looped, server restarted) or a gap no track survives
+		int k = frame_number - last_frame;
+		if (last_frame < 0 || k <= 0 || k > applied.max_misses + 1)
+		{
+			clearTracks();
+			k = 1;
+		}
+		last_frame = frame_number;
+
+		int num_slots = track_ids.size();
+
+		for (int s = 0; s < num_slots; s++)
+		{
+			qx[s] = px[s] + vx[s] * k;
+			qy[s] = py[s] + vy[s] * k;
+			qz[s] = pz[s] + vz[s] * k;
+		}
+
+		// cells twice max_distance wide: the reach of a marker then spans
+		// at most two per axis
+		float cell_size = 2 * applied.max_distance;
+		buildHash(cell_size);
+		findCandidates(markers, num_markers, cell_size);
+
+		marker_slots.assign(num_markers, -1);
+		slot_matched.assign(num_slots, 0);
+		associate();
+
+		ids.resize(num_markers);
+		ages.resize(num_markers);
+
+		float a = applied.velocity_smoothing;
+
+		for (int i = 0; i < num_markers; i++)
+		{
+			int s = marker_slots[i];
+			if (s < 0) continue;
+
+			const Marker& m = markers[i];
+			vx[s] += a * ((m.x - px[s]) / k - vx[s]);
+			vy[s] += a * ((m.y - py[s]) / k - vy[s]);
+			vz[s] += a * ((m.z - pz[s]) / k - vz[s]);
+			px[s] = m.x; py[s] = m.y; pz[s] = m.z;
+			misses[s] = 0;
+
+			ids[i] = track_ids[s];
+			ages[i] = frame_number - first_frames[s];
+		}
+
+		// unmatched tracks coast, or go
+		for (int s = num_slots - 1; s >= 0; s--)
+		{
+			if (slot_matched[s]) continue;
+
+			misses[s] += k;
+			if (misses[s] > applied.max_misses)
+				removeSlot(s);
+			else
+			{
+				px[s] = qx[s]; py[s] = qy[s]; pz[s] = qz[s];
+			}
+		}
+
+		for (int i = 0; i < num_markers; i++)
+		{
+			if (marker_slots[i] >= 0) continue;
+
+			if (track_ids.size() < applied.max_tracks)
+			{
+				ids[i] = addTrack(markers[i], frame_number);
+				ages[i] = 0;
+			}
+			else
+			{
+				ids[i] = -1;
+				ages[i] = 0;
+			}
+		}
+
+		num_tracks = track_ids.size();
+		last_update_nanos = getTimeNanos() - start;
+	}
+
+	void MarkerTracker::associate()
+	{
+		// closest pairs first. a pair that is the closest for both its
+		// marker and its track is taken by that order no matter what else
+		// competes, which is most pairs; only the rest is sorted.
+		marker_best.assign(marker_slots.size(), numeric_limits<float>::max());
+		slot_best.assign(slot_matched.size(), numeric_limits<float>::max());
+
+		for (int i = 0; i < candidates.size(); i++)
+		{
+			const Candidate& c = candidates[i];
+			if (c.distance2 < marker_best[c.marker]) marker_best[c.marker] = c.distance2;
+			if (c.distance2 < slot_best[c.slot]) slot_best[c.slot] = c.distance2;
+		}
+
+		for (int i = 0; i < candidates.size(); i++)
+		{
+			const Candidate& c = candidates[i];
+			if (c.distance2 != marker_best[c.marker] || c.distance2 != slot_best[c.slot]) continue;
+			if (marker_slots[c.marker] >= 0 || slot_matched[c.slot]) continue;
+			marker_slots[c.marker] = c.slot;
+			slot_matched[c.slot] = 1;
+		}
+
+		int n = 0;
+		for (int i = 0; i < candidates.size(); i++)
+		{
+			const Candidate& c = candidates[i];
+			if (marker_slots[c.marker] < 0 && !slot_matched[c.slot]) candidates[n++] = c;
+		}
+		candidates.resize(n);
+
+		sort(candidates.begin(), candidates.end());
+
+		for (int i = 0; i < candidates.size(); i++)
+		{
+			const Candidate& c = candidates[i];
+			if (marker_slots[c.marker] >= 0 || slot_matched[c.slot]) continue;
+			marker_slots[c.marker] = c.slot;
+			slot_matched[c.slot] = 1;
+		}
+	}
+
+	void MarkerTracker::buildHash(float cell_size)
+	{
+		int num_slots = track_ids.size();
+
+		// at least twice as many buckets as tracks, a power of two
+		size_t num_buckets = 64;
+		while (num_buckets < num_slots * 2) num_buckets *= 2;
+
+		float inv = 1 / cell_size;
+		unsigned int mask = num_buckets - 1;
+
+		// counting sort of the predictions by bucket, so each bucket is a
+		// contiguous run of hashed entries
+		bucket_starts.assign(num_buckets + 1, 0);
+		slot_buckets.resize(num_slots);
+
+		for (int s = 0; s < num_slots; s++)
+		{
+			unsigned int b = hashCell(cellOf(qx[s], inv), cellOf(qy[s], inv), cellOf(qz[s], inv)) & mask;
+			slot_buckets[s] = b;
+			bucket_starts[b + 1]++;
+		}
+
+		for (size_t b = 0; b < num_buckets; b++) bucket_starts[b + 1] += bucket_starts[b];
+
+		hashed.resize(num_slots);
+		bucket_fill.assign(bucket_starts.begin(), bucket_starts.end() - 1);
+
+		for (int s = 0; s < num_slots; s++)
+		{
+			HashEntry& e = hashed[bucket_fill[slot_buckets[s]]++];
+			e.x = qx[s];
+			e.y = qy[s];
+			e.z = qz[s];
+			e.slot = s;
+		}
+	}
+
+	void MarkerTracker::findCandidates(const Marker* markers, int num_markers, float cell_size)
+	{
+		candidates.clear();
+		if (track_ids.empty()) return;
+
+		float inv = 1 / cell_size;
+		float d = applied.max_distance;
+		float max_distance2 = d * d;
+		unsigned int mask = bucket_starts.size() - 2;
+
+		for (int i = 0; i < num_markers; i++)
+		{
+			const Marker& m = markers[i];
+
+			// the predictions in reach lie in the 2 x 2 x 2 cells around
+			// the marker. buckets can collide; a slot found twice only
+			// yields a duplicate candidate.
+			int x0 = cellOf(m.x - d, inv), x1 = cellOf(m.x + d, inv);
+			int y0 = cellOf(m.y - d, inv), y1 = cellOf(m.y + d, inv);
+			int z0 = cellOf(m.z - d, inv), z1 = cellOf(m.z + d, inv);
+
+			for (int z = z0; z <= z1; z++)
+			{
+				for (int y = y0; y <= y1; y++)
+				{
+					for (int x = x0; x <= x1; x++)
+					{
+						unsigned int b = hashCell(x, y, z) & mask;
+						int end = bucket_starts[b + 1];
+						for (int n = bucket_starts[b]; n < end; n++)
+						{
+							const HashEntry& e = hashed[n];
+							float dx = m.x - e.x;
+							float dy = m.y - e.y;
+							float dz = m.z - e.z;
+							float d2 = dx * dx + dy * dy + dz * dz;
+							if (d2 > max_distance2) continue;
+
+							Candidate c;
+							c.distance2 = d2;
+							c.marker = i;
+							c.slot = e.slot;
+							candidates.push_back(c);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void MarkerTracker::removeSlot(int slot)
+	{
+		int last = track_ids.size() - 1;
+		if (slot != last)
+		{
+			track_ids[slot] = track_ids[last];
+			first_frames[slot] = first_frames[last];
+			misses[slot] = misses[last];
+			px[slot] = px[last]; py[slot] = py[last]; pz[slot] = pz[last];
+			vx[slot] = vx[last]; vy[slot] = vy[last]; vz[slot] = vz[last];
+			qx[slot] = qx[last]; qy[slot] = qy[last]; qz[slot] = qz[last];
+		}
+
+		track_ids.pop_back();
+		first_frames.pop_back();
+		misses.pop_back();
+		px.pop_back(); py.pop_back(); pz.pop_back();
+		vx.pop_back(); vy.pop_back(); vz.pop_back();
+		qx.pop_back(); qy.pop_back(); qz.pop_back();
+	}
+
+	int MarkerTracker::addTrack(const Marker& m, int frame_number)
+	{
+		int id = next_id;
+		next_id = next_id == INT_MAX ? 0 : next_id + 1;
+
+		track_ids.push_back(id);
+		first_frames.push_back(frame_number);
+		misses.push_back(0);
+		px.push_back(m.x); py.push_back(m.y); pz.push_back(m.z);
+		vx.push_back(0); vy.push_back(0); vz.push_back(0);
+		qx.push_back(m.x); qy.push_back(m.y); qz.push_back(m.z);
+		return id;
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "Clock.h"
+#include "Frame.h"
+
+// optional tracking of the unlabeled markers across frames, run by the
+// client on the decoding thread before a frame is published. each marker
+// gets the id of the track it continues, or a new one (Frame::marker_ids),
+// and the number of frames since that track started (Frame::marker_ages).
+// labeled markers are left out: the server already identifies them, and
+// 3.0+ servers may stream the same points in both sections.
+//
+// every track predicts its position from its last position and velocity.
+// markers are associated with the predictions within max_distance,
+// closest pairs first; candidates are found through a spatial hash with
+// cells 2 * max_distance wide, so a marker's reach spans at most two
+// cells per axis. a frame costs about O(n) for n markers, plus
+// O(c log c) for the c pairs that compete for the same marker or track. a
+// track that finds no marker coasts on its prediction for up to max_misses
+// frames and is dropped after that; at most max_tracks are kept.
+//
+// per-track state is kept as parallel arrays indexed by slot.
+
+namespace NatNet
+{
+	class MarkerTracker
+	{
+	public:
+		struct Settings
+		{
+			// largest distance between a prediction and its marker, in output
+			// units (the client's transform applies). must be > 0:
+			// setSettings() keeps the previous value otherwise
+			float max_distance;
+
+			int max_misses;  // frames a track survives without a marker, >= 0
+			int max_tracks;  // markers beyond this get no id (-1), >= 0
+
+			// weight of the newest sample in the velocity estimate, clamped
+			// to 0 - 1. 0 turns prediction off.
+			float velocity_smoothing;
+
+			Settings()
+				: max_distance(0.03f)
+				, max_misses(10)
+				, max_tracks(10000)
+				, velocity_smoothing(0.5f)
+			{
+			}
+		};
+
+		MarkerTracker();
+
+		// the settings calls may come from any thread; they reach the
+		// decoding thread on its next frame
+
+		// off by default
+		void setEnabled(bool yn);
+		inline bool isEnabled() const { return enabled; }
+
+		void setSettings(const Settings& settings);
+		Settings getSettings();
+
+		// drops every track, on the next frame
+		void reset();
+
+		inline int getNumTracks() const { return num_tracks; }
+
+		// duration of the last apply()
+		inline Nanos getLastUpdateNanos() const { return last_update_nanos; }
+
+		// decoding thread. fills ids and ages, parallel to markers.
+		void apply(const Marker* markers, int num_markers, int frame_number,
+				   std::vector<int>& ids, std::vector<int>& ages);
+
+	private:
+		std::atomic<bool> enabled;
+
+		// written by setSettings(), copied by apply() when settings_version moves
+		std::mutex settings_mutex;
+		Settings settings;
+		std::atomic<int> settings_version;
+		std::atomic<bool> reset_requested;
+
+		std::atomic<int> num_tracks;
+		std::atomic<Nanos> last_update_nanos;
+
+		// decoding thread only
+		int applied_version;
+		Settings applied;
+
+		int last_frame;  // -1 before the first frame
+		int next_id;
+
+		std::vector<int> track_ids;
+		std::vector<int> first_frames;
+		std::vector<int> misses;
+		std::vector<float> px, py, pz;  // last position
+		std::vector<float> vx, vy, vz;  // velocity, per frame
+		std::vector<float> qx, qy, qz;  // prediction for this frame
+
+		// spatial hash over the predictions, sorted by bucket: bucket b
+		// is hashed[bucket_starts[b], bucket_starts[b + 1])
+		struct HashEntry
+		{
+			float x, y, z;
+			int slot;
+		};
+
+		std::vector<HashEntry> hashed;
+		std::vector<int> bucket_starts;
+		std::vector<int> bucket_fill;
+		std::vector<unsigned int> slot_buckets;
+
+		struct Candidate
+		{
+			float distance2;
+			int marker;
+			int slot;
+
+			inline bool operator<(const Candidate& c) const { return distance2 < c.distance2; }
+		};
+
+		std::vector<Candidate> candidates;
+		std::vector<int> marker_slots;   // -1 until matched
+		std::vector<char> slot_matched;
+		std::vector<float> marker_best;  // smallest candidate distance per marker
+		std::vector<float> slot_best;    // and per slot
+
+		void clearTracks();
+		void buildHash(float cell_size);
+		void findCandidates(const Marker* markers, int num_markers, float cell_size);
+		void associate();
+		void removeSlot(int slot);
+		int addTrack(const Marker& m, int frame_number);
+	};
+}
@@ -0,0 +1,11 @@
+#include "PacketPool.h"
+
+using namespace std;
+
+namespace NatNet
+{
+	PacketPool::PacketPool(size_t buffer_size, size_t max_free)
+		: Pool<vector<char> >(max_free, [buffer_size] { return new vector<char>(buffer_size, 0); })
+	{
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "Pool.h"
+
+// fixed-size packet buffers shared by reference count. a buffer goes
+// back to the pool when its last reference is dropped, on whichever
+// thread that happens, so frame views can keep the datagram they were
+// built from without copying it.
+
+namespace NatNet
+{
+	class PacketPool : public Pool<std::vector<char> >
+	{
+	public:
+		typedef Ptr Buffer;
+
+		// buffers are buffer_size bytes; at most max_free are kept for reuse
+		PacketPool(size_t buffer_size, size_t max_free = 64);
+	};
+}
@@ -0,0 +1,1244 @@
+#include "Parser.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "Log.h"
+
+using namespace std;
+
+namespace NatNet
+{
+	// sender
+	struct sSender
+	{
+		char szName[256];				// sending app's name
+		unsigned char Version[4];		// sending app's version [major.minor.build.revision]
+		unsigned char NatNetVersion[4];	// sending app's NatNet version [major.minor.build.revision]
+	};
+
+	template <typename T>
+	static void buildNameIndex(const vector<T>& descs, NameIndex& index)
+	{
+		index.clear();
+		for (int i = 0; i < descs.size(); i++)
+		{
+			// first description wins on duplicated names
+			index.insert(make_pair(descs[i].name, i));
+		}
+	}
+
+	void Descriptions::buildIndex()
+	{
+		buildNameIndex(markersets, markerset_index);
+		buildNameIndex(rigidbodies, rigidbody_index);
+		buildNameIndex(skeletons, skeleton_index);
+
+		skeleton_index_by_id.clear();
+		for (int i = 0; i < skeletons.size(); i++)
+			skeleton_index_by_id[skeletons[i].id] = i;
+	}
+
+	struct remove_dups
+	{
+		Vec3 v;
+		float dist;
+
+		remove_dups(const Vec3& v, float dist)
+			: v(v)
+			, dist(dist)
+		{
+		}
+
+		bool operator()(const Vec3& t) { return match(v, t, dist); }
+	};
+
+	template <typename T>
+	static inline const char* read(const char* ptr, T& value)
+	{
+		memcpy(&value, ptr, sizeof(T));
+		return ptr + sizeof(T);
+	}
+
+	// NatNet major.minor is at least M.m
+	static inline bool hasVersion(int major, int minor, int M, int m)
+	{
+		return major > M || (major == M && minor >= m);
+	}
+
+	// 4.1 and later follow the count of each frame section with the size
+	// of its data in bytes. -1 before.
+	static inline const char* readSectionSize(const char* ptr, int major, int minor, int& bytes)
+	{
+		bytes = -1;
+		if (hasVersion(major, minor, 4, 1)) ptr = read(ptr, bytes);
+		return ptr;
+	}
+
+	// labeled marker: id, x, y, z, size, params (2.6 and later), residual (3.0 and later)
+	static inline size_t labeledMarkerStride(int major, int minor)
+	{
+		size_t stride = sizeof(int) + 4 * sizeof(float);
+		if (((major == 2) && (minor >= 6)) || (major > 2) || (major == 0)) stride += sizeof(short);
+		if (major >= 3) stride += sizeof(float);
+		return stride;
+	}
+
+	// force plate / device data: id, channel count, then per channel a
+	// sample count and the samples
+	static const char* skipChannelData(const char* ptr, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			ptr += sizeof(int);
+
+			int nChannels = 0;
+			ptr = read(ptr, nChannels);
+
+			for (int k = 0; k < nChannels; k++)
+			{
+				int nFrames = 0;
+				ptr = read(ptr, nFrames);
+				ptr += nFrames * sizeof(float);
+			}
+		}
+		return ptr;
+	}
+
+	Parser::Parser()
+		: server_clock_frequency(0)
+		, config(make_shared<DecodeConfig>())
+		, parallel_min_bytes(0)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			NatNetVersion[i] = 0;
+			ServerVersion[i] = 0;
+		}
+	}
+
+	int Parser::getMessageId(const char* packet)
+	{
+		unsigned short id = 0;
+		memcpy(&id, packet, 2);
+		return id;
+	}
+
+	int Parser::getFrameNumber(const char* packet)
+	{
+		int frame_number = 0;
+		memcpy(&frame_number, packet + 4, 4);
+		return frame_number;
+	}
+
+	void Parser::setNatNetVersion(int major, int minor)
+	{
+		NatNetVersion[0] = major;
+		NatNetVersion[1] = minor;
+	}
+
+	void Parser::setServerVersion(int major, int minor)
+	{
+		ServerVersion[0] = major;
+		ServerVersion[1] = minor;
+	}
+
+	void Parser::setSubscription(const Subscription& subscription)
+	{
+		this->subscription = subscription;
+		sort(this->subscription.rigidbody_ids.begin(), this->subscription.rigidbody_ids.end());
+		sort(this->subscription.skeleton_ids.begin(), this->subscription.skeleton_ids.end());
+	}
+
+	void Parser::setConfig(const DecodeConfigPtr& config)
+	{
+		this->config = config;
+	}
+
+	void Parser::setTransform(const Matrix4x4& m)
+	{
+		shared_ptr<DecodeConfig> c = make_shared<DecodeConfig>(*config);
+		c->setTransform(m);
+		config = c;
+	}
+
+	void Parser::setDuplicatedPointRemovalDistance(float v)
+	{
+		shared_ptr<DecodeConfig> c = make_shared<DecodeConfig>(*config);
+		c->setDuplicatedPointRemovalDistance(v);
+		config = c;
+	}
+
+	void Parser::setSkeletonLocalCoordinates(bool yn)
+	{
+		shared_ptr<DecodeConfig> c = make_shared<DecodeConfig>(*config);
+		c->setSkeletonLocalCoordinates(yn);
+		config = c;
+	}
+
+	bool Parser::parsePingResponse(const char* packet)
+	{
+		if (getMessageId(packet) != NAT_PINGRESPONSE) return false;
+
+		const sSender& sender = *(const sSender*)(packet + 4);
+		for (int i = 0; i < 4; i++)
+		{
+			NatNetVersion[i] = (int)sender.NatNetVersion[i];
+			ServerVersion[i] = (int)sender.Version[i];
+		}
+
+		// 3.0 and later: followed by the high resolution clock frequency
+		unsigned short nBytes = 0;
+		memcpy(&nBytes, packet + 2, 2);
+
+		server_clock_frequency = 0;
+		if (NatNetVersion[0] >= 3 && nBytes >= sizeof(sSender) + sizeof(uint64_t))
+			memcpy(&server_clock_frequency, packet + 4 + sizeof(sSender), sizeof(uint64_t));
+
+		return true;
+	}
+
+	bool Parser::checkVersion() const
+	{
+		int major = NatNetVersion[0];
+		int minor = NatNetVersion[1];
+
+		if (major == 0 && minor == 0)
+		{
+			logMessage(LOG_ERROR, "initialize failed");
+			return false;
+		}
+
+		if (major > IMPL_MAJOR || (major == IMPL_MAJOR && minor > IMPL_MINOR))
+		{
+			logMessage(LOG_ERROR, "The implemented NatNet parser is outdated");
+			return false;
+		}
+
+		return true;
+	}
+
+	void Parser::buildSkeletonHierarchy(SkeletonDescription& desc)
+	{
+		const int n = desc.joints.size();
+
+		desc.joint_index_by_id.clear();
+		for (int i = 0; i < n; i++)
+		{
+			int id = desc.joints[i].id & 0xffff;
+			if (id >= desc.joint_index_by_id.size())
+				desc.joint_index_by_id.resize(id + 1, -1);
+			desc.joint_index_by_id[id] = i;
+		}
+
+		desc.parent_indices.assign(n, -1);
+		for (int i = 0; i < n; i++)
+		{
+			int parent = desc.joints[i].parent_id & 0xffff;
+			if (parent < desc.joint_index_by_id.size() && parent != (desc.joints[i].id & 0xffff))
+				desc.parent_indices[i] = desc.joint_index_by_id[parent];
+		}
+
+		// depth-first from the roots. joints on a parent cycle are never
+		// reached from a root, so they are demoted to roots afterwards
+		vector<vector<int> > children(n);
+		for (int i = 0; i < n; i++)
+		{
+			if (desc.parent_indices[i] >= 0) children[desc.parent_indices[i]].push_back(i);
+		}
+
+		desc.joint_order.clear();
+		desc.joint_order.reserve(n);
+
+		vector<char> visited(n, 0);
+		vector<int> stack;
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int i = 0; i < n; i++)
+			{
+				if (visited[i]) continue;
+				if (pass == 0 && desc.parent_indices[i] >= 0) continue;
+
+				desc.parent_indices[i] = -1;
+				stack.push_back(i);
+
+				while (stack.size())
+				{
+					int j = stack.back();
+					stack.pop_back();
+					if (visited[j]) continue;
+
+					visited[j] = 1;
+					desc.joint_order.push_back(j);
+
+					for (int k = children[j].size() - 1; k >= 0; k--)
+						stack.push_back(children[j][k]);
+				}
+			}
+		}
+	}
+
+	void Parser::solveSkeleton(Skeleton& S, const SkeletonDescription& desc)
+	{
+		const int n = desc.joints.size();
+
+		solve_orientations.resize(n);
+		solve_positions.resize(n);
+		solve_present.assign(n, 0);
+
+		for (int i = 0; i < S.joints.size(); i++)
+		{
+			const RigidBody& RB = S.joints[i];
+			int id = RB.id & 0xffff;
+			if (id >= desc.joint_index_by_id.size()) continue;
+
+			int k = desc.joint_index_by_id[id];
+			if (k < 0) continue;
+
+			solve_orientations[k] = RB.raw_orientation;
+			solve_positions[k] = RB.raw_position;
+			solve_present[k] = 1;
+		}
+
+		S.local_matrices.resize(n);
+		S.world_matrices.resize(n);
+
+		const DecodeConfig& c = *config;
+		const bool skeleton_local_coordinates = c.getSkeletonLocalCoordinates();
+		const Vec3& scale = c.getScale();
+
+		for (int i = 0; i < n; i++)
+		{
+			const int k = desc.joint_order[i];
+			const int parent = desc.parent_indices[k];
+
+			Quat& q = solve_orientations[k];
+			Vec3& p = solve_positions[k];
+
+			Quat local_q = identityQuat();
+			Vec3 local_p = makeVec3(0, 0, 0);
+
+			if (!solve_present[k])
+			{
+				local_p = desc.joints[k].offset;
+				if (skeleton_local_coordinates || parent < 0)
+				{
+					q = local_q;
+					p = local_p;
+				}
+				else
+				{
+					q = solve_orientations[parent];
+					p = rotate(solve_orientations[parent], local_p) + solve_positions[parent];
+				}
+			}
+			else if (skeleton_local_coordinates)
+			{
+				local_q = q;
+				local_p = p;
+			}
+			else if (parent >= 0)
+			{
+				Quat inv = inverse(solve_orientations[parent]);
+				local_q = compose(q, inv);
+				local_p = rotate(inv, p - solve_positions[parent]);
+			}
+			else
+			{
+				local_q = q;
+				local_p = p;
+			}
+
+			if (skeleton_local_coordinates && parent >= 0)
+			{
+				// world = local, then parent
+				p = rotate(solve_orientations[parent], local_p) + solve_positions[parent];
+				q = compose(local_q, solve_orientations[parent]);
+			}
+
+			if (c.isUniformScale())
+				local_p = local_p * scale.x;
+			else
+				local_p = makeVec3(local_p.x * scale.x, local_p.y * scale.y, local_p.z * scale.z);
+
+			S.local_matrices[k] = makePoseMatrix(local_p, local_q);
+			S.world_matrices[k] = makePoseMatrix(c.transformPoint(p), c.transformRotation(q));
+		}
+	}
+
+	const char* Parser::unpackMarkers(const char* ptr, int nMarkers, vector<Marker>& markers)
+	{
+		markers.resize(nMarkers);
+		if (nMarkers) config->transformPoints(ptr, nMarkers, markers.data());
+
+		return ptr + nMarkers * 3 * sizeof(float);
+	}
+
+	static inline bool isAllowed(const vector<int>& allowed_ids, int id)
+	{
+		return allowed_ids.empty() || binary_search(allowed_ids.begin(), allowed_ids.end(), id);
+	}
+
+	const char* Parser::skipRigidBody(const char* ptr, int major, int minor)
+	{
+		// id, position, orientation
+		ptr += 4 + 3 * sizeof(float) + 4 * sizeof(float);
+
+		// marker positions, ids and sizes, before 3.0
+		if (major < 3)
+		{
+			int nRigidMarkers = 0;
+			ptr = read(ptr, nRigidMarkers);
+			ptr += nRigidMarkers * 3 * sizeof(float);
+
+			if (major >= 2) ptr += nRigidMarkers * (sizeof(int) + sizeof(float));
+		}
+
+		// mean marker error
+		if (major >= 2) ptr += sizeof(float);
+
+		// params, 2.6 and later
+		if (((major == 2) && (minor >= 6)) || (major > 2) || (major == 0))
+			ptr += sizeof(short);
+
+		return ptr;
+	}
+
+	const char* Parser::unpackRigidBody(const char* ptr, RigidBody& RB, int major, int minor,
+										const DecodeConfig& config, bool decode_markers)
+	{
+		Vec3 pp;
+		Quat q;
+
+		int ID = 0;
+		ptr = read(ptr, ID);
+
+		ptr = read(ptr, pp.x);
+		ptr = read(ptr, pp.y);
+		ptr = read(ptr, pp.z);
+
+		ptr = read(ptr, q.x);
+		ptr = read(ptr, q.y);
+		ptr = read(ptr, q.z);
+		ptr = read(ptr, q.w);
+
+		RB.id = ID;
+		RB.raw_position = pp;
+		RB.raw_orientation = q;
+		RB.position = config.transformPoint(pp);
+		RB.orientation = config.transformRotation(q);
+
+		// associated marker positions, dropped in 3.0
+		int nRigidMarkers = 0;
+		const char* markerData = ptr;
+
+		if (major < 3)
+		{
+			ptr = read(ptr, nRigidMarkers);
+
+			markerData = ptr;
+			ptr += nRigidMarkers * 3 * sizeof(float);
+
+			if (major >= 2)
+			{
+				// associated marker IDs
+				ptr += nRigidMarkers * sizeof(int);
+
+				// associated marker sizes
+				ptr += nRigidMarkers * sizeof(float);
+			}
+		}
+
+		RB.markers.resize(decode_markers ? nRigidMarkers : 0);
+		if (RB.markers.size()) config.transformPoints(markerData, RB.markers.size(), RB.markers.data());
+
+		if (major >= 2)
+		{
+			// Mean marker error
+			float fError = 0.0f;
+			ptr = read(ptr, fError);
+
+			// replaced by the tracking flag from 2.6 on
+			RB.mean_marker_error = fError;
+			RB.active = RB.mean_marker_error > 0;
+		}
+		else
+		{
+			RB.mean_marker_error = 0;
+			RB.active = false;
+		}
+
+		// 2.6 and later
+		if (((major == 2) && (minor >= 6)) || (major > 2) || (major == 0))
+		{
+			// params
+			short params = 0;
+			ptr = read(ptr, params);
+			RB.active = params & 0x01;  // 0x01 : rigid body was successfully tracked in this frame
+		}
+
+		return ptr;
+	}
+
+	const char* Parser::unpackRigidBodies(const char* ptr, int nRigidBodies, vector<RigidBody>& rigidbodies,
+										  const vector<int>& allowed_ids)
+	{
+		int major = NatNetVersion[0];
+		int minor = NatNetVersion[1];
+
+		bool decode_markers = subscription.sections & DECODE_RIGIDBODY_MARKERS;
+
+		rigidbodies.resize(nRigidBodies);
+
+		int n = 0;
+		for (int j = 0; j < nRigidBodies; j++)
+		{
+			int ID = 0;
+			memcpy(&ID, ptr, sizeof(ID));
+
+			if (!isAllowed(allowed_ids, ID))
+				ptr = skipRigidBody(ptr, major, minor);
+			else
+				ptr = unpackRigidBody(ptr, rigidbodies[n++], major, minor, *config, decode_markers);
+		}
+
+		rigidbodies.resize(n);
+		return ptr;
+	}
+
+	bool Parser::parseFrame(const char* packet, Frame& frame, size_t size)
+	{
+		if (getMessageId(packet) != NAT_FRAMEOFDATA || !checkVersion()) return false;
+
+		frame.invalidateMatrices();
+
+		// large frames: index once, then decode the pieces in parallel. the
+		// datagram length decides, so small frames are walked only once.
+		if (worker_pool && size > 0 && size >= parallel_min_bytes)
+		{
+			indexPacket(packet, parallel_index);
+			unpackFrameParallel(packet, frame);
+			filterMarkers(frame);
+			return true;
+		}
+
+		int major = NatNetVersion[0];
+		int minor = NatNetVersion[1];
+
+		const char* ptr = packet + 4;
+
+		// frame number
+		ptr = read(ptr, frame.frame_number);
+
+		// number of data sets (markersets, rigidbodies, etc)
+		int nMarkerSets = 0;
+		ptr = read(ptr, nMarkerSets);
+
+		int nBytes = 0;
+		ptr = readSectionSize(ptr, major, minor, nBytes);
+
+		const unsigned int sections = subscription.sections;
+		static const vector<int> all_ids;
+
+		if (sections & DECODE_MARKERSETS)
+		{
+			frame.markers_set.resize(nMarkerSets);
+			frame.markerset_names.resize(nMarkerSets);
+
+			for (int i = 0; i < nMarkerSets; i++)
+			{
+				// Markerset name, kept as a pointer into the packet
+				frame.markerset_names[i] = ptr;
+				ptr += strlen(ptr) + 1;
+
+				int nMarkers = 0;
+				ptr = read(ptr, nMarkers);
+				ptr = unpackMarkers(ptr, nMarkers, frame.markers_set[i]);
+			}
+		}
+		else
+		{
+			frame.markers_set.clear();
+			frame.markerset_names.clear();
+
+			if (nBytes >= 0) nMarkerSets = 0, ptr += nBytes;
+
+			for (int i = 0; i < nMarkerSets; i++)
+			{
+				ptr += strlen(ptr) + 1;
+
+				int nMarkers = 0;
+				ptr = read(ptr, nMarkers);
+				ptr += nMarkers * 3 * sizeof(float);
+			}
+		}
+
+		// unidentified markers
+		int nMarkers = 0;
+		ptr = read(ptr, nMarkers);
+		ptr = readSectionSize(ptr, major, minor, nBytes);
+
+		if (sections & DECODE_UNLABELED_MARKERS)
+		{
+			ptr = unpackMarkers(ptr, nMarkers, frame.markers);
+		}
+		else
+		{
+			frame.markers.clear();
+			ptr += nMarkers * 3 * sizeof(float);
+		}
+
+		frame.num_unlabeled_markers = frame.markers.size();
+
+		// rigid bodies
+		int nRigidBodies = 0;
+		ptr = read(ptr, nRigidBodies);
+		ptr = readSectionSize(ptr, major, minor, nBytes);
+
+		ptr = unpackRigidBodies(ptr, nRigidBodies, frame.rigidbodies, subscription.rigidbody_ids);
+
+		frame.skeletons.clear();
+		if (((major == 2) && (minor > 0)) || (major > 2))
+		{
+			int nSkeletons = 0;
+			ptr = read(ptr, nSkeletons);
+			ptr = readSectionSize(ptr, major, minor, nBytes);
+
+			if (!(sections & DECODE_SKELETONS) && nBytes >= 0) nSkeletons = 0, ptr += nBytes;
+
+			frame.skeletons.reserve(nSkeletons);
+
+			for (int j = 0; j < nSkeletons; j++)
+			{
+				int skeletonID = 0;
+				ptr = read(ptr, skeletonID);
+
+				int nJoints = 0;
+				ptr = read(ptr, nJoints);
+
+				if (!(sections & DECODE_SKELETONS) || !isAllowed(subscription.skeleton_ids, skeletonID))
+				{
+					for (int k = 0; k < nJoints; k++) ptr = skipRigidBody(ptr, major, minor);
+					continue;
+				}
+
+				frame.skeletons.push_back(Skeleton());
+				frame.skeletons.back().id = skeletonID;
+
+				ptr = unpackRigidBodies(ptr, nJoints, frame.skeletons.back().joints, all_ids);
+			}
+		}
+
+		// assets (4.1 and later), not decoded
+		if (hasVersion(major, minor, 4, 1))
+		{
+			int nAssets = 0;
+			ptr = read(ptr, nAssets);
+			ptr = readSectionSize(ptr, major, minor, nBytes);
+			ptr += nBytes;
+		}
+
+		// labeled markers (version 2.3 and later)
+		labeled_marker_ids.clear();
+		if (((major == 2) && (minor >= 3)) || (major > 2))
+		{
+			int nLabeledMarkers = 0;
+			ptr = read(ptr, nLabeledMarkers);
+			ptr = readSectionSize(ptr, major, minor, nBytes);
+
+			if (!(sections & DECODE_LABELED_MARKERS))
+			{
+				ptr += nLabeledMarkers * labeledMarkerStride(major, minor);
+				nLabeledMarkers = 0;
+			}
+
+			for (int j = 0; j < nLabeledMarkers; j++)
+			{
+				// id
+				int ID = 0;
+				ptr = read(ptr, ID);
+
+				// x, y, z
+				Vec3 pp;
+				ptr = read(ptr, pp.x);
+				ptr = read(ptr, pp.y);
+				ptr = read(ptr, pp.z);
+
+				// size
+				float size = 0.0f;
+				ptr = read(ptr, size);
+
+				// 2.6 and later
+				if (((major == 2) && (minor >= 6)) || (major > 2) || (major == 0))
+				{
+					// marker params
+					short params = 0;
+					ptr = read(ptr, params);
+					bool bOccluded = params & 0x01;     // marker was not visible (occluded) in this frame
+					bool bPCSolved = params & 0x02;     // position provided by point cloud solve
+					bool bModelSolved = params & 0x04;  // position provided by model solve
+				}
+
+				// 3.0 and later
+				if (major >= 3)
+				{
+					// marker error residual
+					float residual = 0.0f;
+					ptr = read(ptr, residual);
+				}
+
+				frame.markers.push_back(config->transformPoint(pp));
+				labeled_marker_ids.push_back(ID);
+			}
+		}
+
+		// Force Plate data (version 2.9 and later)
+		if (((major == 2) && (minor >= 9)) || (major > 2))
+		{
+			int nForcePlates = 0;
+			ptr = read(ptr, nForcePlates);
+			ptr = readSectionSize(ptr, major, minor, nBytes);
+			ptr = nBytes >= 0 ? ptr + nBytes : skipChannelData(ptr, nForcePlates);
+		}
+
+		// Device data (version 2.11 and later)
+		if (((major == 2) && (minor >= 11)) || (major > 2))
+		{
+			int nDevices = 0;
+			ptr = read(ptr, nDevices);
+			ptr = readSectionSize(ptr, major, minor, nBytes);
+			ptr = nBytes >= 0 ? ptr + nBytes : skipChannelData(ptr, nDevices);
+		}
+
+		ptr = unpackFrameSuffix(ptr, frame.latency, frame.timecode, frame.timecode_sub, frame.timestamp);
+
+		filterMarkers(frame);
+		return true;
+	}
+
+	const char* Parser::unpackFrameSuffix(const char* ptr, float& latency, unsigned int& timecode,
+										  unsigned int& timecode_sub, double& timestamp) const
+	{
+		int major = NatNetVersion[0];
+		int minor = NatNetVersion[1];
+
+		// software latency, before 3.0
+		latency = 0;
+		if (major < 3) ptr = read(ptr, latency);
+
+		// timecode
+		ptr = read(ptr, timecode);
+		ptr = read(ptr, timecode_sub);
+
+		// timestamp
+		timestamp = 0;
+		// 2.7 and later - increased from single to double precision
+		if (((major == 2) && (minor >= 7)) || (major > 2))
+		{
+			ptr = read(ptr, timestamp);
+		}
+		else
+		{
+			float fTemp = 0.0f;
+			ptr = read(ptr, fTemp);
+		}
+
+		// 3.0 and later: mid-exposure, data received and transmit time in
+		// server clock ticks. latency is exposure to transmit.
+		if (major >= 3)
+		{
+			uint64_t exposure = 0, received = 0, transmitted = 0;
+			ptr = read(ptr, exposure);
+			ptr = read(ptr, received);
+			ptr = read(ptr, transmitted);
+
+			if (server_clock_frequency && transmitted > exposure)
+				latency = (float)((double)(transmitted - exposure) / server_clock_frequency);
+		}
+
+		// 4.1 and later: precision timestamp, seconds and fraction
+		if (hasVersion(major, minor, 4, 1)) ptr += 2 * sizeof(unsigned int);
+
+		// frame params
+		short params = 0;
+		ptr = read(ptr, params);
+		bool bIsRecording = params & 0x01;           // 0x01 Motive is recording
+		bool bTrackedModelsChanged = params & 0x02;  // 0x02 Actively tracked model list has changed
+
+		// end of data tag
+		int eod = 0;
+		ptr = read(ptr, eod);
+
+		return ptr;
+	}
+
+	bool Parser::indexFrame(const PacketPool::Buffer& packet, FrameView& view) const
+	{
+		const char* data = packet->data();
+		if (getMessageId(data) != NAT_FRAMEOFDATA || !checkVersion()) return false;
+
+		view.packet = packet;
+		indexPacket(data, view);
+		return true;
+	}
+
+	size_t Parser::indexPacket(const char* data, FrameView& view) const
+	{
+		int major = NatNetVersion[0];
+		int minor = NatNetVersion[1];
+
+		view.data = data;
+		view.major = major;
+		view.minor = minor;
+		view.config = config;
+
+		const char* ptr = data + 4;
+
+		ptr = read(ptr, view.frame_number);
+
+		int nMarkerSets = 0;
+		ptr = read(ptr, nMarkerSets);
+
+		int nBytes = 0;
+		ptr = readSectionSize(ptr, major, minor, nBytes);
+
+		view.markersets.resize(nMarkerSets);
+		for (int i = 0; i < nMarkerSets; i++)
+		{
+			FrameView::MarkerSetSection& s = view.markersets[i];
+			s.name = ptr - data;
+			ptr += strlen(ptr) + 1;
+
+			ptr = read(ptr, s.count);
+			s.offset = ptr - data;
+			ptr += s.count * 3 * sizeof(float);
+		}
+
+		// unidentified markers
+		ptr = read(ptr, view.markers.count);
+		ptr = readSectionSize(ptr, major, minor, nBytes);
+		view.markers.offset = ptr - data;
+		ptr += view.markers.count * 3 * sizeof(float);
+
+		// rigid bodies
+		int nRigidBodies = 0;
+		ptr = read(ptr, nRigidBodies);
+		ptr = readSectionSize(ptr, major, minor, nBytes);
+
+		view.rigidbodies.resize(nRigidBodies);
+		for (int i = 0; i < nRigidBodies; i++)
+		{
+			view.rigidbodies[i].offset = ptr - data;
+			memcpy(&view.rigidbodies[i].id, ptr, sizeof(int));
+			ptr = skipRigidBody(ptr, major, minor);
+		}
+
+		view.skeletons.clear();
+		if (((major == 2) && (minor > 0)) || (major > 2))
+		{
+			int nSkeletons = 0;
+			ptr = read(ptr, nSkeletons);
+			ptr = readSectionSize(ptr, major, minor, nBytes);
+
+			view.skeletons.resize(nSkeletons);
+			for (int i = 0; i < nSkeletons; i++)
+			{
+				ptr = read(ptr, view.skeletons[i].id);
+				view.skeletons[i].offset = ptr - data;
+
+				int nJoints = 0;
+				ptr = read(ptr, nJoints);
+				for (int k = 0; k < nJoints; k++) ptr = skipRigidBody(ptr, major, minor);
+			}
+		}
+
+		// assets (4.1 and later)
+		if (hasVersion(major, minor, 4, 1))
+		{
+			ptr += sizeof(int);
+			ptr = readSectionSize(ptr, major, minor, nBytes);
+			ptr += nBytes;
+		}
+
+		// labeled markers (version 2.3 and later)
+		view.labeled_markers = FrameView::Section();
+		view.labeled_marker_stride = labeledMarkerStride(major, minor);
+
+		if (((major == 2) && (minor >= 3)) || (major > 2))
+		{
+			ptr = read(ptr, view.labeled_markers.count);
+			ptr = readSectionSize(ptr, major, minor, nBytes);
+			view.labeled_markers.offset = ptr - data;
+			ptr += view.labeled_markers.count * view.labeled_marker_stride;
+		}
+
+		// Force Plate data (version 2.9 and later)
+		if (((major == 2) && (minor >= 9)) || (major > 2))
+		{
+			int nForcePlates = 0;
+			ptr = read(ptr, nForcePlates);
+			ptr = readSectionSize(ptr, major, minor, nBytes);
+			ptr = nBytes >= 0 ? ptr + nBytes : skipChannelData(ptr, nForcePlates);
+		}
+
+		// Device data (version 2.11 and later)
+		if (((major == 2) && (minor >= 11)) || (major > 2))
+		{
+			int nDevices = 0;
+			ptr = read(ptr, nDevices);
+			ptr = readSectionSize(ptr, major, minor, nBytes);
+			ptr = nBytes >= 0 ? ptr + nBytes : skipChannelData(ptr, nDevices);
+		}
+
+		ptr = unpackFrameSuffix(ptr, view.latency, view.timecode, view.timecode_sub, view.timestamp);
+
+		return ptr - data;
+	}
+
+	void Parser::setParallelDecode(const shared_ptr<WorkerPool>& pool, size_t min_frame_bytes)
+	{
+		worker_pool = pool;
+		parallel_min_bytes = min_frame_bytes;
+	}
+
+	void Parser::unpackFrameParallel(const char* packet, Frame& frame)
+	{
+		const FrameView& v = parallel_index;
+		const unsigned int sections = subscription.sections;
+		const bool decode_markers = sections & DECODE_RIGIDBODY_MARKERS;
+
+		frame.frame_number = v.frame_number;
+		frame.latency = v.latency;
+		frame.timecode = v.timecode;
+		frame.timecode_sub = v.timecode_sub;
+		frame.timestamp = v.timestamp;
+
+		// size every output first, so that tasks only write their own slots
+		parallel_tasks.clear();
+
+		if (sections & DECODE_MARKERSETS)
+		{
+			frame.markers_set.resize(v.markersets.size());
+			frame.markerset_names.resize(v.markersets.size());
+			for (int i = 0; i < v.markersets.size(); i++)
+			{
+				frame.markerset_names[i] = packet + v.markersets[i].name;
+				parallel_tasks.push_back(ParallelTask(TASK_MARKERSET, i, 0));
+			}
+		}
+		else
+		{
+			frame.markers_set.clear();
+			frame.markerset_names.clear();
+		}
+
+		// unlabeled then labeled markers, as in the serial decoder
+		int num_unlabeled = (sections & DECODE_UNLABELED_MARKERS) ? v.markers.count : 0;
+		int num_labeled = (sections & DECODE_LABELED_MARKERS) ? v.labeled_markers.count : 0;
+		frame.markers.resize(num_unlabeled + num_labeled);
+		frame.num_unlabeled_markers = num_unlabeled;
+		labeled_marker_ids.resize(num_labeled);
+
+		for (int i = 0; i < frame.markers.size(); i += PARALLEL_MARKERS)
+			parallel_tasks.push_back(ParallelTask(TASK_MARKERS, i, i + PARALLEL_MARKERS));
+
+		parallel_rigidbodies.clear();
+		for (int i = 0; i < v.rigidbodies.size(); i++)
+			if (isAllowed(subscription.rigidbody_ids, v.rigidbodies[i].id)) parallel_rigidbodies.push_back(i);
+
+		frame.rigidbodies.resize(parallel_rigidbodies.size());
+		for (int i = 0; i < parallel_rigidbodies.size(); i += PARALLEL_RIGIDBODIES)
+			parallel_tasks.push_back(ParallelTask(TASK_RIGIDBODIES, i, i + PARALLEL_RIGIDBODIES));
+
+		parallel_skeletons.clear();
+		if (sections & DECODE_SKELETONS)
+		{
+			for (int i = 0; i < v.skeletons.size(); i++)
+				if (isAllowed(subscription.skeleton_ids, v.skeletons[i].id)) parallel_skeletons.push_back(i);
+		}
+
+		frame.skeletons.resize(parallel_skeletons.size());
+		for (int i = 0; i < parallel_skeletons.size(); i++)
+			parallel_tasks.push_back(ParallelTask(TASK_SKELETON, i, 0));
+
+		worker_pool->run(parallel_tasks.size(), [&](int t) {
+			const ParallelTask& task = parallel_tasks[t];
+
+			if (task.type == TASK_MARKERSET)
+			{
+				const FrameView::MarkerSetSection& s = v.markersets[task.begin];
+				vector<Marker>& markers = frame.markers_set[task.begin];
+				markers.resize(s.count);
+				if (s.count) config->transformPoints(packet + s.offset, s.count, markers.data());
+			}
+			else if (task.type == TASK_MARKERS)
+			{
+				int end = task.end < frame.markers.size() ? task.end : frame.markers.size();
+
+				int i = task.begin;
+				if (i < num_unlabeled)
+				{
+					int n = (end < num_unlabeled ? end : num_unlabeled) - i;
+					config->transformPoints(packet + v.markers.offset + i * sizeof(Vec3), n, &frame.markers[i]);
+					i += n;
+				}
+
+				for (; i < end; i++)
+				{
+					frame.markers[i] = v.getLabeledMarker(i - num_unlabeled);
+					labeled_marker_ids[i - num_unlabeled] = v.getLabeledMarkerId(i - num_unlabeled);
+				}
+			}
+			else if (task.type == TASK_RIGIDBODIES)
+			{
+				int end = task.end < parallel_rigidbodies.size() ? task.end : parallel_rigidbodies.size();
+				for (int i = task.begin; i < end; i++)
+				{
+					const FrameView::Entity& e = v.rigidbodies[parallel_rigidbodies[i]];
+					unpackRigidBody(packet + e.offset, frame.rigidbodies[i], v.major, v.minor,
+									*config, decode_markers);
+				}
+			}
+			else
+			{
+				const FrameView::Entity& e = v.skeletons[parallel_skeletons[task.begin]];
+				Skeleton& S = frame.skeletons[task.begin];
+				S.id = e.id;
+
+				const char* ptr = packet + e.offset;
+				int nJoints = 0;
+				ptr = read(ptr, nJoints);
+
+				S.joints.resize(nJoints);
+				for (int k = 0; k < nJoints; k++)
+					ptr = unpackRigidBody(ptr, S.joints[k], v.major, v.minor, *config, decode_markers);
+			}
+		});
+	}
+
+	void Parser::filterMarkers(Frame& frame)
+	{
+		frame.filterd_markers = frame.markers;
+
+		float duplicated_point_removal_distance = config->getDuplicatedPointRemovalDistance();
+		if (duplicated_point_removal_distance <= 0) return;
+
+		// 3.0 and later stream no rigid body markers. a labeled marker's id
+		// carries the id of its asset in the upper 16 bits instead.
+		if (NatNetVersion[0] >= 3)
+		{
+			filter_rigidbody_ids.resize(frame.rigidbodies.size());
+			for (int i = 0; i < frame.rigidbodies.size(); i++) filter_rigidbody_ids[i] = frame.rigidbodies[i].id;
+			sort(filter_rigidbody_ids.begin(), filter_rigidbody_ids.end());
+
+			// labeled markers follow the unlabeled ones
+			int first = frame.num_unlabeled_markers;
+			frame.filterd_markers.resize(first);
+
+			for (int i = 0; i < labeled_marker_ids.size(); i++)
+			{
+				int asset_id = (unsigned int)labeled_marker_ids[i] >> 16;
+				if (!binary_search(filter_rigidbody_ids.begin(), filter_rigidbody_ids.end(), asset_id))
+					frame.filterd_markers.push_back(frame.markers[first + i]);
+			}
+			return;
+		}
+
+		for (int j = 0; j < frame.rigidbodies.size(); j++)
+		{
+			const RigidBody& RB = frame.rigidbodies[j];
+
+			for (int i = 0; i < RB.markers.size(); i++)
+			{
+				vector<Marker>::iterator it = remove_if(
+					frame.filterd_markers.begin(), frame.filterd_markers.end(),
+					remove_dups(RB.markers[i], duplicated_point_removal_distance));
+				frame.filterd_markers.erase(it, frame.filterd_markers.end());
+			}
+		}
+	}
+
+	static const char* readName(const char* ptr, string& name)
+	{
+		name = ptr;
+		return ptr + strlen(ptr) + 1;
+	}
+
+	static const char* readJoint(const char* ptr, RigidBodyDescription& description, int major)
+	{
+		if (major >= 2)
+		{
+			// name
+			ptr = readName(ptr, description.name);
+		}
+
+		ptr = read(ptr, description.id);
+		ptr = read(ptr, description.parent_id);
+
+		ptr = read(ptr, description.offset.x);
+		ptr = read(ptr, description.offset.y);
+		ptr = read(ptr, description.offset.z);
+
+		// 3.0 and later: marker offsets and required labels, names from 4.0
+		if (major >= 3)
+		{
+			int nMarkers = 0;
+			ptr = read(ptr, nMarkers);
+
+			description.marker_offsets.resize(nMarkers);
+			for (int i = 0; i < nMarkers; i++)
+				ptr = read(ptr, description.marker_offsets[i]);
+
+			ptr += nMarkers * sizeof(int);
+
+			description.marker_names.resize(major >= 4 ? nMarkers : 0);
+			for (int i = 0; i < description.marker_names.size(); i++)
+				ptr = readName(ptr, description.marker_names[i]);
+		}
+
+		return ptr;
+	}
+
+	// descriptions that aren't kept, stepped over when there is no size prefix
+
+	static const char* skipForcePlateDescription(const char* ptr, int major)
+	{
+		// id, serial number
+		ptr += sizeof(int);
+		ptr += strlen(ptr) + 1;
+
+		// width, length, origin, 12x12 calibration matrix, corners
+		ptr += (2 + 3 + 12 * 12 + 4 * 3) * sizeof(float);
+
+		// plate type, channel data type (3.0 and later)
+		if (major >= 3) ptr += 2 * sizeof(int);
+
+		int nChannels = 0;
+		ptr = read(ptr, nChannels);
+		for (int i = 0; i < nChannels; i++) ptr += strlen(ptr) + 1;
+
+		return ptr;
+	}
+
+	static const char* skipDeviceDescription(const char* ptr)
+	{
+		// id, name, serial number, device type, channel data type
+		ptr += sizeof(int);
+		ptr += strlen(ptr) + 1;
+		ptr += strlen(ptr) + 1;
+		ptr += 2 * sizeof(int);
+
+		int nChannels = 0;
+		ptr = read(ptr, nChannels);
+		for (int i = 0; i < nChannels; i++) ptr += strlen(ptr) + 1;
+
+		return ptr;
+	}
+
+	static const char* skipCameraDescription(const char* ptr)
+	{
+		// name, position, orientation
+		ptr += strlen(ptr) + 1;
+		return ptr + 7 * sizeof(float);
+	}
+
+	bool Parser::parseDescriptions(const char* packet, Descriptions& descriptions)
+	{
+		if (getMessageId(packet) != NAT_MODELDEF || !checkVersion()) return false;
+
+		int major = NatNetVersion[0];
+		int minor = NatNetVersion[1];
+
+		const char* ptr = packet + 4;
+
+		descriptions.markersets.clear();
+		descriptions.rigidbodies.clear();
+		descriptions.skeletons.clear();
+
+		// number of datasets
+		int nDatasets = 0;
+		ptr = read(ptr, nDatasets);
+
+		for (int i = 0; i < nDatasets; i++)
+		{
+			int type = 0;
+			ptr = read(ptr, type);
+
+			// 4.1 and later: size of the description
+			int nBytes = 0;
+			ptr = readSectionSize(ptr, major, minor, nBytes);
+			const char* next = ptr + nBytes;
+
+			if (type == 0)  // markerset
+			{
+				MarkerSetDescription description;
+
+				// name
+				ptr = readName(ptr, description.name);
+
+				// marker data
+				int nMarkers = 0;
+				ptr = read(ptr, nMarkers);
+
+				description.marker_names.resize(nMarkers);
+				for (int j = 0; j < nMarkers; j++)
+					ptr = readName(ptr, description.marker_names[j]);
+
+				descriptions.markersets.push_back(description);
+			}
+			else if (type == 1)  // rigid body
+			{
+				RigidBodyDescription description;
+				ptr = readJoint(ptr, description, major);
+				descriptions.rigidbodies.push_back(description);
+			}
+			else if (type == 2)  // skeleton
+			{
+				SkeletonDescription description;
+
+				ptr = readName(ptr, description.name);
+				ptr = read(ptr, description.id);
+
+				int nRigidBodies = 0;
+				ptr = read(ptr, nRigidBodies);
+
+				description.joints.resize(nRigidBodies);
+				for (int j = 0; j < nRigidBodies; j++)
+					ptr = readJoint(ptr, description.joints[j], major);
+
+				buildSkeletonHierarchy(description);
+				descriptions.skeletons.push_back(description);
+			}
+			else if (nBytes >= 0)
+			{
+				// skipped below
+			}
+			else if (type == 3)  // force plate
+			{
+				ptr = skipForcePlateDescription(ptr, major);
+			}
+			else if (type == 4)  // device
+			{
+				ptr = skipDeviceDescription(ptr);
+			}
+			else if (type == 5)  // camera
+			{
+				ptr = skipCameraDescription(ptr);
+			}
+			else
+			{
+				logMessage(LOG_WARNING, "unknown description type %d, ignoring the last %d descriptions",
+						   type, nDatasets - i);
+				break;
+			}
+
+			if (nBytes >= 0) ptr = next;
+
+		}  // next dataset
+
+		descriptions.buildIndex();
+		return true;
+	}
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <memory>
+#include <vector>
+
+#include "DecodeConfig.h"
+#include "Frame.h"
+#include "FrameView.h"
+#include "WorkerPool.h"
+
+// NatNet 2.x - 4.1 packet decoder. no sockets, no threads, no locking:
+// the client owns one per receiver thread, tools can use one per worker.
+//
+// from 3.0 on rigid bodies no longer carry their marker positions
+// (RigidBody::markers stays empty; the markers come as labeled markers
+// with the body id in their upper 16 bits), and from 4.1 on every frame
+// section and description is prefixed with its size, which lets sections
+// left out of the subscription be skipped in one step.
+
+namespace NatNet
+{
+	// NatNet message ids
+	enum MessageId
+	{
+		NAT_PING = 0,
+		NAT_PINGRESPONSE = 1,
+		NAT_REQUEST = 2,
+		NAT_RESPONSE = 3,
+		NAT_REQUEST_MODELDEF = 4,
+		NAT_MODELDEF = 5,
+		NAT_REQUEST_FRAMEOFDATA = 6,
+		NAT_FRAMEOFDATA = 7,
+		NAT_MESSAGESTRING = 8,
+		NAT_UNRECOGNIZED_REQUEST = 100
+	};
+
+	// frame sections parseFrame() decodes, see Subscription
+	enum DecodeSection
+	{
+		DECODE_MARKERSETS = 0x01,
+		DECODE_UNLABELED_MARKERS = 0x02,
+		DECODE_RIGIDBODY_MARKERS = 0x04,  // RigidBody::markers, skeleton joints included
+		DECODE_SKELETONS = 0x08,
+		DECODE_LABELED_MARKERS = 0x10,
+		DECODE_ALL = 0x1f
+	};
+
+	// what parseFrame() materializes. sections and entities left out are
+	// stepped over by their sizes without being decoded, and are missing
+	// from the frame. rigid bodies are always decoded unless filtered by
+	// id. force plates are always skipped.
+	struct Subscription
+	{
+		unsigned int sections;
+		std::vector<int> rigidbody_ids;  // empty for all
+		std::vector<int> skeleton_ids;   // empty for all
+
+		Subscription()
+			: sections(DECODE_ALL)
+		{
+		}
+	};
+
+	class Parser
+	{
+	public:
+		static const int IMPL_MAJOR = 4;
+		static const int IMPL_MINOR = 1;
+
+		static const size_t MAX_PACKETSIZE = 100000;
+
+		// the decoders don't bounds-check against the payload size; packets
+		// must sit at the start of a buffer this large (zero-filled past
+		// the received bytes when it matters)
+		static const size_t PACKET_BUFFER_SIZE = 4 + MAX_PACKETSIZE;
+
+		Parser();
+
+		static int getMessageId(const char* packet);
+
+		// frame number of a NAT_FRAMEOFDATA packet, without decoding it
+		static int getFrameNumber(const char* packet);
+
+		// ping response: takes the server's NatNet version, and from 3.0 on
+		// its clock frequency
+		bool parsePingResponse(const char* packet);
+
+		// size is the datagram length, which picks the serial or the
+		// parallel decoder (see setParallelDecode()); 0 decodes serially
+		bool parseFrame(const char* packet, Frame& frame, size_t size = 0);
+		bool parseDescriptions(const char* packet, Descriptions& descriptions);
+
+		// records the layout of a frame packet in view without decoding it,
+		// see FrameView. the view keeps packet, and the current transform.
+		bool indexFrame(const PacketPool::Buffer& packet, FrameView& view) const;
+
+		// fills S.local_matrices and S.world_matrices in a single pass over
+		// the precomputed joint order. joints missing from the frame fall
+		// back to their description offset.
+		void solveSkeleton(Skeleton& S, const SkeletonDescription& desc);
+
+		static void buildSkeletonHierarchy(SkeletonDescription& desc);
+
+		// one rigid body of a frame packet from NatNet major.minor, with the
+		// config's transform applied. return the end of its data.
+		static const char* unpackRigidBody(const char* ptr, RigidBody& RB, int major, int minor,
+										   const DecodeConfig& config, bool decode_markers);
+		static const char* skipRigidBody(const char* ptr, int major, int minor);
+
+		void setNatNetVersion(int major, int minor);
+		void setServerVersion(int major, int minor);
+		inline int getNatNetMajor() const { return NatNetVersion[0]; }
+		inline int getNatNetMinor() const { return NatNetVersion[1]; }
+		inline int getServerMajor() const { return ServerVersion[0]; }
+		inline int getServerMinor() const { return ServerVersion[1]; }
+
+		// ticks per second of the 3.0+ frame timestamps, 0 when unknown.
+		// Frame::latency is derived from them when known.
+		inline uint64_t getServerClockFrequency() const { return server_clock_frequency; }
+		inline void setServerClockFrequency(uint64_t hz) { server_clock_frequency = hz; }
+
+		// output transform and marker filtering, see DecodeConfig. each
+		// frame is decoded against the snapshot held at its start; the
+		// setters below replace it with a modified copy.
+		void setConfig(const DecodeConfigPtr& config);
+		inline const DecodeConfigPtr& getConfig() const { return config; }
+
+		void setTransform(const Matrix4x4& m);
+		inline const Matrix4x4& getTransform() const { return config->getTransform(); }
+
+		// rotation part of the transform, applied to streamed orientations
+		inline const Quat& getTransformRotation() const { return config->getRotation(); }
+
+		// filterd_markers drops markers that belong to a rigid body when v > 0:
+		// before 3.0 those within v of the body's markers, from 3.0 on the
+		// labeled markers carrying the id of a decoded rigid body
+		void setDuplicatedPointRemovalDistance(float v);
+		inline float getDuplicatedPointRemovalDistance() const { return config->getDuplicatedPointRemovalDistance(); }
+
+		// decodes frames whose datagram is at least min_frame_bytes on
+		// pool: the packet is indexed first, then marker blocks, rigid
+		// bodies and skeletons are decoded as parallel tasks. smaller frames
+		// and a NULL pool use the serial decoder, without indexing.
+		void setParallelDecode(const std::shared_ptr<WorkerPool>& pool, size_t min_frame_bytes);
+
+		void setSubscription(const Subscription& subscription);
+		inline const Subscription& getSubscription() const { return subscription; }
+
+		// whether skeleton joints are streamed relative to their parent
+		// (Motive's "Local" skeleton coordinates, the default) or in world space
+		void setSkeletonLocalCoordinates(bool yn);
+		inline bool getSkeletonLocalCoordinates() const { return config->getSkeletonLocalCoordinates(); }
+
+	private:
+		int NatNetVersion[4];
+		int ServerVersion[4];
+		uint64_t server_clock_frequency;
+
+		DecodeConfigPtr config;
+
+		Subscription subscription;  // id lists sorted
+
+		enum ParallelTaskType
+		{
+			TASK_MARKERSET,    // begin: marker set index
+			TASK_MARKERS,      // [begin, end) of frame.markers
+			TASK_RIGIDBODIES,  // [begin, end) of frame.rigidbodies
+			TASK_SKELETON      // begin: skeleton index
+		};
+
+		struct ParallelTask
+		{
+			int type;
+			int begin;
+			int end;
+
+			ParallelTask(int type, int begin, int end)
+				: type(type)
+				, begin(begin)
+				, end(end)
+			{
+			}
+		};
+
+		// task granularity
+		static const int PARALLEL_MARKERS = 256;
+		static const int PARALLEL_RIGIDBODIES = 8;
+
+		std::shared_ptr<WorkerPool> worker_pool;
+		size_t parallel_min_bytes;
+
+		// scratch for unpackFrameParallel, reused across frames
+		FrameView parallel_index;
+		std::vector<ParallelTask> parallel_tasks;
+		std::vector<int> parallel_rigidbodies;  // allowed indices into parallel_index
+		std::vector<int> parallel_skeletons;
+
+		// ids of the labeled markers at the end of frame.markers, for
+		// filterMarkers. reused across frames
+		std::vector<int> labeled_marker_ids;
+		std::vector<int> filter_rigidbody_ids;
+
+		// scratch for solveSkeleton, reused across frames
+		std::vector<Quat> solve_orientations;
+		std::vector<Vec3> solve_positions;
+		std::vector<char> solve_present;
+
+		bool checkVersion() const;
+
+		// fills view's offsets for the frame packet at data, returns its size
+		size_t indexPacket(const char* data, FrameView& view) const;
+
+		void unpackFrameParallel(const char* packet, Frame& frame);
+		void filterMarkers(Frame& frame);
+
+		const char* unpackMarkers(const char* ptr, int nMarkers, std::vector<Marker>& markers);
+		const char* unpackRigidBodies(const char* ptr, int nRigidBodies, std::vector<RigidBody>& rigidbodies,
+									  const std::vector<int>& allowed_ids);
+
+		// latency, timecode, timestamps, params and end of data tag
+		const char* unpackFrameSuffix(const char* ptr, float& latency, unsigned int& timecode,
+									  unsigned int& timecode_sub, double& timestamp) const;
+
+	};
+}
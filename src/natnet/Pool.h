@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// objects shared by reference count. an object goes back to the pool when
+// its last reference is dropped, on whichever thread that happens, and is
+// handed out again as it was left, so its storage is reused. see
+// PacketPool and MarkerIndexPool.
+
+namespace NatNet
+{
+	template <class T>
+	class Pool
+	{
+	public:
+		typedef std::shared_ptr<T> Ptr;
+		typedef std::function<T*()> Factory;
+
+		// at most max_free are kept for reuse. new objects come from create,
+		// default constructed without one.
+		explicit Pool(size_t max_free, const Factory& create = Factory());
+
+		Ptr acquire();
+
+		size_t getNumFree() const;
+
+	private:
+		struct Shared
+		{
+			size_t max_free;
+			mutable std::mutex mutex;
+			std::vector<T*> free;
+
+			~Shared();
+		};
+
+		// held by every outstanding object, so the pool may go first
+		std::shared_ptr<Shared> shared;
+		Factory create;
+
+		static void release(const std::shared_ptr<Shared>& shared, T* object);
+	};
+
+	template <class T>
+	Pool<T>::Pool(size_t max_free, const Factory& create)
+		: shared(std::make_shared<Shared>())
+		, create(create)
+	{
+		shared->max_free = max_free;
+	}
+
+	template <class T>
+	Pool<T>::Shared::~Shared()
+	{
+		for (size_t i = 0; i < free.size(); i++) delete free[i];
+	}
+
+	template <class T>
+	typename Pool<T>::Ptr Pool<T>::acquire()
+	{
+		T* object = NULL;
+		{
+			std::lock_guard<std::mutex> guard(shared->mutex);
+			if (shared->free.size())
+			{
+				object = shared->free.back();
+				shared->free.pop_back();
+			}
+		}
+
+		if (object == NULL) object = create ? create() : new T();
+
+		std::shared_ptr<Shared> owner = shared;
+		return Ptr(object, [owner](T* object) { release(owner, object); });
+	}
+
+	template <class T>
+	void Pool<T>::release(const std::shared_ptr<Shared>& shared, T* object)
+	{
+		{
+			std::lock_guard<std::mutex> guard(shared->mutex);
+			if (shared->free.size() < shared->max_free)
+			{
+				shared->free.push_back(object);
+				return;
+			}
+		}
+		delete object;
+	}
+
+	template <class T>
+	size_t Pool<T>::getNumFree() const
+	{
+		std::lock_guard<std::mutex> guard(shared->mutex);
+		return shared->free.size();
+	}
+}
@@ -0,0 +1,121 @@
+#include "PoseBuffer.h"
+
+using namespace std;
+
+namespace NatNet
+{
+	// frames keep entities in vectors, the client state in maps by id
+	static inline const RigidBody& entity(const RigidBody& RB) { return RB; }
+	static inline const RigidBody& entity(const pair<const int, RigidBody>& it) { return it.second; }
+	static inline const Skeleton& entity(const Skeleton& S) { return S; }
+	static inline const Skeleton& entity(const pair<const int, Skeleton>& it) { return it.second; }
+
+	static inline void setParams(TransformInstance& t, float a, float b, float c, float d)
+	{
+		t.params[0] = a;
+		t.params[1] = b;
+		t.params[2] = c;
+		t.params[3] = d;
+	}
+
+	PoseBuffer::PoseBuffer()
+		: num_markers(0)
+		, num_filterd_markers(0)
+		, num_rigidbody_markers(0)
+		, num_rigidbodies(0)
+		, num_joints(0)
+		, frame_number(-1)
+	{
+	}
+
+	void PoseBuffer::clear()
+	{
+		markers.clear();
+		transforms.clear();
+		num_markers = 0;
+		num_filterd_markers = 0;
+		num_rigidbody_markers = 0;
+		num_rigidbodies = 0;
+		num_joints = 0;
+		frame_number = -1;
+	}
+
+	void PoseBuffer::fill(const Frame& frame)
+	{
+		fillInstances(frame.frame_number, frame.markers, frame.filterd_markers,
+					  frame.rigidbodies, frame.skeletons);
+	}
+
+	void PoseBuffer::fill(int frame_number, const vector<Marker>& markers,
+						  const vector<Marker>& filterd_markers,
+						  const map<int, RigidBody>& rigidbodies,
+						  const map<int, Skeleton>& skeletons)
+	{
+		fillInstances(frame_number, markers, filterd_markers, rigidbodies, skeletons);
+	}
+
+	template <class RigidBodies, class Skeletons>
+	void PoseBuffer::fillInstances(int frame_number, const vector<Marker>& markers,
+								   const vector<Marker>& filterd_markers,
+								   const RigidBodies& rigidbodies, const Skeletons& skeletons)
+	{
+		size_t num_rigidbody_markers = 0;
+		for (typename RigidBodies::const_iterator it = rigidbodies.begin(); it != rigidbodies.end(); ++it)
+			num_rigidbody_markers += entity(*it).markers.size();
+
+		size_t num_joints = 0;
+		for (typename Skeletons::const_iterator it = skeletons.begin(); it != skeletons.end(); ++it)
+			num_joints += entity(*it).world_matrices.size();
+
+		this->frame_number = frame_number;
+		this->num_markers = markers.size();
+		this->num_filterd_markers = filterd_markers.size();
+		this->num_rigidbody_markers = num_rigidbody_markers;
+		this->num_rigidbodies = rigidbodies.size();
+		this->num_joints = num_joints;
+
+		this->markers.resize(num_markers + num_filterd_markers + num_rigidbody_markers);
+		transforms.resize(num_rigidbodies + num_joints);
+
+		MarkerInstance* m = this->markers.data();
+
+		for (int i = 0; i < markers.size(); i++, m++)
+		{
+			m->position = markers[i];
+			m->id = -1;
+		}
+
+		for (int i = 0; i < filterd_markers.size(); i++, m++)
+		{
+			m->position = filterd_markers[i];
+			m->id = -1;
+		}
+
+		TransformInstance* t = transforms.data();
+
+		for (typename RigidBodies::const_iterator it = rigidbodies.begin(); it != rigidbodies.end(); ++it, t++)
+		{
+			const RigidBody& RB = entity(*it);
+
+			for (int n = 0; n < RB.markers.size(); n++, m++)
+			{
+				m->position = RB.markers[n];
+				m->id = RB.id;
+			}
+
+			t->matrix = makePoseMatrix(RB.position, RB.orientation);
+			setParams(*t, RB.id, RB.active ? 1 : 0, RB.mean_marker_error, 0);
+		}
+
+		for (typename Skeletons::const_iterator it = skeletons.begin(); it != skeletons.end(); ++it)
+		{
+			const Skeleton& S = entity(*it);
+
+			for (int n = 0; n < S.world_matrices.size(); n++, t++)
+			{
+				t->matrix = S.world_matrices[n];
+				setParams(*t, n, 1, 0, S.id);
+			}
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <map>
+#include <vector>
+
+#include "Frame.h"
+
+// per-instance records for instanced drawing, filled from a frame or the
+// client's state with plain copies, no GL calls.
+//
+// both record types are tightly packed floats, so the vectors can be
+// uploaded as-is as instance attributes (divisor 1) and each section drawn
+// with one call. the vectors only grow, so a buffer kept across frames
+// stops allocating.
+
+namespace NatNet
+{
+	struct MarkerInstance
+	{
+		Vec3 position;
+		float id;  // owning rigid body id for rigid body markers, -1 otherwise
+	};
+
+	struct TransformInstance
+	{
+		Matrix4x4 matrix;
+
+		// rigid bodies: id, active (0 / 1), mean marker error, 0
+		// skeleton joints: description joint index, 1, 0, skeleton id
+		float params[4];
+	};
+
+	class PoseBuffer
+	{
+	public:
+		// [0, num_markers) unlabeled markers, followed by num_filterd_markers
+		// filtered markers and num_rigidbody_markers rigid body markers
+		std::vector<MarkerInstance> markers;
+
+		// [0, num_rigidbodies) rigid bodies, followed by num_joints solved
+		// skeleton joints (world matrices)
+		std::vector<TransformInstance> transforms;
+
+		size_t num_markers;
+		size_t num_filterd_markers;
+		size_t num_rigidbody_markers;
+		size_t num_rigidbodies;
+		size_t num_joints;
+
+		int frame_number;
+
+		PoseBuffer();
+
+		// no instances, storage kept
+		void clear();
+
+		// from a decoded frame, e.g. in the frame callback
+		void fill(const Frame& frame);
+
+		// from per-id entries, e.g. Client::State under Client::lock()
+		void fill(int frame_number, const std::vector<Marker>& markers,
+				  const std::vector<Marker>& filterd_markers,
+				  const std::map<int, RigidBody>& rigidbodies,
+				  const std::map<int, Skeleton>& skeletons);
+
+		inline const MarkerInstance* getFilterdMarkers() const { return markers.data() + num_markers; }
+		inline const MarkerInstance* getRigidBodyMarkers() const { return getFilterdMarkers() + num_filterd_markers; }
+		inline const TransformInstance* getJoints() const { return transforms.data() + num_rigidbodies; }
+
+	private:
+		template <class RigidBodies, class Skeletons>
+		void fillInstances(int frame_number, const std::vector<Marker>& markers,
+						   const std::vector<Marker>& filterd_markers,
+						   const RigidBodies& rigidbodies, const Skeletons& skeletons);
+	};
+}
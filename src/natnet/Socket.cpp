@@ -0,0 +1,341 @@
+#include "Socket.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace NatNet
+{
+#if defined(_WIN32)
+	struct WinsockInit
+	{
+		WinsockInit()
+		{
+			WSADATA data;
+			WSAStartup(MAKEWORD(2, 2), &data);
+		}
+		~WinsockInit() { WSACleanup(); }
+	};
+
+	static void initSockets() { static WinsockInit init; }
+#else
+	static void initSockets() {}
+#endif
+
+	static sockaddr_in toSockaddr(const Address& addr)
+	{
+		sockaddr_in sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family = AF_INET;
+		sa.sin_addr.s_addr = addr.ip;
+		sa.sin_port = htons(addr.port);
+		return sa;
+	}
+
+	bool Address::resolve(const std::string& host, int port, Address& out)
+	{
+		initSockets();
+
+		addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+
+		addrinfo* result = NULL;
+		if (getaddrinfo(host.c_str(), NULL, &hints, &result) != 0 || result == NULL)
+			return false;
+
+		out.ip = ((sockaddr_in*)result->ai_addr)->sin_addr.s_addr;
+		out.port = port;
+		freeaddrinfo(result);
+		return true;
+	}
+
+	bool Address::fromInterface(const std::string& name_or_address, Address& out)
+	{
+		initSockets();
+
+		in_addr a;
+		if (inet_pton(AF_INET, name_or_address.c_str(), &a) == 1)
+		{
+			out.ip = a.s_addr;
+			out.port = 0;
+			return true;
+		}
+
+#if defined(_WIN32)
+		return false;
+#else
+		ifaddrs* list = NULL;
+		if (getifaddrs(&list) != 0) return false;
+
+		bool found = false;
+		for (ifaddrs* it = list; it; it = it->ifa_next)
+		{
+			if (it->ifa_addr == NULL || it->ifa_addr->sa_family != AF_INET) continue;
+			if (name_or_address != it->ifa_name) continue;
+
+			out.ip = ((sockaddr_in*)it->ifa_addr)->sin_addr.s_addr;
+			out.port = 0;
+			found = true;
+			break;
+		}
+
+		freeifaddrs(list);
+		return found;
+#endif
+	}
+
+	std::string Address::toString() const
+	{
+		const unsigned char* b = (const unsigned char*)&ip;
+		char str[32];
+		snprintf(str, sizeof(str), "%d.%d.%d.%d:%d", b[0], b[1], b[2], b[3], port);
+		return str;
+	}
+
+	UdpSocket::UdpSocket()
+		: fd(INVALID)
+		, drop_counter(false)
+		, num_drops(0)
+		, timestamps(false)
+		, last_timestamp(0)
+	{
+	}
+
+	UdpSocket::~UdpSocket() { close(); }
+
+	bool UdpSocket::open()
+	{
+		initSockets();
+		close();
+		fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		return fd != INVALID;
+	}
+
+	void UdpSocket::close()
+	{
+		if (fd == INVALID) return;
+#if defined(_WIN32)
+		closesocket(fd);
+#else
+		::close(fd);
+#endif
+		fd = INVALID;
+		drop_counter = false;
+		num_drops = 0;
+		timestamps = false;
+		last_timestamp = 0;
+	}
+
+	bool UdpSocket::bind(const Address& addr, bool reuse_address)
+	{
+		if (reuse_address)
+		{
+			int yes = 1;
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+#if defined(SO_REUSEPORT)
+			setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (const char*)&yes, sizeof(yes));
+#endif
+		}
+
+		sockaddr_in sa = toSockaddr(addr);
+		return ::bind(fd, (sockaddr*)&sa, sizeof(sa)) == 0;
+	}
+
+	bool UdpSocket::connect(const Address& addr)
+	{
+		sockaddr_in sa = toSockaddr(addr);
+		return ::connect(fd, (sockaddr*)&sa, sizeof(sa)) == 0;
+	}
+
+	bool UdpSocket::joinGroup(const Address& group, const Address& interface_addr)
+	{
+		ip_mreq mreq;
+		memset(&mreq, 0, sizeof(mreq));
+		mreq.imr_multiaddr.s_addr = group.ip;
+		mreq.imr_interface.s_addr = interface_addr.ip;
+		return setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&mreq, sizeof(mreq)) == 0;
+	}
+
+	bool UdpSocket::setBlocking(bool yn)
+	{
+#if defined(_WIN32)
+		u_long mode = yn ? 0 : 1;
+		return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#else
+		int flags = fcntl(fd, F_GETFL, 0);
+		if (flags < 0) return false;
+		flags = yn ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+		return fcntl(fd, F_SETFL, flags) == 0;
+#endif
+	}
+
+	bool UdpSocket::setBroadcast(bool yn)
+	{
+		int v = yn ? 1 : 0;
+		return setsockopt(fd, SOL_SOCKET, SO_BROADCAST, (const char*)&v, sizeof(v)) == 0;
+	}
+
+	bool UdpSocket::setReceiveBufferSize(int size)
+	{
+		bool ok = setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (const char*)&size, sizeof(size)) == 0;
+#if defined(SO_RCVBUFFORCE)
+		// over rmem_max; only works with CAP_NET_ADMIN
+		if (ok && getReceiveBufferSize() < size)
+			setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, (const char*)&size, sizeof(size));
+#endif
+		return ok;
+	}
+
+	bool UdpSocket::setSendBufferSize(int size)
+	{
+		return setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (const char*)&size, sizeof(size)) == 0;
+	}
+
+	int UdpSocket::getReceiveBufferSize() const
+	{
+		int size = 0;
+		socklen_t len = sizeof(size);
+		if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char*)&size, &len) != 0) return -1;
+#if defined(__linux__)
+		// linux doubles the value it grants, see socket(7)
+		size /= 2;
+#endif
+		return size;
+	}
+
+	int UdpSocket::getSendBufferSize() const
+	{
+		int size = 0;
+		socklen_t len = sizeof(size);
+		if (getsockopt(fd, SOL_SOCKET, SO_SNDBUF, (char*)&size, &len) != 0) return -1;
+#if defined(__linux__)
+		size /= 2;
+#endif
+		return size;
+	}
+
+	bool UdpSocket::poll(int timeout_usec) const
+	{
+		if (fd == INVALID) return false;
+
+		fd_set set;
+		FD_ZERO(&set);
+		FD_SET(fd, &set);
+
+		timeval tv;
+		tv.tv_sec = timeout_usec / 1000000;
+		tv.tv_usec = timeout_usec % 1000000;
+
+		return select((int)fd + 1, &set, NULL, NULL, &tv) > 0;
+	}
+
+	int UdpSocket::send(const void* data, size_t size)
+	{
+		return (int)::send(fd, (const char*)data, (int)size, 0);
+	}
+
+	int UdpSocket::sendTo(const void* data, size_t size, const Address& addr)
+	{
+		sockaddr_in sa = toSockaddr(addr);
+		return (int)::sendto(fd, (const char*)data, (int)size, 0, (sockaddr*)&sa, sizeof(sa));
+	}
+
+	bool UdpSocket::enableDropCounter()
+	{
+#if defined(SO_RXQ_OVFL)
+		int yes = 1;
+		drop_counter = setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &yes, sizeof(yes)) == 0;
+#endif
+		return drop_counter;
+	}
+
+	bool UdpSocket::enableTimestamps()
+	{
+#if defined(SO_TIMESTAMPNS)
+		int yes = 1;
+		timestamps = setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &yes, sizeof(yes)) == 0;
+#endif
+		return timestamps;
+	}
+
+	bool UdpSocket::setBusyPoll(int usec)
+	{
+#if defined(SO_BUSY_POLL)
+		return setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) == 0;
+#else
+		return usec == 0;
+#endif
+	}
+
+	int UdpSocket::receive(void* data, size_t size)
+	{
+#if defined(__linux__)
+		if (drop_counter || timestamps)
+		{
+			iovec iov;
+			iov.iov_base = data;
+			iov.iov_len = size;
+
+			char control[CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(sizeof(timespec))];
+
+			msghdr msg;
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = &iov;
+			msg.msg_iovlen = 1;
+			msg.msg_control = control;
+			msg.msg_controllen = sizeof(control);
+
+			int n = (int)::recvmsg(fd, &msg, 0);
+			if (n < 0) return n;
+
+			for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c))
+			{
+				if (c->cmsg_level != SOL_SOCKET) continue;
+
+				// only attached once something was dropped
+				if (c->cmsg_type == SO_RXQ_OVFL)
+					memcpy(&num_drops, CMSG_DATA(c), sizeof(num_drops));
+				else if (c->cmsg_type == SCM_TIMESTAMPNS)
+				{
+					timespec ts;
+					memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+					last_timestamp = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+				}
+			}
+			return n;
+		}
+#endif
+		return (int)::recv(fd, (char*)data, (int)size, 0);
+	}
+
+	std::string UdpSocket::getLastError()
+	{
+#if defined(_WIN32)
+		char str[64];
+		snprintf(str, sizeof(str), "winsock error %d", WSAGetLastError());
+		return str;
+#else
+		return strerror(errno);
+#endif
+	}
+}
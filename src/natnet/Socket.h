@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+// thin IPv4 UDP socket over BSD sockets / Winsock, just what the NatNet
+// client needs. calls return false / -1 on failure; getLastError() has
+// the reason.
+
+namespace NatNet
+{
+	struct Address
+	{
+		uint32_t ip;    // network byte order
+		uint16_t port;  // host byte order
+
+		Address()
+			: ip(0)
+			, port(0)
+		{
+		}
+
+		// dotted quad or host name
+		static bool resolve(const std::string& host, int port, Address& out);
+
+		// dotted quad, or an interface name (POSIX only)
+		static bool fromInterface(const std::string& name_or_address, Address& out);
+
+		std::string toString() const;
+	};
+
+	class UdpSocket
+	{
+	public:
+		UdpSocket();
+		~UdpSocket();
+
+		bool open();
+		void close();
+		inline bool isOpen() const { return fd != INVALID; }
+
+		bool bind(const Address& addr, bool reuse_address);
+		bool connect(const Address& addr);
+		bool joinGroup(const Address& group, const Address& interface_addr);
+
+		bool setBlocking(bool yn);
+		bool setBroadcast(bool yn);
+		// the kernel may clamp the size (net.core.rmem_max on Linux, where a
+		// privileged process bypasses the limit). the getters return the
+		// usable size granted, without Linux's bookkeeping overhead.
+		bool setReceiveBufferSize(int size);
+		bool setSendBufferSize(int size);
+		int getReceiveBufferSize() const;
+		int getSendBufferSize() const;
+
+		// counts datagrams the kernel dropped because the receive buffer was
+		// full (SO_RXQ_OVFL, Linux only). receive() then keeps getNumDrops()
+		// up to date; it counts from when the socket was opened, and drops
+		// show up with the next datagram received after them.
+		bool enableDropCounter();
+		inline bool hasDropCounter() const { return drop_counter; }
+		inline uint32_t getNumDrops() const { return num_drops; }
+
+		// kernel receive timestamps (SO_TIMESTAMPNS, Linux only).
+		// getLastTimestamp() is the wall clock time the last datagram
+		// received arrived at the socket, in ns since the unix epoch.
+		bool enableTimestamps();
+		inline bool hasTimestamps() const { return timestamps; }
+		inline int64_t getLastTimestamp() const { return last_timestamp; }
+
+		// busy polls the device queue for up to usec on blocking reads
+		// (SO_BUSY_POLL, Linux only). 0 disables.
+		bool setBusyPoll(int usec);
+
+		// waits up to timeout_usec for a datagram, 0 polls
+		bool poll(int timeout_usec) const;
+
+		int send(const void* data, size_t size);
+		int sendTo(const void* data, size_t size, const Address& addr);
+		int receive(void* data, size_t size);
+
+		static std::string getLastError();
+
+	private:
+#if defined(_WIN32)
+		typedef uintptr_t Handle;
+		static const Handle INVALID = ~(Handle)0;
+#else
+		typedef int Handle;
+		static const Handle INVALID = -1;
+#endif
+
+		Handle fd;
+		bool drop_counter;
+		uint32_t num_drops;
+		bool timestamps;
+		int64_t last_timestamp;
+
+		UdpSocket(const UdpSocket&);
+		UdpSocket& operator=(const UdpSocket&);
+	};
+}
@@ -0,0 +1,76 @@
+#include "Thread.h"
+
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace NatNet
+{
+	int getNumCpus()
+	{
+		int n = std::thread::hardware_concurrency();
+		return n > 0 ? n : 1;
+	}
+
+	bool setThreadAffinity(int cpu)
+	{
+		int num_cpus = getNumCpus();
+		if (cpu >= num_cpus) return false;
+
+#if defined(_WIN32)
+		DWORD_PTR mask = 0;
+		if (cpu < 0)
+		{
+			DWORD_PTR system_mask = 0;
+			if (!GetProcessAffinityMask(GetCurrentProcess(), &mask, &system_mask)) return false;
+		}
+		else
+		{
+			if (cpu >= (int)(sizeof(mask) * 8)) return false;
+			mask = (DWORD_PTR)1 << cpu;
+		}
+		return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (cpu < 0)
+		{
+			for (int i = 0; i < num_cpus && i < CPU_SETSIZE; i++) CPU_SET(i, &set);
+		}
+		else
+		{
+			CPU_SET(cpu, &set);
+		}
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+		return cpu < 0;
+#endif
+	}
+
+	bool setThreadRealtimePriority(int priority)
+	{
+#if defined(_WIN32)
+		int p = priority > 0 ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_NORMAL;
+		return SetThreadPriority(GetCurrentThread(), p) != 0;
+#else
+		sched_param param;
+		int policy = SCHED_OTHER;
+		param.sched_priority = 0;
+
+		if (priority > 0)
+		{
+			int lo = sched_get_priority_min(SCHED_FIFO);
+			int hi = sched_get_priority_max(SCHED_FIFO);
+			policy = SCHED_FIFO;
+			param.sched_priority = priority < lo ? lo : (priority > hi ? hi : priority);
+		}
+
+		return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+#endif
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// scheduling controls for the calling thread. calls return false when the
+// platform doesn't support them or the process lacks the privilege
+// (SCHED_FIFO needs CAP_SYS_NICE or an rtprio limit on Linux).
+
+namespace NatNet
+{
+	// pins the calling thread to one core, -1 allows all cores again.
+	// Linux and Windows; macOS has no hard affinity.
+	bool setThreadAffinity(int cpu);
+
+	// 1..99 requests SCHED_FIFO at that priority (time-critical priority
+	// on Windows), 0 returns to normal scheduling
+	bool setThreadRealtimePriority(int priority);
+
+	int getNumCpus();
+}
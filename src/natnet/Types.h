@@ -0,0 +1,278 @@
+#pragma once
+
+#include <math.h>
+
+// plain math types for the openFrameworks-free core.
+//
+// conventions follow ofMatrix4x4 / ofQuaternion so values convert by
+// memcpy: matrices are row-major and act on row vectors (v' = v * M,
+// translation in m[12..14]); compose(a, b) applies a first, then b, like
+// ofQuaternion's a * b.
+
+namespace NatNet
+{
+	struct Vec3
+	{
+		float x, y, z;
+	};
+
+	struct Quat
+	{
+		float x, y, z, w;
+	};
+
+	struct Matrix4x4
+	{
+		float m[16];
+	};
+
+	inline Vec3 makeVec3(float x, float y, float z)
+	{
+		Vec3 v = { x, y, z };
+		return v;
+	}
+
+	inline Quat makeQuat(float x, float y, float z, float w)
+	{
+		Quat q = { x, y, z, w };
+		return q;
+	}
+
+	inline Quat identityQuat() { return makeQuat(0, 0, 0, 1); }
+
+	inline Matrix4x4 identityMatrix()
+	{
+		Matrix4x4 r = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+		return r;
+	}
+
+	inline Vec3 operator+(const Vec3& a, const Vec3& b) { return makeVec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	inline Vec3 operator-(const Vec3& a, const Vec3& b) { return makeVec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline Vec3 operator*(const Vec3& a, float s) { return makeVec3(a.x * s, a.y * s, a.z * s); }
+
+	inline float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline float lengthSquared(const Vec3& a) { return dot(a, a); }
+	inline float length(const Vec3& a) { return sqrtf(dot(a, a)); }
+
+	// same test as ofVec3f::match
+	inline bool match(const Vec3& a, const Vec3& b, float tolerance)
+	{
+		return fabsf(a.x - b.x) < tolerance && fabsf(a.y - b.y) < tolerance
+			&& fabsf(a.z - b.z) < tolerance;
+	}
+
+	// a first, then b
+	inline Quat compose(const Quat& a, const Quat& b)
+	{
+		return makeQuat(b.w * a.x + b.x * a.w + b.y * a.z - b.z * a.y,
+						b.w * a.y - b.x * a.z + b.y * a.w + b.z * a.x,
+						b.w * a.z + b.x * a.y - b.y * a.x + b.z * a.w,
+						b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z);
+	}
+
+	inline Quat inverse(const Quat& q)
+	{
+		float n = q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w;
+		if (n <= 0) return identityQuat();
+		float inv = 1.0f / n;
+		return makeQuat(-q.x * inv, -q.y * inv, -q.z * inv, q.w * inv);
+	}
+
+	inline float dot(const Quat& a, const Quat& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+
+	// shortest-arc spherical interpolation, t in [0, 1]
+	inline Quat slerp(const Quat& a, const Quat& b, float t)
+	{
+		float c = dot(a, b);
+		float sign = 1;
+		if (c < 0)
+		{
+			c = -c;
+			sign = -1;
+		}
+
+		float ka, kb;
+		if (c > 0.9995f)
+		{
+			// nearly parallel, lerp and renormalize
+			ka = 1 - t;
+			kb = t * sign;
+			Quat r = makeQuat(a.x * ka + b.x * kb, a.y * ka + b.y * kb, a.z * ka + b.z * kb, a.w * ka + b.w * kb);
+			float n = sqrtf(dot(r, r));
+			return n > 0 ? makeQuat(r.x / n, r.y / n, r.z / n, r.w / n) : a;
+		}
+
+		float theta = acosf(c);
+		float s = 1 / sinf(theta);
+		ka = sinf((1 - t) * theta) * s;
+		kb = sinf(t * theta) * s * sign;
+		return makeQuat(a.x * ka + b.x * kb, a.y * ka + b.y * kb, a.z * ka + b.z * kb, a.w * ka + b.w * kb);
+	}
+
+	// rotation angle between two unit quaternions, radians
+	inline float angleBetween(const Quat& a, const Quat& b)
+	{
+		float c = fabsf(dot(a, b));
+		return c >= 1 ? 0 : 2 * acosf(c);
+	}
+
+	inline Vec3 rotate(const Quat& q, const Vec3& v)
+	{
+		// v + 2w (u x v) + 2 u x (u x v)
+		Vec3 u = makeVec3(q.x, q.y, q.z);
+		Vec3 t = makeVec3(2 * (u.y * v.z - u.z * v.y),
+						  2 * (u.z * v.x - u.x * v.z),
+						  2 * (u.x * v.y - u.y * v.x));
+		return makeVec3(v.x + q.w * t.x + (u.y * t.z - u.z * t.y),
+						v.y + q.w * t.y + (u.z * t.x - u.x * t.z),
+						v.z + q.w * t.z + (u.x * t.y - u.y * t.x));
+	}
+
+	// ofMatrix4x4::setRotate
+	inline void setRotate(Matrix4x4& r, const Quat& q)
+	{
+		float x2 = q.x + q.x, y2 = q.y + q.y, z2 = q.z + q.z;
+		float xx = q.x * x2, xy = q.x * y2, xz = q.x * z2;
+		float yy = q.y * y2, yz = q.y * z2, zz = q.z * z2;
+		float wx = q.w * x2, wy = q.w * y2, wz = q.w * z2;
+
+		float* m = r.m;
+		m[0] = 1 - (yy + zz); m[1] = xy + wz;       m[2] = xz - wy;
+		m[4] = xy - wz;       m[5] = 1 - (xx + zz); m[6] = yz + wx;
+		m[8] = xz + wy;       m[9] = yz - wx;       m[10] = 1 - (xx + yy);
+	}
+
+	inline void setTranslation(Matrix4x4& r, const Vec3& t)
+	{
+		r.m[12] = t.x;
+		r.m[13] = t.y;
+		r.m[14] = t.z;
+	}
+
+	inline Vec3 getTranslation(const Matrix4x4& r) { return makeVec3(r.m[12], r.m[13], r.m[14]); }
+
+	inline Matrix4x4 makePoseMatrix(const Vec3& position, const Quat& orientation)
+	{
+		Matrix4x4 r = identityMatrix();
+		setRotate(r, orientation);
+		setTranslation(r, position);
+		return r;
+	}
+
+	// makePoseMatrix() for count poses. strides are in bytes, so positions
+	// and orientations can be packed arrays or members of larger structs.
+	// straight-line math without branches, for the compiler to vectorize.
+	inline void makePoseMatrices(const Vec3* positions, size_t position_stride,
+								 const Quat* orientations, size_t orientation_stride,
+								 int count, Matrix4x4* out)
+	{
+		const char* pp = (const char*)positions;
+		const char* qp = (const char*)orientations;
+
+		for (int i = 0; i < count; i++, pp += position_stride, qp += orientation_stride)
+		{
+			const Vec3& t = *(const Vec3*)pp;
+			const Quat& q = *(const Quat*)qp;
+
+			float x2 = q.x + q.x, y2 = q.y + q.y, z2 = q.z + q.z;
+			float xx = q.x * x2, xy = q.x * y2, xz = q.x * z2;
+			float yy = q.y * y2, yz = q.y * z2, zz = q.z * z2;
+			float wx = q.w * x2, wy = q.w * y2, wz = q.w * z2;
+
+			float* m = out[i].m;
+			m[0] = 1 - (yy + zz); m[1] = xy + wz;       m[2] = xz - wy;        m[3] = 0;
+			m[4] = xy - wz;       m[5] = 1 - (xx + zz); m[6] = yz + wx;        m[7] = 0;
+			m[8] = xz + wy;       m[9] = yz - wx;       m[10] = 1 - (xx + yy); m[11] = 0;
+			m[12] = t.x;          m[13] = t.y;          m[14] = t.z;           m[15] = 1;
+		}
+	}
+
+	inline Matrix4x4 makeScaleMatrix(float x, float y, float z)
+	{
+		Matrix4x4 r = identityMatrix();
+		r.m[0] = x;
+		r.m[5] = y;
+		r.m[10] = z;
+		return r;
+	}
+
+	// a * b: applies a first, then b
+	inline Matrix4x4 multiply(const Matrix4x4& a, const Matrix4x4& b)
+	{
+		Matrix4x4 r;
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				r.m[i * 4 + j] = a.m[i * 4 + 0] * b.m[0 * 4 + j] + a.m[i * 4 + 1] * b.m[1 * 4 + j]
+					+ a.m[i * 4 + 2] * b.m[2 * 4 + j] + a.m[i * 4 + 3] * b.m[3 * 4 + j];
+			}
+		}
+		return r;
+	}
+
+	// ofMatrix4x4::preMult(ofVec3f), v * M with perspective divide
+	inline Vec3 transformPoint(const Matrix4x4& r, const Vec3& v)
+	{
+		const float* m = r.m;
+		float d = 1.0f / (m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15]);
+		return makeVec3((m[0] * v.x + m[4] * v.y + m[8] * v.z + m[12]) * d,
+						(m[1] * v.x + m[5] * v.y + m[9] * v.z + m[13]) * d,
+						(m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14]) * d);
+	}
+
+	inline Vec3 getScale(const Matrix4x4& r)
+	{
+		const float* m = r.m;
+		return makeVec3(sqrtf(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]),
+						sqrtf(m[4] * m[4] + m[5] * m[5] + m[6] * m[6]),
+						sqrtf(m[8] * m[8] + m[9] * m[9] + m[10] * m[10]));
+	}
+
+	// rotation part of an affine matrix, scale removed
+	inline Quat getRotate(const Matrix4x4& r)
+	{
+		Vec3 s = getScale(r);
+		float sx = s.x > 0 ? 1 / s.x : 0, sy = s.y > 0 ? 1 / s.y : 0, sz = s.z > 0 ? 1 / s.z : 0;
+
+		float m00 = r.m[0] * sx, m01 = r.m[1] * sx, m02 = r.m[2] * sx;
+		float m10 = r.m[4] * sy, m11 = r.m[5] * sy, m12 = r.m[6] * sy;
+		float m20 = r.m[8] * sz, m21 = r.m[9] * sz, m22 = r.m[10] * sz;
+
+		Quat q;
+		float trace = m00 + m11 + m22;
+		if (trace > 0)
+		{
+			float k = 0.5f / sqrtf(trace + 1);
+			q.w = 0.25f / k;
+			q.x = (m12 - m21) * k;
+			q.y = (m20 - m02) * k;
+			q.z = (m01 - m10) * k;
+		}
+		else if (m00 > m11 && m00 > m22)
+		{
+			float k = 2 * sqrtf(1 + m00 - m11 - m22);
+			q.w = (m12 - m21) / k;
+			q.x = 0.25f * k;
+			q.y = (m10 + m01) / k;
+			q.z = (m20 + m02) / k;
+		}
+		else if (m11 > m22)
+		{
+			float k = 2 * sqrtf(1 + m11 - m00 - m22);
+			q.w = (m20 - m02) / k;
+			q.x = (m10 + m01) / k;
+			q.y = 0.25f * k;
+			q.z = (m21 + m12) / k;
+		}
+		else
+		{
+			float k = 2 * sqrtf(1 + m22 - m00 - m11);
+			q.w = (m01 - m10) / k;
+			q.x = (m20 + m02) / k;
+			q.y = (m21 + m12) / k;
+			q.z = 0.25f * k;
+		}
+		return q;
+	}
+}
@@ -0,0 +1,78 @@
+#include "WorkerPool.h"
+
+using namespace std;
+
+namespace NatNet
+{
+	WorkerPool::WorkerPool(int num_threads)
+		: job(NULL)
+		, num_tasks(0)
+		, next_task(0)
+		, num_busy(0)
+		, generation(0)
+		, quit(false)
+	{
+		for (int i = 1; i < num_threads; i++) threads.push_back(thread(&WorkerPool::worker, this));
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			lock_guard<std::mutex> guard(mutex);
+			quit = true;
+		}
+		start_condition.notify_all();
+
+		for (int i = 0; i < threads.size(); i++) threads[i].join();
+	}
+
+	void WorkerPool::run(int num_tasks, const function<void(int)>& task)
+	{
+		if (threads.empty() || num_tasks < 2)
+		{
+			for (int i = 0; i < num_tasks; i++) task(i);
+			return;
+		}
+
+		{
+			lock_guard<std::mutex> guard(mutex);
+			job = &task;
+			this->num_tasks = num_tasks;
+			next_task = 0;
+			num_busy = threads.size();
+			generation++;
+		}
+		start_condition.notify_all();
+
+		work();
+
+		unique_lock<std::mutex> guard(mutex);
+		done_condition.wait(guard, [this] { return num_busy == 0; });
+		job = NULL;
+	}
+
+	void WorkerPool::work()
+	{
+		for (int i = next_task++; i < num_tasks; i = next_task++) (*job)(i);
+	}
+
+	void WorkerPool::worker()
+	{
+		uint64_t seen = 0;
+
+		while (true)
+		{
+			{
+				unique_lock<std::mutex> guard(mutex);
+				start_condition.wait(guard, [&] { return quit || generation != seen; });
+				if (quit) return;
+				seen = generation;
+			}
+
+			work();
+
+			lock_guard<std::mutex> guard(mutex);
+			if (--num_busy == 0) done_condition.notify_one();
+		}
+	}
+}
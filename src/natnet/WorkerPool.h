@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a few threads that run the tasks of one job in parallel with the
+// calling thread. tasks are handed out one index at a time from a shared
+// counter, so a thread that finishes early keeps taking work and uneven
+// tasks balance out. one job at a time.
+
+namespace NatNet
+{
+	class WorkerPool
+	{
+	public:
+		// num_threads in total, including the thread calling run()
+		explicit WorkerPool(int num_threads);
+		~WorkerPool();
+
+		inline int getNumThreads() const { return threads.size() + 1; }
+
+		// calls task(0) .. task(num_tasks - 1) and returns when all are done
+		void run(int num_tasks, const std::function<void(int)>& task);
+
+	private:
+		std::vector<std::thread> threads;
+
+		std::mutex mutex;
+		std::condition_variable start_condition;
+		std::condition_variable done_condition;
+
+		const std::function<void(int)>* job;
+		int num_tasks;
+		std::atomic<int> next_task;
+		int num_busy;
+		uint64_t generation;
+		bool quit;
+
+		void worker();
+		void work();
+
+		WorkerPool(const WorkerPool&);
+		WorkerPool& operator=(const WorkerPool&);
+	};
+}
@@ -1,996 +1,388 @@
 #include "ofxNatNet.h"
 
-#include <Poco/Net/SocketAddress.h>
-#include <Poco/Net/DatagramSocket.h>
-#include <Poco/Net/MulticastSocket.h>
-#include <Poco/Net/NetworkInterface.h>
-#include <Poco/Net/NetException.h>
-
-const int impl_major = 2;
-const int impl_minor = 9;
-
-#define MAX_NAMELENGTH 256
-
-// NATNET message ids
-#define NAT_PING 0
-#define NAT_PINGRESPONSE 1
-#define NAT_REQUEST 2
-#define NAT_RESPONSE 3
-#define NAT_REQUEST_MODELDEF 4
-#define NAT_MODELDEF 5
-#define NAT_REQUEST_FRAMEOFDATA 6
-#define NAT_FRAMEOFDATA 7
-#define NAT_MESSAGESTRING 8
-#define NAT_UNRECOGNIZED_REQUEST 100
-#define UNDEFINED 999999.9999
-
-#define MAX_PACKETSIZE 100000
-
-// sender
-struct sSender
+static void logToOf(NatNet::LogLevel level, const char* message)
 {
-	char szName[MAX_NAMELENGTH];  // sending app's name
-	unsigned char
-		Version[4];  // sending app's version [major.minor.build.revision]
-	unsigned char NatNetVersion
-		[4];  // sending app's NatNet version [major.minor.build.revision]
-};
-
-struct sPacket
-{
-	unsigned short iMessage;	// message ID (e.g. NAT_FRAMEOFDATA)
-	unsigned short nDataBytes;  // Num bytes in payload
-	union
-	{
-		unsigned char cData[MAX_PACKETSIZE];
-		char szData[MAX_PACKETSIZE];
-		unsigned long lData[MAX_PACKETSIZE / 4];
-		float fData[MAX_PACKETSIZE / 4];
-		sSender Sender;
-	} Data;  // Payload
-};
-
-struct Packet
-{
-	float timestamp;
-	struct sPacket packet;
-};
+	static const ofLogLevel levels[] = { OF_LOG_VERBOSE, OF_LOG_NOTICE, OF_LOG_WARNING, OF_LOG_ERROR };
+	ofLog(levels[level], "ofxNatNet: %s", message);
+}
 
-struct ofxNatNet::InternalThread : public ofThread
-{
-	bool connected;
-	string target_host;
+static inline ofVec3f toOf(const NatNet::Vec3& v) { return ofVec3f(v.x, v.y, v.z); }
+static inline ofMatrix4x4 toOf(const NatNet::Matrix4x4& m) { return ofMatrix4x4(m.m); }
+static inline ofQuaternion toOf(const NatNet::Quat& q) { return ofQuaternion(q.x, q.y, q.z, q.w); }
 
-	int command_port;
+static NatNet::Matrix4x4 toNatNet(const ofMatrix4x4& m)
+{
+	NatNet::Matrix4x4 r;
+	memcpy(r.m, m.getPtr(), sizeof(r.m));
+	return r;
+}
 
-	Poco::Net::NetworkInterface interface;
-	Poco::Net::MulticastSocket data_socket;
-	Poco::Net::DatagramSocket command_socket;
+static void convertMarkers(const vector<NatNet::Marker>& src, vector<ofxNatNet::Marker>& dst)
+{
+	dst.resize(src.size());
+	for (int i = 0; i < src.size(); i++) dst[i] = toOf(src[i]);
+}
 
-	int NatNetVersion[4];
-	int ServerVersion[4];
+static void convertMatrices(const vector<NatNet::Matrix4x4>& src, vector<ofMatrix4x4>& dst)
+{
+	dst.resize(src.size());
+	for (int i = 0; i < src.size(); i++) dst[i] = toOf(src[i]);
+}
 
-	size_t frame_number;
-	float latency;
+static void convertDescription(const NatNet::RigidBodyDescription& src,
+							   ofxNatNet::RigidBodyDescription& dst)
+{
+	dst.name = src.name;
+	dst.id = src.id;
+	dst.parent_id = src.parent_id;
+	dst.offset = toOf(src.offset);
+	dst.marker_offsets.resize(src.marker_offsets.size());
+	for (int i = 0; i < src.marker_offsets.size(); i++) dst.marker_offsets[i] = toOf(src.marker_offsets[i]);
+	dst.marker_names = src.marker_names;
+}
 
-	float buffer_time;
-	queue<Packet> buffer;
-	
-	vector<ofxNatNet::Marker> markers;
-	vector<ofxNatNet::Marker> filterd_markers;
+ofxNatNet::ofxNatNet()
+	: frame_number(0)
+	, latency(0)
+	, timeout(0.1)
+	, frame_serial(0)
+	, description_version(0)
+{
+	NatNet::setLogHandler(logToOf);
 
-	map<int, ofxNatNet::RigidBody> rigidbodies;
-	
-	vector<vector<ofxNatNet::Marker> > markers_set;
-	map<int, ofxNatNet::Skeleton> skeletons;
+	client.setFrameCallback([this](const NatNet::Frame& frame) {
+		FrameEventArgs args(frame);
+		ofNotifyEvent(frameReceived, args);
+	});
+}
 
-    vector<RigidBodyDescription> rigidbody_descs;
-    vector<SkeletonDescription> skeleton_descs;
-    vector<MarkerSetDescription> markerset_descs;
-    
-	float last_packet_arrival_time;
-	float data_rate;
-
-	ofMatrix4x4 transform;
-
-	float duplicated_point_removal_distance;
-
-	string error_str;
-
-	InternalThread(string interface_name, string target_host,
-				   string multicast_group, int command_port, int data_port)
-		: connected(false)
-		, target_host(target_host)
-		, command_port(command_port)
-		, frame_number(0)
-		, latency(0)
-		, buffer_time(0)
-		, last_packet_arrival_time(0)
-		, data_rate(0)
-		, duplicated_point_removal_distance(0)
-	{
-		error_str = "";
+void ofxNatNet::setup(string interface_name, string target_host,
+					  string multicast_group, int command_port, int data_port)
+{
+	dispose();
+	client.setup(interface_name, target_host, multicast_group, command_port, data_port);
+}
 
-		try
-		{
-			{
-				Poco::Net::SocketAddress addr(Poco::Net::IPAddress::wildcard(),
-											  data_port);
-				
-				try
-				{
-					interface = Poco::Net::NetworkInterface::forAddress(Poco::Net::IPAddress(interface_name));
-				}
-				catch (const Poco::Net::InvalidAddressException& e)
-				{
-					interface = Poco::Net::NetworkInterface::forName(
-						interface_name, Poco::Net::NetworkInterface::IPv4_ONLY);
-				}
-
-				data_socket.bind(addr, true);
-				data_socket.joinGroup(Poco::Net::IPAddress(multicast_group),
-									  interface);
-
-				data_socket.setBlocking(false);
-
-				data_socket.setReceiveBufferSize(0x100000);
-				assert(data_socket.getReceiveBufferSize() == 0x100000);
-			}
+void ofxNatNet::setupOffline(int natnet_major, int natnet_minor)
+{
+	dispose();
+	client.setupOffline(natnet_major, natnet_minor);
+}
 
-			for (int i = 0; i < 4; i++)
-			{
-				NatNetVersion[i] = 0;
-				ServerVersion[i] = 0;
-			}
+bool ofxNatNet::decodePacket(const void* data, size_t size)
+{
+	return client.decodePacket(data, size);
+}
 
-			{
-				Poco::Net::SocketAddress my_addr(interface.address(), 0);
-				command_socket.bind(my_addr, true);
-				command_socket.setReceiveBufferSize(0x100000);
-				command_socket.setBroadcast(true);
-				assert(command_socket.getReceiveBufferSize() == 0x100000);
-			}
+void ofxNatNet::dispose()
+{
+	client.close();
+}
 
-			{
-				Poco::Net::SocketAddress target_addr(target_host, command_port);
-				command_socket.connect(target_addr);
-				command_socket.setSendBufferSize(0x100000);
-				assert(command_socket.getSendBufferSize() == 0x100000);
-			}
+void ofxNatNet::convertRigidBody(const NatNet::RigidBody& src, RigidBody& dst)
+{
+	dst.id = src.id;
+	dst.matrix = toOf(src.getMatrix());
+	dst.position = toOf(src.position);
+	dst.orientation = toOf(src.orientation);
+	convertMarkers(src.markers, dst.markers);
+	dst.mean_marker_error = src.mean_marker_error;
+	dst._active = src.active;
+}
 
-			startThread();
+void ofxNatNet::convertSkeleton(const NatNet::Skeleton& src, Skeleton& dst)
+{
+	dst.id = src.id;
+	dst.joints.resize(src.joints.size());
+	for (int i = 0; i < src.joints.size(); i++) convertRigidBody(src.joints[i], dst.joints[i]);
+	convertMatrices(src.local_matrices, dst.local_matrices);
+	convertMatrices(src.world_matrices, dst.world_matrices);
+}
 
-			sendPing();
-		}
-		catch (const std::exception& e)
-		{
-			ofLogError("ofxNatNet") << e.what();
-			error_str = e.what();
-		}
-	}
+void ofxNatNet::update()
+{
+	frame_serial = client.getFrameSerial();
 
-	~InternalThread()
-	{
-		if (isThreadRunning()) waitForThread(true);
+	client.lock();
+	const NatNet::Client::State& state = client.getState();
 
-		data_socket.close();
-	}
+	frame_number = state.frame_number;
+	latency = state.latency;
 
-	struct remove_dups
+	if (isConnected())
 	{
-		ofVec3f v;
-		float dist;
-
-		remove_dups(const ofVec3f& v, float dist)
-			: v(v)
-			, dist(dist)
+		markers_set.resize(state.markers_set.size());
+		for (int i = 0; i < state.markers_set.size(); i++)
+			convertMarkers(state.markers_set[i], markers_set[i]);
+		convertMarkers(state.markers, markers);
+		convertMarkers(state.filterd_markers, filterd_markers);
+		marker_ids = state.marker_ids;
+		marker_ages = state.marker_ages;
+
+		// ids the client evicted go, the rest are converted in place so
+		// their vectors keep their storage
 		{
-		}
-
-		bool operator()(const ofVec3f& t) { return v.match(t, dist); }
-	};
-
-	void threadedFunction()
-	{
-		Poco::Timespan timeout(0);
-
-		while (isThreadRunning())
-		{
-			float t = ofGetElapsedTimef();
-
-			if (data_socket.poll(timeout, Poco::Net::Socket::SELECT_READ))
+			map<int, RigidBody>::iterator dst = rigidbodies.begin();
+			while (dst != rigidbodies.end())
 			{
-				try
-				{
-					Packet packet;
-					int n = data_socket.receiveBytes((char*)&packet.packet,
-													 sizeof(sPacket));
-
-					if (n > 0)
-					{
-						packet.timestamp = t;
-						buffer.push(packet);
-
-						float d = t - last_packet_arrival_time;
-						float r = (1. / d);
-
-						data_rate += (r - data_rate) * 0.1;
-						last_packet_arrival_time = t;
-					}
-				}
-				catch (Poco::Exception& exc)
-				{
-					ofLogError("ofxNatNet")
-						<< "udp socket error: " << exc.displayText();
-				}
+				if (state.rigidbodies.count(dst->first)) ++dst;
+				else rigidbodies.erase(dst++);
 			}
+			rigidbodies_arr.clear();
 
-			float target_time = t - buffer_time;
-			while (buffer.size())
+			map<int, NatNet::RigidBody>::const_iterator it = state.rigidbodies.begin();
+			while (it != state.rigidbodies.end())
 			{
-				Packet& packet = buffer.front();
-				if (packet.timestamp >= target_time)
-				{
-					break;
-				}
-
-				dataPacketReceiverd(packet.packet);
-				buffer.pop();
+				RigidBody& RB = rigidbodies[it->first];
+				convertRigidBody(it->second, RB);
+				rigidbodies_arr.push_back(&RB);
+				it++;
 			}
-
-
-			ofSleepMillis(1);
 		}
-	}
-    
-    void sendRequestDescription() {
-        sPacket packet;
-        packet.iMessage = NAT_REQUEST_MODELDEF;
-        packet.nDataBytes = 0;
-        
-        Poco::Timespan timeout(100 * 1000);
-        
-        for (int i = 0; i < 3; i++)
-        {
-            unsigned int n = command_socket.sendBytes(&packet, 4 + packet.nDataBytes);
-            
-			if (command_socket.poll(timeout, Poco::Net::Socket::SELECT_READ))
+		{
+			map<int, Skeleton>::iterator dst = skeletons.begin();
+			while (dst != skeletons.end())
 			{
-				command_socket.receiveBytes((char*)&packet, sizeof(sPacket));
-				if (packet.nDataBytes > 0) {
-					Unpack((char*)&packet);
-				}
+				if (state.skeletons.count(dst->first)) ++dst;
+				else skeletons.erase(dst++);
 			}
-        }
-    }
-
-	void sendPing()
-	{
-		sPacket ping_packet;
-		ping_packet.iMessage = NAT_PING;
-		ping_packet.nDataBytes = 0;
-
-		connected = false;
-		
-		Poco::Timespan timeout(100 * 1000);
-
-		for (int i = 0; i < 3; i++)
-		{
-			unsigned int n = command_socket.sendBytes(
-				&ping_packet, 4 + ping_packet.nDataBytes);
-			if (n > 0 && connected) break;
+			skeletons_arr.clear();
 
-			if (command_socket.poll(timeout, Poco::Net::Socket::SELECT_READ))
+			map<int, NatNet::Skeleton>::const_iterator it = state.skeletons.begin();
+			while (it != state.skeletons.end())
 			{
-				try
-				{
-					sPacket packet;
-					int n = command_socket.receiveBytes((char*)&packet,
-														sizeof(sPacket));
-					
-					if (n > 0 && packet.iMessage == NAT_PINGRESPONSE)
-					{
-						connected = true;
-						
-						for (int i = 0; i < 4; i++)
-						{
-							NatNetVersion[i] = (int)packet.Data.Sender.NatNetVersion[i];
-							ServerVersion[i] = (int)packet.Data.Sender.Version[i];
-						}
-
-						printf("connected. NatNet: v%i.%i, Server: v%i.%i\n", NatNetVersion[0], NatNetVersion[1], ServerVersion[0], ServerVersion[1]);
-
-						return;
-					}
-				}
-				catch (Poco::Exception& exc)
-				{
-					ofLogError("ofxNatNet")
-					<< "udp socket error: " << exc.displayText();
-				}
+				Skeleton& S = skeletons[it->first];
+				convertSkeleton(it->second, S);
+				skeletons_arr.push_back(&S);
+				it++;
 			}
-
-			ofLogWarning("ofxNatNet") << "No route to host. count: " << i;
-		}
-	}
-	
-	void dataPacketReceiverd(sPacket& packet)
-	{
-		Unpack((char*)&packet);
-	}
-	
-	char* unpackMarkerSet(char* ptr, vector<Marker>& markers)
-	{
-		int nMarkers = 0;
-		memcpy(&nMarkers, ptr, 4);
-		ptr += 4;
-		
-		markers.resize(nMarkers);
-		
-		for (int j = 0; j < nMarkers; j++)
-		{
-			ofVec3f p;
-			memcpy(&p.x, ptr, 4);
-			ptr += 4;
-			memcpy(&p.y, ptr, 4);
-			ptr += 4;
-			memcpy(&p.z, ptr, 4);
-			ptr += 4;
-
-			p = transform.preMult(p);
-			
-			markers[j] = p;
 		}
-		
-		return ptr;
-	}
 
-	char* unpackRigidBodies(char* ptr, vector<RigidBody>& rigidbodies)
-	{
-		int major = NatNetVersion[0];
-		int minor = NatNetVersion[1];
-		
-		ofQuaternion rot = transform.getRotate();
-
-		int nRigidBodies = 0;
-		memcpy(&nRigidBodies, ptr, 4);
-		ptr += 4;
-		
-		rigidbodies.resize(nRigidBodies);
-		
-		for (int j = 0; j < nRigidBodies; j++)
+		if (description_version != state.description_version)
 		{
-			ofxNatNet::RigidBody& RB = rigidbodies[j];
-			
-			ofVec3f pp;
-			ofQuaternion q;
-			
-			int ID = 0;
-			memcpy(&ID, ptr, 4);
-			ptr += 4;
-			
-			memcpy(&pp.x, ptr, 4);
-			ptr += 4;
-			
-			memcpy(&pp.y, ptr, 4);
-			ptr += 4;
-			
-			memcpy(&pp.z, ptr, 4);
-			ptr += 4;
-			
-			memcpy(&q.x(), ptr, 4);
-			ptr += 4;
-			
-			memcpy(&q.y(), ptr, 4);
-			ptr += 4;
-			
-			memcpy(&q.z(), ptr, 4);
-			ptr += 4;
-			
-			memcpy(&q.w(), ptr, 4);
-			ptr += 4;
-			
-			RB.id = ID;
-			RB.raw_position = pp;
-			
-			pp = transform.preMult(pp);
-			
-			ofMatrix4x4 mat;
-			mat.setTranslation(pp);
-			mat.setRotate(q * rot);
-			RB.matrix = mat;
-			
-			// associated marker positions
-			int nRigidMarkers = 0;
-			memcpy(&nRigidMarkers, ptr, 4);
-			ptr += 4;
-			
-			int nBytes = nRigidMarkers * 3 * sizeof(float);
-			float* markerData = (float*)malloc(nBytes);
-			memcpy(markerData, ptr, nBytes);
-			ptr += nBytes;
-			
-			if (major >= 2)
-			{
-				// associated marker IDs
-				nBytes = nRigidMarkers * sizeof(int);
-				ptr += nBytes;
-				
-				// associated marker sizes
-				nBytes = nRigidMarkers * sizeof(float);
-				ptr += nBytes;
-			}
-			
-			RB.markers.resize(nRigidMarkers);
-			
-			for (int k = 0; k < nRigidMarkers; k++)
-			{
-				float x = markerData[k * 3];
-				float y = markerData[k * 3 + 1];
-				float z = markerData[k * 3 + 2];
-				
-				ofVec3f pp(x, y, z);
-				pp = transform.preMult(pp);
-				RB.markers[k] = pp;
-			}
-			
-			if (markerData) free(markerData);
-			
-			if (major >= 2)
+			const NatNet::Descriptions& descs = state.descriptions;
+
+			markerset_descs.resize(descs.markersets.size());
+			for (int i = 0; i < descs.markersets.size(); i++)
 			{
-				// Mean marker error
-				float fError = 0.0f;
-				memcpy(&fError, ptr, 4);
-				ptr += 4;
-				
-				RB.mean_marker_error = fError;
-				RB._active = RB.mean_marker_error > 0;
-			} else {
-				RB.mean_marker_error = 0;
+				markerset_descs[i].name = descs.markersets[i].name;
+				markerset_descs[i].marker_names = descs.markersets[i].marker_names;
 			}
 
-			// 2.6 and later
-			if (((major == 2) && (minor >= 6)) || (major > 2) || (major == 0))
+			rigidbody_descs.resize(descs.rigidbodies.size());
+			for (int i = 0; i < descs.rigidbodies.size(); i++)
+				convertDescription(descs.rigidbodies[i], rigidbody_descs[i]);
+
+			skeleton_descs.resize(descs.skeletons.size());
+			for (int i = 0; i < descs.skeletons.size(); i++)
 			{
-				// params
-				short params = 0; memcpy(&params, ptr, 2); ptr += 2;
-				bool bTrackingValid = params & 0x01; // 0x01 : rigid body was successfully tracked in this frame
+				const NatNet::SkeletonDescription& src = descs.skeletons[i];
+				SkeletonDescription& dst = skeleton_descs[i];
+
+				dst.name = src.name;
+				dst.id = src.id;
+				dst.joints.resize(src.joints.size());
+				for (int j = 0; j < src.joints.size(); j++)
+					convertDescription(src.joints[j], dst.joints[j]);
+				dst.parent_indices = src.parent_indices;
+				dst.joint_order = src.joint_order;
+				dst.joint_index_by_id = src.joint_index_by_id;
 			}
-			
-		}  // next rigid body
-		
-		return ptr;
-	}
-	
-	void Unpack(char* pData)
-	{
-		int major = NatNetVersion[0];
-		int minor = NatNetVersion[1];
-		
-		if (major == 0 && minor == 0)
-		{
-			ofLogError("ofxNatNet") << "initialize failed";
-			return;
-		}
-		
-		if (major > impl_major || minor > impl_minor)
-		{
-			ofLogError("ofxNatNet") << "The implemented NatNet parser is outdated";
-			return;
-		}
 
-		ofQuaternion rot = transform.getRotate();
+			markerset_index = descs.markerset_index;
+			rigidbody_index = descs.rigidbody_index;
+			skeleton_index = descs.skeleton_index;
 
-		char* ptr = pData;
-
-		// message ID
-		int MessageID = 0;
-		memcpy(&MessageID, ptr, 2);
-		ptr += 2;
+			description_version = state.description_version;
+		}
 
-		// size
-		int nBytes = 0;
-		memcpy(&nBytes, ptr, 2);
-		ptr += 2;
+		if (state.markerset_slots_version == description_version)
+			markerset_slots = state.markerset_slots;
+		else
+			markerset_slots.clear();
 
-		if (MessageID == 7)  // FRAME OF MOCAP DATA packet
+		rigidbody_slots.assign(rigidbody_descs.size(), NULL);
+		for (int i = 0; i < rigidbody_descs.size(); i++)
 		{
-			int frame_number = 0;
-			float latency = 0;
-
-			vector<vector<Marker> > markers_set;
-			vector<Skeleton> skeletons;
-			vector<Marker> markers;
-			vector<Marker> filterd_markers;
-			vector<RigidBody> rigidbodies;
-
-			// frame number
-			memcpy(&frame_number, ptr, 4);
-			ptr += 4;
-
-			// number of data sets (markersets, rigidbodies, etc)
-			int nMarkerSets = 0;
-			memcpy(&nMarkerSets, ptr, 4);
-			ptr += 4;
-			
-			markers_set.resize(nMarkerSets);
-			
-			for (int i = 0; i < nMarkerSets; i++)
-			{
-				// Markerset name
-				char szName[256];
-				strcpy(szName, ptr);
-				int nDataBytes = (int)strlen(szName) + 1;
-				ptr += nDataBytes;
-				
-				ptr = unpackMarkerSet(ptr, markers_set[i]);
-			}
-
-			// unidentified markers
-			ptr = unpackMarkerSet(ptr, markers);
-
-			// rigid bodies
-			ptr = unpackRigidBodies(ptr, rigidbodies);
-
-			if (((major == 2) && (minor > 0)) || (major > 2)) {
-				int nSkeletons = 0;
-				memcpy(&nSkeletons, ptr, 4);
-				ptr += 4;
-				
-				skeletons.resize(nSkeletons);
-
-				for (int j = 0; j < nSkeletons; j++) {
-					int skeletonID = 0;
-					memcpy(&skeletonID, ptr, 4);
-					ptr += 4;
-					
-					skeletons[j].id = skeletonID;
-					
-					ptr = unpackRigidBodies(ptr, skeletons[j].joints);
-				}
-			}
-
-			// labeled markers (version 2.3 and later)
-			if (((major == 2) && (minor >= 3)) || (major > 2)) {
-				int nLabeledMarkers = 0;
-				memcpy(&nLabeledMarkers, ptr, 4);
-				ptr += 4;
-				for (int j = 0; j < nLabeledMarkers; j++) {
-					// id
-					int ID = 0;
-					memcpy(&ID, ptr, 4);
-					ptr += 4;
-					// x
-					float x = 0.0f;
-					memcpy(&x, ptr, 4);
-					ptr += 4;
-					// y
-					float y = 0.0f;
-					memcpy(&y, ptr, 4);
-					ptr += 4;
-					// z
-					float z = 0.0f;
-					memcpy(&z, ptr, 4);
-					ptr += 4;
-					// size
-					float size = 0.0f;
-					memcpy(&size, ptr, 4);
-					ptr += 4;
-
-					// 2.6 and later
-					if( ((major == 2)&&(minor >= 6)) || (major > 2) || (major == 0) )
-					{
-						// marker params
-						short params = 0; memcpy(&params, ptr, 2); ptr += 2;
-						bool bOccluded = params & 0x01;     // marker was not visible (occluded) in this frame
-						bool bPCSolved = params & 0x02;     // position provided by point cloud solve
-						bool bModelSolved = params & 0x04;  // position provided by model solve
-					}
-
-					ofVec3f pp(x, y, z);
-					pp = transform.preMult(pp);
-
-					markers.push_back(pp);
-				}
-			}
+			map<int, RigidBody>::iterator it = rigidbodies.find(rigidbody_descs[i].id);
+			if (it != rigidbodies.end()) rigidbody_slots[i] = &it->second;
+		}
 
-			// Force Plate data (version 2.9 and later)
-			if (((major == 2) && (minor >= 9)) || (major > 2))
-			{
-				int nForcePlates;
-				memcpy(&nForcePlates, ptr, 4); ptr += 4;
-				for (int iForcePlate = 0; iForcePlate < nForcePlates; iForcePlate++)
-				{
-					// ID
-					int ID = 0; memcpy(&ID, ptr, 4); ptr += 4;
-
-					// Channel Count
-					int nChannels = 0; memcpy(&nChannels, ptr, 4); ptr += 4;
-
-					// Channel Data
-					for (int i = 0; i < nChannels; i++)
-					{
-						int nFrames = 0; memcpy(&nFrames, ptr, 4); ptr += 4;
-						for (int j = 0; j < nFrames; j++)
-						{
-							float val = 0.0f;  memcpy(&val, ptr, 4); ptr += 4;
-						}
-					}
-				}
-			}
+		skeleton_slots.assign(skeleton_descs.size(), NULL);
+		for (int i = 0; i < skeleton_descs.size(); i++)
+		{
+			map<int, Skeleton>::iterator it = skeletons.find(skeleton_descs[i].id);
+			if (it != skeletons.end()) skeleton_slots[i] = &it->second;
+		}
 
-			// latency
-			memcpy(&latency, ptr, 4);
-			ptr += 4;
+		pose_buffer.fill(state.frame_number, state.markers, state.filterd_markers,
+						 state.rigidbodies, state.skeletons);
+	}
+	else
+	{
+		markers_set.clear();
+		markers.clear();
+		marker_ids.clear();
+		marker_ages.clear();
+		filterd_markers.clear();
+		rigidbodies.clear();
+		rigidbodies_arr.clear();
+		skeletons.clear();
+		skeletons_arr.clear();
+		markerset_slots.clear();
+		rigidbody_slots.clear();
+		skeleton_slots.clear();
+		pose_buffer.clear();
+	}
 
-			this->latency = latency;
+	client.unlock();
+}
 
-			// timecode
-			unsigned int timecode = 0; 	memcpy(&timecode, ptr, 4);	ptr += 4;
-			unsigned int timecodeSub = 0; memcpy(&timecodeSub, ptr, 4); ptr += 4;
+static int findSlot(const ofxNatNet::NameIndex& index, const string& name)
+{
+	ofxNatNet::NameIndex::const_iterator it = index.find(name);
+	return it == index.end() ? -1 : it->second;
+}
 
-			// timestamp
-			double timestamp = 0.0f;
-			// 2.7 and later - increased from single to double precision
-			if (((major == 2) && (minor >= 7)) || (major>2))
-			{
-				memcpy(&timestamp, ptr, 8); ptr += 8;
-			}
-			else
-			{
-				float fTemp = 0.0f;
-				memcpy(&fTemp, ptr, 4); ptr += 4;
-			}
+int ofxNatNet::getMarkerSetSlot(const string& name) const
+{
+	return findSlot(markerset_index, name);
+}
 
-			// frame params
-			short params = 0;  memcpy(&params, ptr, 2); ptr += 2;
-			bool bIsRecording = params & 0x01;                  // 0x01 Motive is recording
-			bool bTrackedModelsChanged = params & 0x02;         // 0x02 Actively tracked model list has changed
+int ofxNatNet::getRigidBodySlot(const string& name) const
+{
+	return findSlot(rigidbody_index, name);
+}
 
-			// end of data tag
-			int eod = 0;
-			memcpy(&eod, ptr, 4);
-			ptr += 4;
+int ofxNatNet::getSkeletonSlot(const string& name) const
+{
+	return findSlot(skeleton_index, name);
+}
 
-			filterd_markers = markers;
+bool ofxNatNet::waitForFrame(float timeout_sec)
+{
+	return client.waitForFrame(frame_serial, timeout_sec);
+}
 
-			// filter markers
-			if (duplicated_point_removal_distance > 0)
-			{
-				map<int, ofxNatNet::RigidBody>::iterator it =
-					this->rigidbodies.begin();
-				while (it != this->rigidbodies.end())
-				{
-					ofxNatNet::RigidBody& RB = it->second;
-
-					for (int i = 0; i < RB.markers.size(); i++)
-					{
-						ofVec3f& v = RB.markers[i];
-						vector<Marker>::iterator it = remove_if(
-							filterd_markers.begin(), filterd_markers.end(),
-							remove_dups(v, duplicated_point_removal_distance));
-						filterd_markers.erase(it, filterd_markers.end());
-					}
-
-					it++;
-				}
-			}
+bool ofxNatNet::isConnected() { return client.isConnected(timeout); }
 
-			// copy to mainthread
-			if (lock())
-			{
-				this->latency = latency;
-				this->frame_number = frame_number;
-				this->markers_set = markers_set;
-				this->markers = markers;
-				this->filterd_markers = filterd_markers;
-
-				{
-					for (int i = 0; i < rigidbodies.size(); i++) {
-						RigidBody &RB = rigidbodies[i];
-						RigidBody &tRB = this->rigidbodies[RB.id];
-						tRB = RB;
-					}
-				}
-				{
-					for (int i = 0; i < skeletons.size(); i++) {
-						Skeleton &S = skeletons[i];
-						Skeleton &tS = this->skeletons[S.id];
-						tS = S;
-					}
-				}
-
-				unlock();
-			}
-		}
-		else if (MessageID == 5)  // Data Descriptions
-		{
-            int nDatasets = 0;
+float ofxNatNet::getDataRate() { return client.getDataRate(); }
 
-            vector<RigidBodyDescription> rigidbody_descs;
-            vector<SkeletonDescription> skeleton_descs;
-            vector<MarkerSetDescription> markerset_descs;
+float ofxNatNet::getLastPacketArraivalTime()
+{
+	if (client.getLastPacketArrivalNanos() == 0) return 0;
 
-			// number of datasets
-			memcpy(&nDatasets, ptr, 4);
-			ptr += 4;
+	// on the ofGetElapsedTimef() timeline, as before
+	return ofGetElapsedTimef() - NatNet::nanosToSeconds(client.getNanosSinceLastPacket());
+}
 
-			for (int i = 0; i < nDatasets; i++)
-			{
-				int type = 0;
-				memcpy(&type, ptr, 4);
-				ptr += 4;
-
-				if (type == 0)   // markerset
-				{
-                    MarkerSetDescription description;
-                    
-					// name
-					char szName[256];
-					strcpy(szName, ptr);
-					int nDataBytes = (int)strlen(szName) + 1;
-					ptr += nDataBytes;
-                    description.name = szName;
-
-					// marker data
-					int nMarkers = 0;
-					memcpy(&nMarkers, ptr, 4);
-					ptr += 4;
-
-					for (int j = 0; j < nMarkers; j++)
-					{
-						char szName[256];
-						strcpy(szName, ptr);
-						int nDataBytes = (int)strlen(szName) + 1;
-						ptr += nDataBytes;
-                        description.marker_names.push_back(szName);
-					}
-                    markerset_descs.push_back(description);
-				}
-				else if (type == 1)   // rigid body
-				{
-                    RigidBodyDescription description;
-                    
-					if (major >= 2)
-					{
-						// name
-						char szName[MAX_NAMELENGTH];
-						strcpy(szName, ptr);
-						ptr += strlen(ptr) + 1;
-                        description.name = szName;
-					}
-
-					int ID = 0;
-					memcpy(&ID, ptr, 4);
-					ptr += 4;
-                    description.id = ID;
-
-					int parentID = 0;
-					memcpy(&parentID, ptr, 4);
-					ptr += 4;
-                    description.parent_id = parentID;
-
-					float xoffset = 0;
-					memcpy(&xoffset, ptr, 4);
-					ptr += 4;
-
-					float yoffset = 0;
-					memcpy(&yoffset, ptr, 4);
-					ptr += 4;
-
-					float zoffset = 0;
-					memcpy(&zoffset, ptr, 4);
-					ptr += 4;
-
-                    description.offset.x = xoffset;
-                    description.offset.y = yoffset;
-                    description.offset.z = zoffset;
-                    
-                    rigidbody_descs.push_back(description);
-				}
-				else if (type == 2)   // skeleton
-				{
-                    SkeletonDescription description;
-                    
-					char szName[MAX_NAMELENGTH];
-					strcpy(szName, ptr);
-					ptr += strlen(ptr) + 1;
-                    description.name = szName;
-
-					int ID = 0;
-					memcpy(&ID, ptr, 4);
-					ptr += 4;
-                    description.id = ID;
-
-					int nRigidBodies = 0;
-					memcpy(&nRigidBodies, ptr, 4);
-					ptr += 4;
-                    
-                    description.joints.resize(nRigidBodies);
-
-					for (int i = 0; i < nRigidBodies; i++)
-					{
-						if (major >= 2)
-						{
-							// RB name
-							char szName[MAX_NAMELENGTH];
-							strcpy(szName, ptr);
-							ptr += strlen(ptr) + 1;
-                            description.joints[i].name = szName;
-						}
-
-						int ID = 0;
-						memcpy(&ID, ptr, 4);
-						ptr += 4;
-                        description.joints[i].id = ID;
-
-						int parentID = 0;
-						memcpy(&parentID, ptr, 4);
-						ptr += 4;
-                        description.joints[i].parent_id = parentID;
-
-						float xoffset = 0;
-						memcpy(&xoffset, ptr, 4);
-						ptr += 4;
-
-						float yoffset = 0;
-						memcpy(&yoffset, ptr, 4);
-						ptr += 4;
-
-						float zoffset = 0;
-						memcpy(&zoffset, ptr, 4);
-						ptr += 4;
-                        
-                        description.joints[i].offset.x = xoffset;
-                        description.joints[i].offset.y = yoffset;
-                        description.joints[i].offset.z = zoffset;
-					}
-                    skeleton_descs.push_back(description);
-				}
-
-			}   // next dataset
-            
-            // copy to mainthread
-            if (lock())
-            {
-                this->markerset_descs = markerset_descs;
-                this->rigidbody_descs = rigidbody_descs;
-                this->skeleton_descs = skeleton_descs;
-                unlock();
-            }
-		}
-		else
-		{
-			ofLogError("ofxNatNet") << "Unrecognized Packet Type";
-		}
-	}
-};
+int64_t ofxNatNet::getNanosSinceLastPacket() { return client.getNanosSinceLastPacket(); }
 
-void ofxNatNet::setup(string interface_name, string target_host,
-					  string multicast_group, int command_port, int data_port)
+void ofxNatNet::setScale(float v)
 {
-	dispose();
-	thread = new InternalThread(interface_name, target_host, multicast_group,
-								command_port, data_port);
+	setTransform(ofMatrix4x4::newScaleMatrix(v, v, v));
 }
 
-void ofxNatNet::dispose()
+ofVec3f ofxNatNet::getScale()
 {
-	if (thread) delete thread;
-	thread = NULL;
+	return transform.getScale();
 }
 
-void ofxNatNet::update()
+void ofxNatNet::setDuplicatedPointRemovalDistance(float v)
 {
-	if (thread == NULL)
-	{
-		ofLogError("ofxNatNet") << "call setup() first";
-		return;
-	}
-
-	if (thread->lock())
-	{
-		frame_number = thread->frame_number;
-		latency = thread->latency;
-		
-		if (isConnected())
-		{
-			markers_set = thread->markers_set;
-			markers = thread->markers;
-			filterd_markers = thread->filterd_markers;
-			
-			{
-				rigidbodies = thread->rigidbodies;
-				rigidbodies_arr.clear();
-				
-				map<int, RigidBody>::iterator it = thread->rigidbodies.begin();
-				while (it != thread->rigidbodies.end())
-				{
-					rigidbodies_arr.push_back(&it->second);
-					it++;
-				}
-			}
-			{
-				skeletons = thread->skeletons;
-				skeletons_arr.clear();
-				
-				map<int, Skeleton>::iterator it = thread->skeletons.begin();
-				while (it != thread->skeletons.end())
-				{
-					skeletons_arr.push_back(&it->second);
-					it++;
-				}
-			}
-            
-            markerset_descs = thread->markerset_descs;
-            rigidbody_descs = thread->rigidbody_descs;
-            skeleton_descs = thread->skeleton_descs;
-		}
-		else
-		{
-			markers_set.clear();
-			markers.clear();
-			filterd_markers.clear();
-			rigidbodies.clear();
-			rigidbodies_arr.clear();
-			skeletons.clear();
-			skeletons_arr.clear();
-		}
-
-		thread->unlock();
-	}
+	client.setDuplicatedPointRemovalDistance(v);
 }
 
-bool ofxNatNet::isConnected()
+void ofxNatNet::setSkeletonLocalCoordinates(bool yn)
 {
-	if (!thread) return false;
-	return thread->connected
-		&& (ofGetElapsedTimef() - thread->last_packet_arrival_time) < this->timeout;
+	client.setSkeletonLocalCoordinates(yn);
 }
 
-float ofxNatNet::getDataRate()
+bool ofxNatNet::getSkeletonLocalCoordinates()
 {
-	if (!thread) return 0;
-	return thread->data_rate;
+	return client.getConfig()->getSkeletonLocalCoordinates();
 }
 
-float ofxNatNet::getLastPacketArraivalTime()
+void ofxNatNet::setEviction(const Eviction& eviction) { client.setEviction(eviction); }
+
+ofxNatNet::Eviction ofxNatNet::getEviction() { return client.getEviction(); }
+
+ofxNatNet::Footprint ofxNatNet::getFootprint() { return client.getFootprint(); }
+
+void ofxNatNet::setBufferTime(float sec) { client.setBufferTime(sec); }
+
+float ofxNatNet::getBufferTime() { return client.getBufferTime(); }
+
+void ofxNatNet::setSubscription(const NatNet::Subscription& subscription)
 {
-	if (!thread) return 0;
-	return thread->last_packet_arrival_time;
+	client.setSubscription(subscription);
 }
 
-void ofxNatNet::setScale(float v)
+NatNet::Subscription ofxNatNet::getSubscription() { return client.getSubscription(); }
+
+void ofxNatNet::setParallelDecode(int num_threads, size_t min_frame_bytes)
 {
-	assert(thread);
-	thread->transform = ofMatrix4x4::newScaleMatrix(v, v, v);
+	client.setParallelDecode(num_threads, min_frame_bytes);
 }
 
-ofVec3f ofxNatNet::getScale()
+void ofxNatNet::setLazyFrames(bool yn) { client.setLazyFrames(yn); }
+
+NatNet::FrameViewPtr ofxNatNet::getFrameView() { return client.getFrameView(); }
+
+void ofxNatNet::setMarkerIndexEnabled(bool yn) { client.setMarkerIndexEnabled(yn); }
+
+NatNet::MarkerIndexPtr ofxNatNet::getMarkerIndex() { return client.getMarkerIndex(); }
+
+NatNet::MarkerIndexPtr ofxNatNet::getFilterdMarkerIndex() { return client.getMarkerIndex(true); }
+
+void ofxNatNet::setCoalesceFrames(bool yn) { client.setCoalesceFrames(yn); }
+
+uint64_t ofxNatNet::getNumCoalescedFrames() { return client.getNumCoalescedFrames(); }
+
+void ofxNatNet::setRigidBodyFilterEnabled(bool yn) { client.getRigidBodyFilter().setEnabled(yn); }
+
+bool ofxNatNet::isRigidBodyFilterEnabled() { return client.getRigidBodyFilter().isEnabled(); }
+
+void ofxNatNet::setRigidBodyFilter(const FilterSettings& settings)
 {
-	assert(thread);
-	return thread->transform.getScale();
+	client.getRigidBodyFilter().setDefaultSettings(settings);
 }
 
-void ofxNatNet::setDuplicatedPointRemovalDistance(float v)
+void ofxNatNet::setRigidBodyFilter(int id, const FilterSettings& settings)
 {
-	assert(thread);
-	if (v < 0) v = 0;
-	thread->duplicated_point_removal_distance = v;
+	client.getRigidBodyFilter().setSettings(id, settings);
 }
 
-void ofxNatNet::setBufferTime(float sec)
+void ofxNatNet::clearRigidBodyFilter(int id) { client.getRigidBodyFilter().clearSettings(id); }
+
+void ofxNatNet::setMarkerTrackingEnabled(bool yn) { client.getMarkerTracker().setEnabled(yn); }
+
+bool ofxNatNet::isMarkerTrackingEnabled() { return client.getMarkerTracker().isEnabled(); }
+
+void ofxNatNet::setMarkerTracker(const MarkerTrackerSettings& settings)
 {
-	assert(thread);
-	thread->buffer_time = ofClamp(sec, 0, 10);
+	client.getMarkerTracker().setSettings(settings);
 }
 
-float ofxNatNet::getBufferTime()
+void ofxNatNet::setReceiveBufferSize(int bytes) { client.setReceiveBufferSize(bytes); }
+
+int ofxNatNet::getReceiveBufferSize() { return client.getReceiveBufferSize(); }
+
+void ofxNatNet::setReceiveBufferAutoGrow(int max_bytes) { client.setReceiveBufferAutoGrow(max_bytes); }
+
+uint64_t ofxNatNet::getNumKernelDrops() { return client.getNumKernelDrops(); }
+
+void ofxNatNet::setReceiverWaitMode(NatNet::Client::WaitMode mode, int spin_usec)
 {
-	assert(thread);
-	return thread->buffer_time;
+	client.setWaitMode(mode, spin_usec);
 }
 
+void ofxNatNet::setReceiverAffinity(int cpu) { client.setReceiverAffinity(cpu); }
+
+void ofxNatNet::setReceiverPriority(int priority) { client.setReceiverPriority(priority); }
+
+ofxNatNet::LatencyStats ofxNatNet::getLatencyStats() { return client.getLatencyStats(); }
+
 void ofxNatNet::setTimeout(float timeout)
 {
 	this->timeout = timeout;
@@ -998,90 +390,72 @@ void ofxNatNet::setTimeout(float timeout)
 
 void ofxNatNet::forceSetNatNetVersion(int major, int minor)
 {
-	assert(thread);
-	thread->NatNetVersion[0] = major;
-	thread->NatNetVersion[1] = minor;
+	client.setNatNetVersion(major, minor);
 }
 
-void ofxNatNet::sendPing() { thread->sendPing(); }
+void ofxNatNet::sendPing() { client.sendPing(); }
 
-void ofxNatNet::sendRequestDescription() { thread->sendRequestDescription(); }
+void ofxNatNet::sendRequestDescription() { client.sendRequestDescription(); }
 
 void ofxNatNet::setTransform(const ofMatrix4x4& m)
 {
-	assert(thread);
-	thread->transform = m;
+	transform = m;
+	client.setTransform(toNatNet(m));
 }
 
 const ofMatrix4x4& ofxNatNet::getTransform()
 {
-	assert(thread);
-	return thread->transform;
+	return transform;
+}
+
+void ofxNatNet::fillPoseBuffer(PoseBuffer& buffer) const { buffer = pose_buffer; }
+
+void ofxNatNet::setFrameHistorySize(size_t num_frames, size_t max_frame_bytes)
+{
+	client.setFrameHistorySize(num_frames, max_frame_bytes);
+}
+
+size_t ofxNatNet::getFrameHistorySize() { return client.getFrameHistorySize(); }
+
+ofxNatNetFrameRing::Reader ofxNatNet::createFrameReader() { return client.createFrameReader(); }
+
+bool ofxNatNet::setRelaySharedMemory(const string& name, size_t num_frames,
+									 size_t max_frame_bytes)
+{
+	return client.setRelaySharedMemory(name, num_frames, max_frame_bytes);
 }
 
+void ofxNatNet::closeRelaySharedMemory() { client.closeRelaySharedMemory(); }
+
+void ofxNatNet::addRelayTarget(const string& host, int port) { client.addRelayTarget(host, port); }
+
+void ofxNatNet::clearRelayTargets() { client.clearRelayTargets(); }
+
+size_t ofxNatNet::getNumRelayDrops() { return client.getNumRelayDrops(); }
+
 void ofxNatNet::debugDrawMarkers()
 {
-	ofPushStyle();
+	const PoseBuffer& B = pose_buffer;
+	pose_drawer.update(B);
 
-	ofFill();
+	ofPushStyle();
 
 	// draw all markers
 	ofSetColor(255, 30);
-	for (int i = 0; i < getNumMarker(); i++)
-	{
-		ofDrawBox(getMarker(i), 3);
-	}
-
-	ofNoFill();
+	pose_drawer.drawMarkers(0, B.num_markers, 3);
 
 	// draw filterd markers
 	ofSetColor(255);
-	for (int i = 0; i < getNumFilterdMarker(); i++)
-	{
-		ofDrawBox(getFilterdMarker(i), 10);
-	}
+	pose_drawer.drawMarkers(B.num_markers, B.num_filterd_markers, 6);
 
-	// draw rigidbodies
-	for (int i = 0; i < getNumRigidBody(); i++)
-	{
-		const ofxNatNet::RigidBody& RB = getRigidBodyAt(i);
+	// draw rigidbodies, untracked ones dimmed
+	ofSetColor(0, 255, 0);
+	pose_drawer.drawMarkers(B.num_markers + B.num_filterd_markers, B.num_rigidbody_markers, 5);
+	pose_drawer.drawAxes(0, B.num_rigidbodies, 30);
 
-		if (RB.isActive())
-			ofSetColor(0, 255, 0);
-		else
-			ofSetColor(255, 0, 0);
-
-		ofPushMatrix();
-		glMultMatrixf(RB.getMatrix().getPtr());
-		ofDrawAxis(30);
-		ofPopMatrix();
-
-		glBegin(GL_LINE_LOOP);
-		for (int n = 0; n < RB.markers.size(); n++)
-		{
-			glVertex3fv(RB.markers[n].getPtr());
-		}
-		glEnd();
-
-		for (int n = 0; n < RB.markers.size(); n++)
-		{
-			ofDrawBox(RB.markers[n], 5);
-		}
-	}
-	
 	// draw skeletons
-	for (int j = 0;  j < getNumSkeleton(); j++) {
-		const ofxNatNet::Skeleton &S = getSkeletonAt(j);
-		ofSetColor(255, 0, 255);
-		
-		for (int i = 0; i < S.joints.size(); i++) {
-			const ofxNatNet::RigidBody &RB = S.joints[i];
-			ofPushMatrix();
-			glMultMatrixf(RB.getMatrix().getPtr());
-			ofDrawBox(5);
-			ofPopMatrix();
-		}
-	}
+	ofSetColor(255, 0, 255);
+	pose_drawer.drawBoxes(B.num_rigidbodies, B.num_joints, 5);
 
 	ofPopStyle();
 }
@@ -1091,15 +465,26 @@ void ofxNatNet::debugDrawInformation()
 	ofPushStyle();
 	
 	string str;
-	if (thread->error_str != "") str += "ERROR: " + thread->error_str + "\n";
+	if (client.getError() != "") str += "ERROR: " + client.getError() + "\n";
 	str += "frames: " + ofToString(getFrameNumber()) + "\n";
 	str += "data rate: " + ofToString(getDataRate()) + "\n";
 	str += string("connected: ") + (isConnected() ? "YES" : "NO") + "\n";
+	str += "receive buffer: " + ofToString(client.getReceiveBufferSize()) + " bytes";
+	if (client.hasKernelDropCounter()) str += ", kernel drops: " + ofToString(client.getNumKernelDrops());
+	str += "\n";
+
+	LatencyStats stats = client.getLatencyStats();
+	str += "latency (us) wake: " + ofToString(stats.wake.mean / 1000, 1)
+		+ ", publish: " + ofToString(stats.publish.mean / 1000, 1) + "\n";
 	str += "num marker: " + ofToString(getNumMarker()) + "\n";
 	str += "num filterd (non rigidbodies) marker: " +
 	ofToString(getNumFilterdMarker()) + "\n";
 	str += "num rigidbody: " + ofToString(getNumRigidBody()) + "\n";
-	str += "num skeleton: " + ofToString(getNumSkeleton()) + "\n\n";
+	str += "num skeleton: " + ofToString(getNumSkeleton()) + "\n";
+
+	Footprint footprint = client.getFootprint();
+	str += "state: " + ofToString(footprint.bytes / 1024) + " KB, evicted: "
+		+ ofToString(footprint.num_evicted) + "\n\n";
     
     if (markerset_descs.size() || rigidbody_descs.size() || skeleton_descs.size()) {
         str += "Description: \n";
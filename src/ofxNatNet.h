@@ -2,21 +2,29 @@
 
 #include "ofMain.h"
 
+#include "natnet/Client.h"
+#include "natnet/Log.h"
+
+#include "ofxNatNetPoseDrawer.h"
+
+// openFrameworks adapter over the natnet core (src/natnet): the core owns
+// the sockets, the receiver thread and the decoder; this class publishes
+// its state in openFrameworks types on update().
+
 class ofxNatNet
 {
-	struct InternalThread;
-	friend struct InternalThread;
-
 public:
 	typedef ofVec3f Marker;
 
 	class RigidBody
 	{
-		friend class InternalThread;
+		friend class ofxNatNet;
 
 	public:
 		int id;
 		ofMatrix4x4 matrix;
+		ofVec3f position;
+		ofQuaternion orientation;
 		vector<Marker> markers;
 
 		float mean_marker_error;
@@ -25,10 +33,11 @@ public:
 		OF_DEPRECATED_MSG("Use isActive insted.", bool active() const);
 
 		const ofMatrix4x4& getMatrix() const { return matrix; }
+		const ofVec3f& getPosition() const { return position; }
+		const ofQuaternion& getOrientation() const { return orientation; }
 
 	private:
 		bool _active;
-		ofVec3f raw_position;
 	};
 	
 	class Skeleton
@@ -36,6 +45,15 @@ public:
 	public:
 		int id;
 		vector<RigidBody> joints;
+
+		// solved joint transforms, indexed like SkeletonDescription::joints.
+		// empty until the skeleton description has been received.
+		vector<ofMatrix4x4> local_matrices;
+		vector<ofMatrix4x4> world_matrices;
+
+		inline size_t getNumSolvedJoints() const { return world_matrices.size(); }
+		inline const ofMatrix4x4& getLocalMatrix(size_t index) const { return local_matrices[index]; }
+		inline const ofMatrix4x4& getWorldMatrix(size_t index) const { return world_matrices[index]; }
 	};
     
     class RigidBodyDescription
@@ -45,7 +63,8 @@ public:
         int id;
         int parent_id;
         ofVec3f offset;
-        vector<string> marker_names;
+        vector<ofVec3f> marker_offsets;  // NatNet 3.0 and later
+        vector<string> marker_names;     // NatNet 4.0 and later
     };
     
     class SkeletonDescription
@@ -54,6 +73,11 @@ public:
         string name;
         int id;
         vector<RigidBodyDescription> joints;
+
+        // precomputed hierarchy, indices into joints
+        vector<int> parent_indices;     // -1 for roots
+        vector<int> joint_order;        // parents always precede their children
+        vector<int> joint_index_by_id;  // (joint id & 0xffff) -> index, -1 if unused
     };
     
     class MarkerSetDescription
@@ -63,13 +87,65 @@ public:
         vector<string> marker_names;
     };
 
-	ofxNatNet()
-		: thread(NULL)
-		, frame_number(0)
-		, latency(0)
-		, timeout(0.1)
+	// per-instance records for instanced drawing, see NatNet::PoseBuffer.
+	// ofxNatNetPoseDrawer draws them with one instanced call per section.
+	typedef NatNet::MarkerInstance MarkerInstance;
+	typedef NatNet::TransformInstance TransformInstance;
+	typedef NatNet::PoseBuffer PoseBuffer;
+
+	// view of a freshly decoded frame, passed to frameReceived listeners on
+	// the receiver thread. the referenced vectors belong to the decoder and
+	// are only valid for the duration of the notification; copy what you
+	// need to keep. skeletons are solved (local / world matrices) already.
+	// the data is in the core's plain types (natnet/Frame.h), so nothing is
+	// converted on the hot path.
+	class FrameEventArgs
 	{
-	}
+	public:
+		int frame_number;
+		float latency;
+		double timestamp;  // server timestamp in seconds
+
+		const vector<vector<NatNet::Marker> >& markers_set;
+		const vector<NatNet::Marker>& markers;
+		const vector<NatNet::Marker>& filterd_markers;
+		const vector<NatNet::RigidBody>& rigidbodies;
+		const vector<NatNet::Skeleton>& skeletons;
+
+		// persistent marker ids and track ages, parallel to the unlabeled
+		// markers at the start of markers. empty while marker tracking is off.
+		const vector<int>& marker_ids;
+		const vector<int>& marker_ages;
+
+		// indices into rigidbodies that gained / lost tracking this frame,
+		// test with NatNet::testBit()
+		const vector<uint64_t>& tracking_gained;
+		const vector<uint64_t>& tracking_lost;
+		int num_tracking_changes;
+
+		FrameEventArgs(const NatNet::Frame& frame)
+			: frame_number(frame.frame_number)
+			, latency(frame.latency)
+			, timestamp(frame.timestamp)
+			, markers_set(frame.markers_set)
+			, markers(frame.markers)
+			, filterd_markers(frame.filterd_markers)
+			, rigidbodies(frame.rigidbodies)
+			, skeletons(frame.skeletons)
+			, marker_ids(frame.marker_ids)
+			, marker_ages(frame.marker_ages)
+			, tracking_gained(frame.tracking_gained)
+			, tracking_lost(frame.tracking_lost)
+			, num_tracking_changes(frame.num_tracking_changes)
+		{
+		}
+	};
+
+	// notified on the receiver thread right after a frame is decoded.
+	// listeners must be quick and must not call back into this object.
+	ofEvent<FrameEventArgs> frameReceived;
+
+	ofxNatNet();
 	~ofxNatNet() { dispose(); }
 
 	void setup(string interface_name, string target_host,
@@ -77,6 +153,20 @@ public:
 			   int command_port = 1510, int data_port = 1511);
 	void update();
 
+	// offline decoding
+	//
+	// no sockets and no receiver thread: packets captured from the data or
+	// command port are handed to decodePacket() and decoded synchronously,
+	// firing frameReceived on the calling thread. a ping response packet
+	// in the stream overrides natnet_major / natnet_minor.
+	void setupOffline(int natnet_major, int natnet_minor);
+	bool decodePacket(const void* data, size_t size);
+
+	// blocks until a frame newer than the one published by the last
+	// update() / waitForFrame() has been decoded. returns false on timeout.
+	// call update() afterwards to publish it.
+	bool waitForFrame(float timeout_sec);
+
 	void sendPing();
     void sendRequestDescription();
 
@@ -87,6 +177,12 @@ public:
 	float getDataRate();
 	float getLastPacketArraivalTime();
 
+	// time since the last data packet on the core's monotonic nanosecond
+	// clock; stays exact over long uptimes, unlike the float seconds above
+	int64_t getNanosSinceLastPacket();
+
+	// output transform and marker filtering. safe to change while
+	// receiving: the receiver thread picks them up from the next frame
 	void setScale(float v);
 	ofVec3f getScale();
 
@@ -95,12 +191,23 @@ public:
 
 	void setDuplicatedPointRemovalDistance(float v);
 
+	// whether skeleton joints are streamed relative to their parent
+	// (Motive's "Local" skeleton coordinates, the default) or in world space
+	void setSkeletonLocalCoordinates(bool yn);
+	bool getSkeletonLocalCoordinates();
+
 	inline const size_t getNumMarkersSet() { return markers_set.size(); }
 	inline const vector<Marker>& getMarkersSetAt(size_t index) { return markers_set[index]; }
 	
 	inline const size_t getNumMarker() { return markers.size(); }
 	inline const Marker& getMarker(size_t index) { return markers[index]; }
 
+	// persistent id of getMarker(index) across frames, and the frames
+	// since its track started. -1 / 0 while marker tracking is off and
+	// for labeled markers, which are not tracked.
+	inline int getMarkerId(size_t index) { return index < marker_ids.size() ? marker_ids[index] : -1; }
+	inline int getMarkerAge(size_t index) { return index < marker_ages.size() ? marker_ages[index] : 0; }
+
 	inline const size_t getNumFilterdMarker() { return filterd_markers.size(); }
 	inline const Marker& getFilterdMarker(size_t index)
 	{
@@ -141,13 +248,134 @@ public:
 		return true;
 	}
 
+	// rigid bodies and skeletons that leave the stream stay with their
+	// last pose unless evicted, see NatNet::Client::Eviction. getFootprint()
+	// reports what the per-id state holds.
+	typedef NatNet::Client::Eviction Eviction;
+	typedef NatNet::Client::Footprint Footprint;
+
+	void setEviction(const Eviction& eviction);
+	Eviction getEviction();
+	Footprint getFootprint();
+
 	void setBufferTime(float sec);
 	float getBufferTime();
+
+	// decode only what is used: frame sections and rigid body / skeleton
+	// ids, see NatNet::Subscription. the rest is skipped unparsed and is
+	// missing from the frame; entities not decoded keep their last pose.
+	void setSubscription(const NatNet::Subscription& subscription);
+	NatNet::Subscription getSubscription();
+
+	// decode large frames on num_threads threads, see
+	// NatNet::Client::setParallelDecode(). 0 or 1 turns it off.
+	void setParallelDecode(int num_threads, size_t min_frame_bytes = 32768);
+
+	// lazy frames: the receiver thread only indexes each frame and
+	// getFrameView() decodes on access, see NatNet::Client::setLazyFrames().
+	// update() then has no poses to convert; read them from the view.
+	void setLazyFrames(bool yn);
+	NatNet::FrameViewPtr getFrameView();
+
+	// spatial queries (radius, k nearest, box) over each frame's markers,
+	// see NatNet::MarkerIndex. the indices are built on the receiver thread
+	// and can be queried from any thread; query results index into the
+	// markers (unlabeled and labeled, as getMarker()) or the filtered
+	// markers of the index's own frame, which may be newer than update()'s.
+	void setMarkerIndexEnabled(bool yn);
+	NatNet::MarkerIndexPtr getMarkerIndex();
+	NatNet::MarkerIndexPtr getFilterdMarkerIndex();
+
+	// decode only the newest pending frame and skip the ones it supersedes,
+	// see NatNet::Client::setCoalesceFrames(). frameReceived, the frame
+	// history and the relay then miss the skipped frames.
+	void setCoalesceFrames(bool yn);
+	uint64_t getNumCoalescedFrames();
 	
 	void setTimeout(float timeout);
 
+	// data socket receive buffer, see NatNet::Client::setReceiveBufferSize.
+	// getReceiveBufferSize() is what the kernel granted.
+	void setReceiveBufferSize(int bytes);
+	int getReceiveBufferSize();
+	void setReceiveBufferAutoGrow(int max_bytes);
+
+	// datagrams dropped by the kernel since setup(), Linux only
+	uint64_t getNumKernelDrops();
+
+	// receiver thread scheduling, see NatNet::Client::setWaitMode() etc.
+	// the effect shows in getLatencyStats().
+	typedef NatNet::Client::LatencyStats LatencyStats;
+
+	void setReceiverWaitMode(NatNet::Client::WaitMode mode, int spin_usec = 200);
+	void setReceiverAffinity(int cpu);
+	void setReceiverPriority(int priority);
+	LatencyStats getLatencyStats();
+
 	void forceSetNatNetVersion(int major, int minor);
 
+	// pose smoothing
+	//
+	// filters rigid body poses on the receiver thread before they are
+	// published, so update(), frameReceived and the relay all see smoothed
+	// poses. settings apply per rigid body id, the default to the rest.
+	// see NatNet::RigidBodyFilter.
+	typedef NatNet::RigidBodyFilter::Settings FilterSettings;
+
+	void setRigidBodyFilterEnabled(bool yn);
+	bool isRigidBodyFilterEnabled();
+	void setRigidBodyFilter(const FilterSettings& settings);
+	void setRigidBodyFilter(int id, const FilterSettings& settings);
+	void clearRigidBodyFilter(int id);
+
+	// marker tracking
+	//
+	// gives unlabeled markers persistent ids across frames on the receiver
+	// thread, see NatNet::MarkerTracker. max_distance is in output units,
+	// so set it after setScale() / setTransform().
+	typedef NatNet::MarkerTracker::Settings MarkerTrackerSettings;
+
+	void setMarkerTrackingEnabled(bool yn);
+	bool isMarkerTrackingEnabled();
+	void setMarkerTracker(const MarkerTrackerSettings& settings);
+
+	// the frame published by the last update() as instance records, filled
+	// by update(). fillPoseBuffer() copies it; the vectors only grow, so a
+	// buffer kept across frames stops allocating.
+	inline const PoseBuffer& getPoseBuffer() const { return pose_buffer; }
+	void fillPoseBuffer(PoseBuffer& buffer) const;
+
+	// frame history
+	//
+	// keeps the last num_frames decoded frames in a lock-free ring so that
+	// several consumers can each see every frame, independent of update().
+	// frames larger than max_frame_bytes are not recorded. 0 disables it.
+	// readers created before a resize keep reading the old ring.
+	void setFrameHistorySize(size_t num_frames, size_t max_frame_bytes = 0x10000);
+	size_t getFrameHistorySize();
+
+	// new reader positioned at the newest frame; invalid while the
+	// history is disabled
+	ofxNatNetFrameRing::Reader createFrameReader();
+
+	// relay
+	//
+	// republishes every decoded frame as an ofxNatNetCompactFrame, so other
+	// processes on this host get poses without joining the multicast group
+	// or decoding NatNet themselves. frames go into a named shared-memory
+	// ring and / or to UDP targets (one datagram per frame, frames larger
+	// than a datagram are dropped). other processes read the shared-memory
+	// ring with ofxNatNetSharedMemoryReader, which has no openFrameworks
+	// dependency.
+	bool setRelaySharedMemory(const string& name, size_t num_frames = 64,
+							  size_t max_frame_bytes = 0x10000);
+	void closeRelaySharedMemory();
+
+	void addRelayTarget(const string& host, int port);
+	void clearRelayTargets();
+
+	size_t getNumRelayDrops();
+
 	void debugDraw();
 	void debugDrawInformation();
 	void debugDrawMarkers();
@@ -155,17 +383,62 @@ public:
 	inline const vector<MarkerSetDescription> getMarkerSetDescriptions() { return markerset_descs; }
 	inline const vector<RigidBodyDescription> getRigidBodyDescriptions() { return rigidbody_descs; }
 	inline const vector<SkeletonDescription> getSkeletonDescriptions() { return skeleton_descs; }
-    
+
+	// name lookup
+	//
+	// slots are dense indices into the description vectors. resolve a name
+	// once (after sendRequestDescription()) and keep the slot; the *BySlot
+	// accessors are plain array lookups and return NULL when the entity is
+	// not present in the current frame. slots are invalidated when the
+	// description version changes.
+
+	inline int getDescriptionVersion() const { return description_version; }
+
+	int getMarkerSetSlot(const string& name) const;
+	int getRigidBodySlot(const string& name) const;
+	int getSkeletonSlot(const string& name) const;
+
+	inline const vector<Marker>* getMarkersSetBySlot(int slot) const
+	{
+		if (slot < 0 || slot >= markerset_slots.size()) return NULL;
+		int index = markerset_slots[slot];
+		return index < 0 ? NULL : &markers_set[index];
+	}
+	inline const RigidBody* getRigidBodyBySlot(int slot) const
+	{
+		if (slot < 0 || slot >= rigidbody_slots.size()) return NULL;
+		return rigidbody_slots[slot];
+	}
+	inline const Skeleton* getSkeletonBySlot(int slot) const
+	{
+		if (slot < 0 || slot >= skeleton_slots.size()) return NULL;
+		return skeleton_slots[slot];
+	}
+
+	inline const MarkerSetDescription& getMarkerSetDescriptionAt(int slot) const { return markerset_descs[slot]; }
+	inline const RigidBodyDescription& getRigidBodyDescriptionAt(int slot) const { return rigidbody_descs[slot]; }
+	inline const SkeletonDescription& getSkeletonDescriptionAt(int slot) const { return skeleton_descs[slot]; }
+
+	typedef NatNet::NameIndex NameIndex;
+
+	// the underlying core client, for settings this adapter doesn't wrap
+	inline NatNet::Client& getClient() { return client; }
+
 protected:
-	InternalThread* thread;
+	NatNet::Client client;
+	ofMatrix4x4 transform;
 
 	int frame_number;
 	float latency;
 	float timeout;
+
+	uint64_t frame_serial;
 	
 	vector<vector<Marker> > markers_set;
 	vector<Marker> filterd_markers;
 	vector<Marker> markers;
+	vector<int> marker_ids;
+	vector<int> marker_ages;
 
 	map<int, RigidBody> rigidbodies;
 	vector<RigidBody*> rigidbodies_arr;
@@ -176,9 +449,24 @@ protected:
 	vector<RigidBodyDescription> rigidbody_descs;
 	vector<SkeletonDescription> skeleton_descs;
 	vector<MarkerSetDescription> markerset_descs;
-    
+
+	int description_version;
+	NameIndex markerset_index;
+	NameIndex rigidbody_index;
+	NameIndex skeleton_index;
+
+	vector<int> markerset_slots;
+	vector<RigidBody*> rigidbody_slots;
+	vector<Skeleton*> skeleton_slots;
+
+	PoseBuffer pose_buffer;
+	ofxNatNetPoseDrawer pose_drawer;  // debugDrawMarkers()
+
 	void dispose();
 
+	static void convertRigidBody(const NatNet::RigidBody& src, RigidBody& dst);
+	static void convertSkeleton(const NatNet::Skeleton& src, Skeleton& dst);
+
 private:
 	ofxNatNet(const ofxNatNet&);
 	ofxNatNet& operator=(const ofxNatNet&);
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// flat, self-describing binary form of a decoded frame. everything is
+// little-endian 32-bit words (plus one double in the header), so a frame
+// can be memcpy'd between threads, processes or hosts and read in place
+// without parsing. positions and orientations have the ofxNatNet
+// transform applied already.
+//
+// layout:
+//   Header
+//   Marker    markers[num_markers + num_filterd_markers + num_markerset_markers]
+//   MarkerSet markersets[num_markersets]
+//   RigidBody rigidbodies[num_rigidbodies]
+//   Skeleton  skeletons[num_skeletons]
+//   RigidBody joints[num_joints]
+
+class ofxNatNetCompactFrame
+{
+public:
+	enum
+	{
+		MAGIC = 0x46434e4e,  // "NNCF"
+		VERSION = 1
+	};
+
+	enum FrameFlags
+	{
+		FRAME_TRACKING_CHANGED = 0x01  // some rigid body has a TRACKING_* flag
+	};
+
+	enum RigidBodyFlags
+	{
+		RIGIDBODY_ACTIVE = 0x01,
+		RIGIDBODY_TRACKING_GAINED = 0x02,  // active now, not in the previous frame
+		RIGIDBODY_TRACKING_LOST = 0x04     // active in the previous frame, not now
+	};
+
+	struct Header
+	{
+		uint32_t magic;
+		uint16_t version;
+		uint16_t header_size;
+		uint32_t size;  // total bytes including the header
+
+		int32_t frame_number;
+		double timestamp;  // server timestamp in seconds
+		float latency;
+		uint32_t timecode;
+		uint32_t timecode_sub;
+		uint32_t flags;
+
+		uint32_t num_markers;
+		uint32_t num_filterd_markers;
+		uint32_t num_markerset_markers;
+		uint32_t num_markersets;
+		uint32_t num_rigidbodies;
+		uint32_t num_skeletons;
+		uint32_t num_joints;
+		uint32_t reserved;
+	};
+
+	struct Marker
+	{
+		float x, y, z;
+	};
+
+	struct MarkerSet
+	{
+		uint32_t first_marker;  // index into getMarkerSetMarkers()
+		uint32_t num_markers;
+	};
+
+	struct RigidBody
+	{
+		int32_t id;
+		float position[3];
+		float orientation[4];  // x, y, z, w
+		float mean_marker_error;
+		uint32_t flags;
+	};
+
+	struct Skeleton
+	{
+		int32_t id;
+		uint32_t first_joint;  // index into getJoints()
+		uint32_t num_joints;
+	};
+
+	std::vector<char> data;
+
+	static size_t computeSize(size_t num_markers, size_t num_markersets,
+							  size_t num_rigidbodies, size_t num_skeletons,
+							  size_t num_joints)
+	{
+		return sizeof(Header) + num_markers * sizeof(Marker)
+			+ num_markersets * sizeof(MarkerSet)
+			+ (num_rigidbodies + num_joints) * sizeof(RigidBody)
+			+ num_skeletons * sizeof(Skeleton);
+	}
+
+	// checks magic, version and that every section fits in size bytes
+	static bool validate(const void* ptr, size_t size)
+	{
+		if (size < sizeof(Header)) return false;
+
+		Header h;
+		memcpy(&h, ptr, sizeof(Header));
+
+		if (h.magic != MAGIC || h.version != VERSION
+			|| h.header_size != sizeof(Header) || h.size > size)
+			return false;
+
+		uint64_t num_markers = (uint64_t)h.num_markers + h.num_filterd_markers
+			+ h.num_markerset_markers;
+		uint64_t need = sizeof(Header) + num_markers * sizeof(Marker)
+			+ (uint64_t)h.num_markersets * sizeof(MarkerSet)
+			+ ((uint64_t)h.num_rigidbodies + h.num_joints) * sizeof(RigidBody)
+			+ (uint64_t)h.num_skeletons * sizeof(Skeleton);
+
+		return need == h.size;
+	}
+
+	inline bool isValid() const { return validate(data.data(), data.size()); }
+
+	inline const Header& getHeader() const { return *(const Header*)data.data(); }
+
+	inline const Marker* getMarkers() const
+	{
+		return (const Marker*)(data.data() + sizeof(Header));
+	}
+	inline const Marker* getFilterdMarkers() const
+	{
+		return getMarkers() + getHeader().num_markers;
+	}
+	inline const Marker* getMarkerSetMarkers() const
+	{
+		return getFilterdMarkers() + getHeader().num_filterd_markers;
+	}
+	inline const MarkerSet* getMarkerSets() const
+	{
+		return (const MarkerSet*)(getMarkerSetMarkers() + getHeader().num_markerset_markers);
+	}
+	inline const RigidBody* getRigidBodies() const
+	{
+		return (const RigidBody*)(getMarkerSets() + getHeader().num_markersets);
+	}
+	inline const Skeleton* getSkeletons() const
+	{
+		return (const Skeleton*)(getRigidBodies() + getHeader().num_rigidbodies);
+	}
+	inline const RigidBody* getJoints() const
+	{
+		return (const RigidBody*)(getSkeletons() + getHeader().num_skeletons);
+	}
+};
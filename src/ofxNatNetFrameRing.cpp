@@ -0,0 +1,115 @@
+#include "ofxNatNetFrameRing.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+ofxNatNetFrameRing::ofxNatNetFrameRing(size_t num_slots, size_t slot_size)
+	: num_slots(num_slots > 0 ? num_slots : 1)
+	, slot_size(slot_size)
+	, slots(new Slot[num_slots > 0 ? num_slots : 1])
+	, storage(this->num_slots * slot_size)
+	, head(0)
+	, oversized(0)
+{
+	for (size_t i = 0; i < this->num_slots; i++)
+	{
+		slots[i].seq.store(0, std::memory_order_relaxed);
+		slots[i].size.store(0, std::memory_order_relaxed);
+	}
+}
+
+bool ofxNatNetFrameRing::write(const void* data, size_t size)
+{
+	if (size > slot_size)
+	{
+		oversized.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	uint64_t n = head.load(std::memory_order_relaxed);
+	Slot& slot = slots[n % num_slots];
+
+	slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	memcpy(&storage[(n % num_slots) * slot_size], data, size);
+	slot.size.store(size, std::memory_order_relaxed);
+
+	slot.seq.store(2 * n + 2, std::memory_order_release);
+	head.store(n + 1, std::memory_order_release);
+
+	return true;
+}
+
+//
+
+ofxNatNetFrameRing::Reader::Reader(const std::shared_ptr<ofxNatNetFrameRing>& ring)
+	: ring(ring)
+	, cursor(ring ? ring->getNumWritten() : 0)
+	, overruns(0)
+{
+}
+
+bool ofxNatNetFrameRing::Reader::read(ofxNatNetCompactFrame& frame)
+{
+	if (!ring) return false;
+
+	const size_t num_slots = ring->num_slots;
+
+	for (;;)
+	{
+		uint64_t head = ring->head.load(std::memory_order_acquire);
+		if (cursor >= head) return false;
+
+		if (head - cursor > num_slots)
+		{
+			overruns += head - cursor - num_slots;
+			cursor = head - num_slots;
+		}
+
+		Slot& slot = ring->slots[cursor % num_slots];
+		const uint64_t expected = 2 * cursor + 2;
+
+		uint64_t seq = slot.seq.load(std::memory_order_acquire);
+		if (seq != expected)
+		{
+			// the writer lapped us on this slot
+			overruns++;
+			cursor++;
+			continue;
+		}
+
+		size_t size = slot.size.load(std::memory_order_relaxed);
+		if (size > ring->slot_size) size = ring->slot_size;
+
+		frame.data.resize(size);
+		memcpy(frame.data.data(), &ring->storage[(cursor % num_slots) * ring->slot_size], size);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.seq.load(std::memory_order_relaxed) != seq)
+		{
+			// overwritten while copying
+			overruns++;
+			cursor++;
+			continue;
+		}
+
+		cursor++;
+		return true;
+	}
+}
+
+void ofxNatNetFrameRing::Reader::seekToLatest()
+{
+	if (ring) cursor = ring->getNumWritten();
+}
+
+uint64_t ofxNatNetFrameRing::Reader::getNumPending() const
+{
+	if (!ring) return 0;
+
+	uint64_t head = ring->getNumWritten();
+	if (cursor >= head) return 0;
+	return std::min<uint64_t>(head - cursor, ring->num_slots);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "ofxNatNetCompactFrame.h"
+
+// fixed-size single-producer / multi-consumer history of compact frames.
+//
+// the receiver thread writes every decoded frame into the next slot and
+// never waits for anyone. each Reader keeps its own cursor, so every
+// consumer sees every frame in order as long as it keeps up; a reader
+// that falls more than getNumSlots() frames behind skips ahead to the
+// oldest frame still held and counts the skipped frames as overruns.
+//
+// slots are guarded by a sequence counter (seqlock). readers copy the
+// slot and retry when the counter changed underneath them.
+
+class ofxNatNetFrameRing
+{
+public:
+	class Reader
+	{
+	public:
+		Reader()
+			: cursor(0)
+			, overruns(0)
+		{
+		}
+
+		explicit Reader(const std::shared_ptr<ofxNatNetFrameRing>& ring);
+
+		// copies the next frame into frame. returns false when the reader
+		// has caught up with the writer (or has no ring).
+		bool read(ofxNatNetCompactFrame& frame);
+
+		// drops everything pending so the next read() returns the next
+		// frame written
+		void seekToLatest();
+
+		inline bool isValid() const { return ring != NULL; }
+		inline uint64_t getNumOverruns() const { return overruns; }
+		uint64_t getNumPending() const;
+
+	private:
+		std::shared_ptr<ofxNatNetFrameRing> ring;
+		uint64_t cursor;
+		uint64_t overruns;
+	};
+
+	ofxNatNetFrameRing(size_t num_slots, size_t slot_size);
+
+	// single producer only. returns false, and counts the frame as
+	// oversized, when size exceeds getSlotSize()
+	bool write(const void* data, size_t size);
+
+	inline size_t getNumSlots() const { return num_slots; }
+	inline size_t getSlotSize() const { return slot_size; }
+
+	inline uint64_t getNumWritten() const { return head.load(std::memory_order_acquire); }
+	inline uint64_t getNumOversized() const { return oversized.load(std::memory_order_relaxed); }
+
+private:
+	struct Slot
+	{
+		std::atomic<uint64_t> seq;  // 2n + 1 while frame n is written, 2n + 2 once published
+		std::atomic<uint32_t> size;
+	};
+
+	const size_t num_slots;
+	const size_t slot_size;
+
+	std::unique_ptr<Slot[]> slots;
+	std::vector<char> storage;
+
+	std::atomic<uint64_t> head;
+	std::atomic<uint64_t> oversized;
+
+	ofxNatNetFrameRing(const ofxNatNetFrameRing&);
+	ofxNatNetFrameRing& operator=(const ofxNatNetFrameRing&);
+};
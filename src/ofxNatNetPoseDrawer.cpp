@@ -0,0 +1,213 @@
+#include "ofxNatNetPoseDrawer.h"
+
+#include <stddef.h>
+
+// attribute locations past the ones openFrameworks binds by default
+// (position, color, normal, texcoord)
+enum
+{
+	MARKER_LOCATION = 5,
+	MATRIX_LOCATION = 6,  // 4 columns
+	PARAMS_LOCATION = 10
+};
+
+// the shaders are written once against these macros
+static const char* VERTEX_HEADER_120 =
+	"#version 120\n"
+	"#define IN attribute\n"
+	"#define OUT varying\n"
+	"#define POSITION gl_Vertex\n"
+	"#define COLOR gl_Color\n"
+	"#define MVP gl_ModelViewProjectionMatrix\n";
+
+static const char* VERTEX_HEADER_150 =
+	"#version 150\n"
+	"#define IN in\n"
+	"#define OUT out\n"
+	"uniform mat4 modelViewProjectionMatrix;\n"
+	"uniform vec4 globalColor;\n"
+	"uniform float vertex_colors;\n"
+	"in vec4 position;\n"
+	"in vec4 color;\n"
+	"#define POSITION position\n"
+	"#define COLOR mix(globalColor, color, vertex_colors)\n"
+	"#define MVP modelViewProjectionMatrix\n";
+
+static const char* FRAGMENT_HEADER_120 =
+	"#version 120\n"
+	"#define IN varying\n"
+	"#define FRAG_COLOR gl_FragColor\n";
+
+static const char* FRAGMENT_HEADER_150 =
+	"#version 150\n"
+	"#define IN in\n"
+	"out vec4 frag_color;\n"
+	"#define FRAG_COLOR frag_color\n";
+
+static const char* MARKER_VERTEX =
+	"uniform float size;\n"
+	"IN vec4 instance;\n"
+	"OUT vec4 instance_color;\n"
+	"void main()\n"
+	"{\n"
+	"	instance_color = COLOR;\n"
+	"	gl_Position = MVP * vec4(POSITION.xyz * size + instance.xyz, 1.0);\n"
+	"}\n";
+
+// matrices are ofMatrix4x4 layout, i.e. GL column-major
+static const char* TRANSFORM_VERTEX =
+	"uniform float size;\n"
+	"IN vec4 matrix0;\n"
+	"IN vec4 matrix1;\n"
+	"IN vec4 matrix2;\n"
+	"IN vec4 matrix3;\n"
+	"IN vec4 params;\n"
+	"OUT vec4 instance_color;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 c = COLOR;\n"
+	"	instance_color = vec4(c.rgb * (params.y > 0.5 ? 1.0 : 0.3), c.a);\n"
+	"	gl_Position = MVP * mat4(matrix0, matrix1, matrix2, matrix3) * vec4(POSITION.xyz * size, 1.0);\n"
+	"}\n";
+
+static const char* FRAGMENT =
+	"IN vec4 instance_color;\n"
+	"void main()\n"
+	"{\n"
+	"	FRAG_COLOR = instance_color;\n"
+	"}\n";
+
+static bool loadShader(ofShader& shader, const char* vertex, bool transforms)
+{
+	bool programmable = ofIsGLProgrammableRenderer();
+	string vertex_source = string(programmable ? VERTEX_HEADER_150 : VERTEX_HEADER_120) + vertex;
+	string fragment_source = string(programmable ? FRAGMENT_HEADER_150 : FRAGMENT_HEADER_120) + FRAGMENT;
+
+	if (!shader.setupShaderFromSource(GL_VERTEX_SHADER, vertex_source)) return false;
+	if (!shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragment_source)) return false;
+
+	if (programmable) shader.bindDefaults();
+	if (transforms)
+	{
+		shader.bindAttribute(MATRIX_LOCATION + 0, "matrix0");
+		shader.bindAttribute(MATRIX_LOCATION + 1, "matrix1");
+		shader.bindAttribute(MATRIX_LOCATION + 2, "matrix2");
+		shader.bindAttribute(MATRIX_LOCATION + 3, "matrix3");
+		shader.bindAttribute(PARAMS_LOCATION, "params");
+	}
+	else
+		shader.bindAttribute(MARKER_LOCATION, "instance");
+
+	return shader.linkProgram();
+}
+
+ofxNatNetPoseDrawer::ofxNatNetPoseDrawer()
+	: ready(false)
+	, failed(false)
+	, box_mode(GL_TRIANGLES)
+	, axis_mode(GL_LINES)
+	, num_marker_data(0)
+	, num_transform_data(0)
+{
+}
+
+bool ofxNatNetPoseDrawer::setup()
+{
+	if (ready || failed) return ready;
+
+	if (!loadShader(marker_shader, MARKER_VERTEX, false)
+		|| !loadShader(transform_shader, TRANSFORM_VERTEX, true))
+	{
+		ofLogError("ofxNatNetPoseDrawer") << "instancing shaders failed to build";
+		failed = true;
+		return false;
+	}
+
+	ofMesh box_mesh = ofMesh::box(1, 1, 1, 1, 1, 1);
+	ofMesh axis_mesh = ofMesh::axis(1);
+	marker_box.setMesh(box_mesh, GL_STATIC_DRAW);
+	transform_box.setMesh(box_mesh, GL_STATIC_DRAW);
+	axis.setMesh(axis_mesh, GL_STATIC_DRAW);
+	box_mode = ofGetGLPrimitiveMode(box_mesh.getMode());
+	axis_mode = ofGetGLPrimitiveMode(axis_mesh.getMode());
+
+	ready = true;
+	return true;
+}
+
+void ofxNatNetPoseDrawer::update(const NatNet::PoseBuffer& buffer)
+{
+	if (!setup()) return;
+
+	num_marker_data = buffer.markers.size();
+	num_transform_data = buffer.transforms.size();
+
+	if (num_marker_data)
+		marker_data.setData(num_marker_data * sizeof(NatNet::MarkerInstance), buffer.markers.data(),
+							GL_STREAM_DRAW);
+	if (num_transform_data)
+		transform_data.setData(num_transform_data * sizeof(NatNet::TransformInstance),
+							   buffer.transforms.data(), GL_STREAM_DRAW);
+}
+
+void ofxNatNetPoseDrawer::setMarkerAttributes(ofVbo& vbo, size_t first)
+{
+	int stride = sizeof(NatNet::MarkerInstance);
+	vbo.setAttributeBuffer(MARKER_LOCATION, marker_data, 4, stride, first * stride);
+	vbo.setAttributeDivisor(MARKER_LOCATION, 1);
+}
+
+void ofxNatNetPoseDrawer::setTransformAttributes(ofVbo& vbo, size_t first)
+{
+	int stride = sizeof(NatNet::TransformInstance);
+	size_t offset = first * stride;
+
+	for (int i = 0; i < 4; i++)
+	{
+		vbo.setAttributeBuffer(MATRIX_LOCATION + i, transform_data, 4, stride, offset + i * 4 * sizeof(float));
+		vbo.setAttributeDivisor(MATRIX_LOCATION + i, 1);
+	}
+
+	vbo.setAttributeBuffer(PARAMS_LOCATION, transform_data, 4, stride,
+						   offset + offsetof(NatNet::TransformInstance, params));
+	vbo.setAttributeDivisor(PARAMS_LOCATION, 1);
+}
+
+void ofxNatNetPoseDrawer::drawInstanced(ofShader& shader, ofVbo& vbo, GLenum mode, size_t count,
+										float size, bool vertex_colors)
+{
+	shader.begin();
+	shader.setUniform1f("size", size);
+	shader.setUniform1f("vertex_colors", vertex_colors ? 1 : 0);
+
+	if (vbo.getUsingIndices())
+		vbo.drawElementsInstanced(mode, vbo.getNumIndices(), count);
+	else
+		vbo.drawInstanced(mode, 0, vbo.getNumVertices(), count);
+
+	shader.end();
+}
+
+void ofxNatNetPoseDrawer::drawMarkers(size_t first, size_t count, float size)
+{
+	if (!ready || count == 0 || first + count > num_marker_data) return;
+
+	setMarkerAttributes(marker_box, first);
+	drawInstanced(marker_shader, marker_box, box_mode, count, size, false);
+}
+
+void ofxNatNetPoseDrawer::drawAxes(size_t first, size_t count, float size)
+{
+	if (!ready || count == 0 || first + count > num_transform_data) return;
+
+	setTransformAttributes(axis, first);
+	drawInstanced(transform_shader, axis, axis_mode, count, size, true);
+}
+
+void ofxNatNetPoseDrawer::drawBoxes(size_t first, size_t count, float size)
+{
+	if (!ready || count == 0 || first + count > num_transform_data) return;
+
+	setTransformAttributes(transform_box, first);
+	drawInstanced(transform_shader, transform_box, box_mode, count, size, false);
+}
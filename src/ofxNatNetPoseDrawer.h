@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include "natnet/PoseBuffer.h"
+
+// draws the sections of a NatNet::PoseBuffer with one instanced draw call
+// each: the instance records are uploaded to buffer objects as they are
+// and read as per-instance attributes by a small shader, so the CPU cost
+// is the upload, not one call per marker or body.
+//
+//   drawer.update(natnet.getPoseBuffer());
+//   ofSetColor(255);
+//   drawer.drawMarkers(0, buffer.num_markers, 3);
+//
+// works with the fixed function (GLSL 1.20, needs instanced arrays) and
+// the programmable renderer (GLSL 1.50). GL objects are created on the
+// first update(), so a drawer may be constructed before the GL context.
+
+class ofxNatNetPoseDrawer
+{
+public:
+	ofxNatNetPoseDrawer();
+
+	// uploads buffer's instance records, once per frame before drawing
+	void update(const NatNet::PoseBuffer& buffer);
+
+	// boxes of size at markers [first, first + count), in the current color
+	void drawMarkers(size_t first, size_t count, float size);
+
+	// axes of length size at transforms [first, first + count), dimmed
+	// for rigid bodies that are not tracked
+	void drawAxes(size_t first, size_t count, float size);
+
+	// boxes of size in transforms [first, first + count), in the current
+	// color, dimmed like drawAxes()
+	void drawBoxes(size_t first, size_t count, float size);
+
+private:
+	bool ready;
+	bool failed;  // shaders did not build, not retried
+
+	ofShader marker_shader;
+	ofShader transform_shader;
+
+	// the marker boxes and transform boxes carry different instance
+	// attributes, so they get a vbo each
+	ofVbo marker_box;
+	ofVbo transform_box;
+	ofVbo axis;
+	GLenum box_mode;
+	GLenum axis_mode;
+
+	ofBufferObject marker_data;
+	ofBufferObject transform_data;
+	size_t num_marker_data;
+	size_t num_transform_data;
+
+	bool setup();
+	void setMarkerAttributes(ofVbo& vbo, size_t first);
+	void setTransformAttributes(ofVbo& vbo, size_t first);
+	void drawInstanced(ofShader& shader, ofVbo& vbo, GLenum mode, size_t count, float size,
+					   bool vertex_colors);
+
+	ofxNatNetPoseDrawer(const ofxNatNetPoseDrawer&);
+	ofxNatNetPoseDrawer& operator=(const ofxNatNetPoseDrawer&);
+};
@@ -0,0 +1,203 @@
+#include "ofxNatNetSharedMemory.h"
+
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+			  "shared-memory frames need address-free atomics");
+static_assert(sizeof(std::atomic<uint32_t>) == 4 && sizeof(std::atomic<uint64_t>) == 8,
+			  "shared-memory header fields keep their plain sizes");
+
+static std::string toSegmentName(const std::string& name)
+{
+#ifdef _WIN32
+	return name;
+#else
+	return name.size() && name[0] == '/' ? name : "/" + name;
+#endif
+}
+
+#ifndef _WIN32
+static void retireSegment(const std::string& name)
+{
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	if (fd < 0) return;
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(ofxNatNetSharedMemory::Header))
+	{
+		void* ptr = mmap(NULL, sizeof(ofxNatNetSharedMemory::Header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (ptr != MAP_FAILED)
+		{
+			((ofxNatNetSharedMemory::Header*)ptr)->magic.store(0, std::memory_order_seq_cst);
+			munmap(ptr, sizeof(ofxNatNetSharedMemory::Header));
+		}
+	}
+
+	::close(fd);
+	shm_unlink(name.c_str());
+}
+#endif
+
+static size_t alignedSlotSize(size_t slot_size) { return (slot_size + 7) & ~size_t(7); }
+
+size_t ofxNatNetSharedMemory::computeSegmentSize(size_t num_slots, size_t slot_size)
+{
+	return sizeof(Header) + num_slots * (sizeof(Slot) + alignedSlotSize(slot_size));
+}
+
+ofxNatNetSharedMemory::ofxNatNetSharedMemory()
+	: segment_size(0)
+	, header(NULL)
+	, slots(NULL)
+#ifdef _WIN32
+	, mapping(NULL)
+#else
+	, fd(-1)
+#endif
+{
+}
+
+bool ofxNatNetSharedMemory::create(const std::string& name, size_t num_slots, size_t slot_size)
+{
+	close();
+
+	if (num_slots == 0) return false;
+
+	this->name = toSegmentName(name);
+	slot_size = alignedSlotSize(slot_size);
+	segment_size = computeSegmentSize(num_slots, slot_size);
+
+	void* ptr = NULL;
+
+#ifdef _WIN32
+	mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+								 (DWORD)((uint64_t)segment_size >> 32),
+								 (DWORD)(segment_size & 0xffffffff),
+								 this->name.c_str());
+	if (mapping == NULL) return false;
+
+	ptr = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, segment_size);
+	if (ptr == NULL)
+	{
+		CloseHandle(mapping);
+		mapping = NULL;
+		return false;
+	}
+#else
+	// a segment left by a crashed writer, or still used by another one, is
+	// retired rather than reused: readers that map it see magic drop to 0
+	// and reattach by name, and its size never changes under them
+	retireSegment(this->name);
+
+	fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0) return false;
+
+	if (ftruncate(fd, segment_size) != 0)
+	{
+		::close(fd);
+		fd = -1;
+		shm_unlink(this->name.c_str());
+		return false;
+	}
+
+	ptr = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED)
+	{
+		::close(fd);
+		fd = -1;
+		shm_unlink(this->name.c_str());
+		return false;
+	}
+#endif
+
+	header = (Header*)ptr;
+	slots = (char*)ptr + sizeof(Header);
+
+	// invalidate the header first so readers never see a half-initialised
+	// segment
+	new (&header->magic) std::atomic<uint32_t>(0);
+
+	new (&header->head) std::atomic<uint64_t>(0);
+
+	for (size_t i = 0; i < num_slots; i++)
+	{
+		Slot* slot = (Slot*)(slots + i * (sizeof(Slot) + slot_size));
+		new (&slot->seq) std::atomic<uint64_t>(0);
+		new (&slot->size) std::atomic<uint32_t>(0);
+		slot->reserved = 0;
+	}
+
+	header->version = VERSION;
+	header->header_size = sizeof(Header);
+	header->num_slots = num_slots;
+	header->slot_size = slot_size;
+	header->slot_stride = sizeof(Slot) + slot_size;
+	header->reserved0 = 0;
+	for (int i = 0; i < 4; i++) header->reserved1[i] = 0;
+
+	// publishes the fields above to readers that load magic with acquire
+	header->magic.store(MAGIC, std::memory_order_release);
+
+	return true;
+}
+
+void ofxNatNetSharedMemory::close()
+{
+	if (header == NULL) return;
+
+	header->magic.store(0, std::memory_order_release);
+
+#ifdef _WIN32
+	UnmapViewOfFile(header);
+	CloseHandle(mapping);
+	mapping = NULL;
+#else
+	// unlinked only while the name is still ours, not a later writer's
+	struct stat own, current;
+	bool owned = fstat(fd, &own) == 0;
+	int current_fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (current_fd >= 0)
+	{
+		owned = owned && fstat(current_fd, &current) == 0 && current.st_dev == own.st_dev
+			&& current.st_ino == own.st_ino;
+		::close(current_fd);
+		if (owned) shm_unlink(name.c_str());
+	}
+
+	munmap(header, segment_size);
+	::close(fd);
+	fd = -1;
+#endif
+
+	header = NULL;
+	slots = NULL;
+	segment_size = 0;
+}
+
+bool ofxNatNetSharedMemory::write(const void* data, size_t size)
+{
+	if (header == NULL || size > header->slot_size) return false;
+
+	uint64_t n = header->head.load(std::memory_order_relaxed);
+	Slot* slot = (Slot*)(slots + (n % header->num_slots) * header->slot_stride);
+
+	slot->seq.store(2 * n + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	memcpy((char*)slot + sizeof(Slot), data, size);
+	slot->size.store(size, std::memory_order_relaxed);
+
+	slot->seq.store(2 * n + 2, std::memory_order_release);
+	header->head.store(n + 1, std::memory_order_release);
+
+	return true;
+}
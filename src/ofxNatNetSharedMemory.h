@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "ofxNatNetCompactFrame.h"
+
+// named shared-memory segment holding a ring of compact frames, written by
+// a single process and read by any number of others on the same host
+// (see ofxNatNetSharedMemoryReader for the consumer side).
+//
+// segment layout, all fields little-endian and naturally aligned:
+//   Header
+//   { Slot, char data[slot_size] } * num_slots
+//
+// a slot follows the same seqlock protocol as ofxNatNetFrameRing: seq is
+// 2n + 1 while frame n is written and 2n + 2 once it is complete. slot
+// data is an ofxNatNetCompactFrame, which carries its own version.
+//
+// compatibility: VERSION only changes when existing fields move or change
+// meaning; readers must refuse any other version. new fields are taken
+// from the reserved words, and header_size / slot_stride are always
+// honoured so readers never assume sizeof() of their own build. magic is
+// 0 while the writer initialises the segment, and once it is retired.
+//
+// a segment is never resized or reinitialised in place: create() clears
+// magic of any segment already under the name, unlinks it and creates a
+// new one, so readers of the old one reattach (see
+// ofxNatNetSharedMemoryReader). the last writer to create() a name owns it.
+
+class ofxNatNetSharedMemory
+{
+public:
+	enum
+	{
+		MAGIC = 0x4d534e4e,  // "NNSM"
+		VERSION = 1
+	};
+
+	struct Header
+	{
+		std::atomic<uint32_t> magic;  // stored with release, loaded with acquire
+		uint16_t version;
+		uint16_t header_size;
+		uint32_t num_slots;
+		uint32_t slot_size;  // payload bytes per slot, multiple of 8
+		uint32_t slot_stride;  // sizeof(Slot) + slot_size
+		uint32_t reserved0;
+		std::atomic<uint64_t> head;  // number of frames written
+		uint64_t reserved1[4];
+	};
+
+	struct Slot
+	{
+		std::atomic<uint64_t> seq;
+		std::atomic<uint32_t> size;
+		uint32_t reserved;
+	};
+
+	ofxNatNetSharedMemory();
+	~ofxNatNetSharedMemory() { close(); }
+
+	// creates the segment, retiring any left under name by a previous or
+	// crashed writer. name is a POSIX shm name; a leading '/' is added when
+	// missing.
+	bool create(const std::string& name, size_t num_slots, size_t slot_size);
+	void close();
+
+	inline bool isOpen() const { return header != NULL; }
+	inline const std::string& getName() const { return name; }
+
+	// single writer only. returns false when the frame does not fit a slot
+	bool write(const void* data, size_t size);
+
+	static size_t computeSegmentSize(size_t num_slots, size_t slot_size);
+
+private:
+	std::string name;
+	size_t segment_size;
+
+	Header* header;
+	char* slots;
+
+#ifdef _WIN32
+	void* mapping;
+#else
+	int fd;
+#endif
+
+	ofxNatNetSharedMemory(const ofxNatNetSharedMemory&);
+	ofxNatNetSharedMemory& operator=(const ofxNatNetSharedMemory&);
+};
@@ -0,0 +1,236 @@
+#include "ofxNatNetSharedMemoryReader.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+typedef ofxNatNetSharedMemory::Header Header;
+typedef ofxNatNetSharedMemory::Slot Slot;
+
+ofxNatNetSharedMemoryReader::ofxNatNetSharedMemoryReader()
+	: segment_size(0)
+	, header(NULL)
+	, slots(NULL)
+	, cursor(0)
+	, overruns(0)
+#ifdef _WIN32
+	, mapping(NULL)
+#else
+	, fd(-1)
+	, device(0)
+	, inode(0)
+#endif
+{
+}
+
+bool ofxNatNetSharedMemoryReader::open(const std::string& name)
+{
+	close();
+
+#ifdef _WIN32
+	this->name = name;
+#else
+	this->name = name.size() && name[0] == '/' ? name : "/" + name;
+#endif
+	overruns = 0;
+
+	return attach();
+}
+
+void ofxNatNetSharedMemoryReader::close()
+{
+	detach();
+	name.clear();
+}
+
+bool ofxNatNetSharedMemoryReader::attach()
+{
+	detach();
+
+	const void* ptr = NULL;
+
+#ifdef _WIN32
+	mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+	if (mapping == NULL) return false;
+
+	ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (ptr == NULL)
+	{
+		CloseHandle(mapping);
+		mapping = NULL;
+		return false;
+	}
+
+	MEMORY_BASIC_INFORMATION info;
+	VirtualQuery(ptr, &info, sizeof(info));
+	segment_size = info.RegionSize;
+#else
+	fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header))
+	{
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+	segment_size = st.st_size;
+	device = st.st_dev;
+	inode = st.st_ino;
+
+	ptr = mmap(NULL, segment_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED)
+	{
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+#endif
+
+	header = (const Header*)ptr;
+
+	bool valid = header->magic.load(std::memory_order_acquire) == ofxNatNetSharedMemory::MAGIC
+		&& header->version == ofxNatNetSharedMemory::VERSION
+		&& header->header_size >= sizeof(Header)
+		&& header->slot_stride >= sizeof(Slot) + header->slot_size
+		&& header->num_slots > 0
+		&& header->header_size + (uint64_t)header->num_slots * header->slot_stride <= segment_size;
+
+	if (!valid)
+	{
+		detach();
+		return false;
+	}
+
+	slots = (const char*)ptr + header->header_size;
+	cursor = header->head.load(std::memory_order_acquire);
+	last_replaced_check = std::chrono::steady_clock::now();
+
+	return true;
+}
+
+bool ofxNatNetSharedMemoryReader::update()
+{
+	if (header == NULL || header->magic.load(std::memory_order_acquire) != ofxNatNetSharedMemory::MAGIC
+		|| isReplaced())
+	{
+		// writer gone or restarting
+		if (name.empty() || !attach()) return false;
+	}
+	return true;
+}
+
+bool ofxNatNetSharedMemoryReader::isReplaced()
+{
+#ifdef _WIN32
+	// mappings live as long as a handle does, a new writer reuses ours
+	return false;
+#else
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - last_replaced_check < std::chrono::milliseconds(100)) return false;
+	last_replaced_check = now;
+
+	int current = shm_open(name.c_str(), O_RDONLY, 0);
+	if (current < 0) return false;  // unlinked, keep what is mapped
+
+	struct stat st;
+	bool replaced = fstat(current, &st) == 0 && ((uint64_t)st.st_dev != device || (uint64_t)st.st_ino != inode);
+	::close(current);
+	return replaced;
+#endif
+}
+
+void ofxNatNetSharedMemoryReader::detach()
+{
+	if (header == NULL) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile((void*)header);
+	CloseHandle(mapping);
+	mapping = NULL;
+#else
+	munmap((void*)header, segment_size);
+	::close(fd);
+	fd = -1;
+	device = 0;
+	inode = 0;
+#endif
+
+	header = NULL;
+	slots = NULL;
+	segment_size = 0;
+}
+
+bool ofxNatNetSharedMemoryReader::read(ofxNatNetCompactFrame& frame)
+{
+	if (!update()) return false;
+
+	const uint64_t num_slots = header->num_slots;
+
+	for (;;)
+	{
+		uint64_t head = header->head.load(std::memory_order_acquire);
+
+		if (head < cursor)
+		{
+			// the segment was recreated under the same mapping
+			cursor = head;
+			return false;
+		}
+		if (cursor == head) return false;
+
+		if (head - cursor > num_slots)
+		{
+			overruns += head - cursor - num_slots;
+			cursor = head - num_slots;
+		}
+
+		const Slot* slot = (const Slot*)(slots + (cursor % num_slots) * header->slot_stride);
+		const uint64_t seq = slot->seq.load(std::memory_order_acquire);
+
+		if (seq != 2 * cursor + 2)
+		{
+			overruns++;
+			cursor++;
+			continue;
+		}
+
+		size_t size = slot->size.load(std::memory_order_relaxed);
+		if (size > header->slot_size) size = header->slot_size;
+
+		frame.data.resize(size);
+		memcpy(frame.data.data(), (const char*)slot + sizeof(Slot), size);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot->seq.load(std::memory_order_relaxed) != seq)
+		{
+			overruns++;
+			cursor++;
+			continue;
+		}
+
+		cursor++;
+		return true;
+	}
+}
+
+bool ofxNatNetSharedMemoryReader::readLatest(ofxNatNetCompactFrame& frame)
+{
+	if (!update()) return false;
+
+	uint64_t head = header->head.load(std::memory_order_acquire);
+	if (head == 0) return false;
+
+	if (cursor < head) cursor = head - 1;
+
+	uint64_t skipped = overruns;
+	bool result = read(frame);
+	overruns = skipped;
+	return result;
+}
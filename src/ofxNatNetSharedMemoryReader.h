@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "ofxNatNetCompactFrame.h"
+#include "ofxNatNetSharedMemory.h"
+
+// consumer side of ofxNatNetSharedMemory. plain C++ with no openFrameworks
+// or Poco dependency, so it can be dropped into any tool on the same host.
+//
+//   ofxNatNetSharedMemoryReader reader;
+//   reader.open("ofxNatNet");
+//   ofxNatNetCompactFrame frame;
+//   while (reader.read(frame)) { ... }
+//
+// reading never blocks the writer. when the writer laps a reader the lost
+// frames are added to getNumOverruns(); when the writer restarts the
+// reader reattaches on the next call. a restart shows as magic dropping
+// to 0, or, checked every 100 ms, as the name leading to another segment
+// (a writer that crashed and never cleared its own).
+
+class ofxNatNetSharedMemoryReader
+{
+public:
+	ofxNatNetSharedMemoryReader();
+	~ofxNatNetSharedMemoryReader() { close(); }
+
+	bool open(const std::string& name);
+	void close();
+
+	inline bool isOpen() const { return header != NULL; }
+
+	// next frame in order, false when there is nothing new
+	bool read(ofxNatNetCompactFrame& frame);
+
+	// newest frame, skipping (and not counting) anything older
+	bool readLatest(ofxNatNetCompactFrame& frame);
+
+	inline uint64_t getNumOverruns() const { return overruns; }
+
+private:
+	std::string name;
+	size_t segment_size;
+
+	const ofxNatNetSharedMemory::Header* header;
+	const char* slots;
+
+	uint64_t cursor;
+	uint64_t overruns;
+
+#ifdef _WIN32
+	void* mapping;
+#else
+	int fd;
+	uint64_t device;
+	uint64_t inode;
+#endif
+	std::chrono::steady_clock::time_point last_replaced_check;
+
+	// attaches when detached or the writer restarted
+	bool update();
+	bool attach();
+	void detach();
+	bool isReplaced();
+
+	ofxNatNetSharedMemoryReader(const ofxNatNetSharedMemoryReader&);
+	ofxNatNetSharedMemoryReader& operator=(const ofxNatNetSharedMemoryReader&);
+};
@@ -0,0 +1,748 @@
+#include "ofxNatNetTake.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+using namespace ofxNatNetTake;
+
+typedef ofxNatNetCompactFrame CF;
+
+// varint / zigzag helpers
+
+static inline void putVarint(std::vector<uint8_t>& out, uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		out.push_back((uint8_t)(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((uint8_t)v);
+}
+
+static inline void putSigned(std::vector<uint8_t>& out, int64_t v)
+{
+	putVarint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static inline bool getVarint(const uint8_t*& ptr, const uint8_t* end, uint64_t& v)
+{
+	v = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (ptr >= end) return false;
+		uint8_t b = *ptr++;
+		v |= (uint64_t)(b & 0x7f) << shift;
+		if ((b & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+static inline bool getSigned(const uint8_t*& ptr, const uint8_t* end, int64_t& v)
+{
+	uint64_t u;
+	if (!getVarint(ptr, end, u)) return false;
+	v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+	return true;
+}
+
+static inline int32_t quantize(float v, float inv_step)
+{
+	double q = floor((double)v * inv_step + 0.5);
+	if (q > 2147483647.0) q = 2147483647.0;
+	if (q < -2147483647.0) q = -2147483647.0;
+	return (int32_t)q;
+}
+
+// timestamps are stored in whole microseconds, and compared that way
+static inline int64_t toMicros(double seconds) { return (int64_t)floor(seconds * 1e6 + 0.5); }
+
+static inline int64_t poseKey(int32_t skeleton_id, int32_t id, bool joint)
+{
+	if (!joint) return (int64_t)(uint32_t)id;
+	return ((int64_t)((uint32_t)skeleton_id + 1) << 32) | (uint32_t)id;
+}
+
+static bool seekTo(FILE* fp, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(fp, offset, SEEK_SET) == 0;
+#else
+	return fseeko(fp, offset, SEEK_SET) == 0;
+#endif
+}
+
+static uint64_t fileSize(FILE* fp)
+{
+#ifdef _WIN32
+	_fseeki64(fp, 0, SEEK_END);
+	return _ftelli64(fp);
+#else
+	fseeko(fp, 0, SEEK_END);
+	return ftello(fp);
+#endif
+}
+
+void State::reset()
+{
+	frame_number = 0;
+	timestamp_us = 0;
+	markers.clear();
+	poses.clear();
+}
+
+// pose entries
+
+static void encodePose(std::vector<uint8_t>& out, State& state, int64_t key,
+					   const CF::RigidBody& RB, float inv_step)
+{
+	Pose cur;
+	for (int i = 0; i < 3; i++) cur.position[i] = quantize(RB.position[i], inv_step);
+	for (int i = 0; i < 4; i++) cur.orientation[i] = quantize(RB.orientation[i], 32767);
+	cur.error = quantize(RB.mean_marker_error, inv_step);
+
+	std::pair<std::unordered_map<int64_t, Pose>::iterator, bool> r =
+		state.poses.insert(std::make_pair(key, Pose()));
+	Pose& prev = r.first->second;
+	if (r.second) memset(&prev, 0, sizeof(Pose));
+
+	for (int i = 0; i < 3; i++) putSigned(out, (int64_t)cur.position[i] - prev.position[i]);
+	for (int i = 0; i < 4; i++) putSigned(out, (int64_t)cur.orientation[i] - prev.orientation[i]);
+	putSigned(out, (int64_t)cur.error - prev.error);
+	putVarint(out, RB.flags);
+
+	prev = cur;
+}
+
+static bool decodePose(const uint8_t*& ptr, const uint8_t* end, State& state,
+					   int64_t key, CF::RigidBody& RB, float step)
+{
+	std::pair<std::unordered_map<int64_t, Pose>::iterator, bool> r =
+		state.poses.insert(std::make_pair(key, Pose()));
+	Pose& prev = r.first->second;
+	if (r.second) memset(&prev, 0, sizeof(Pose));
+
+	int64_t d;
+	for (int i = 0; i < 3; i++)
+	{
+		if (!getSigned(ptr, end, d)) return false;
+		prev.position[i] += (int32_t)d;
+		RB.position[i] = prev.position[i] * step;
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		if (!getSigned(ptr, end, d)) return false;
+		prev.orientation[i] += (int32_t)d;
+		RB.orientation[i] = prev.orientation[i] / 32767.f;
+	}
+	if (!getSigned(ptr, end, d)) return false;
+	prev.error += (int32_t)d;
+	RB.mean_marker_error = prev.error * step;
+
+	uint64_t flags;
+	if (!getVarint(ptr, end, flags)) return false;
+	RB.flags = (uint32_t)flags;
+
+	return true;
+}
+
+// writer
+
+ofxNatNetTakeWriter::ofxNatNetTakeWriter()
+	: fp(NULL)
+	, offset(0)
+	, num_frames(0)
+	, position_step(0.0001)
+	, frames_per_block(240)
+{
+	memset(&block_header, 0, sizeof(block_header));
+}
+
+bool ofxNatNetTakeWriter::open(const std::string& path, float position_step,
+							   size_t frames_per_block)
+{
+	close();
+
+	if (position_step <= 0 || frames_per_block == 0) return false;
+
+	fp = fopen(path.c_str(), "wb");
+	if (fp == NULL) return false;
+
+	this->position_step = position_step;
+	this->frames_per_block = frames_per_block;
+
+	FileHeader h;
+	memset(&h, 0, sizeof(h));
+	h.magic = FILE_MAGIC;
+	h.version = VERSION;
+	h.header_size = sizeof(FileHeader);
+	h.position_step = position_step;
+	h.frames_per_block = frames_per_block;
+
+	if (fwrite(&h, sizeof(h), 1, fp) != 1)
+	{
+		fclose(fp);
+		fp = NULL;
+		return false;
+	}
+
+	offset = sizeof(h);
+	num_frames = 0;
+	index.clear();
+	block.clear();
+	block_header.num_frames = 0;
+
+	return true;
+}
+
+void ofxNatNetTakeWriter::close()
+{
+	if (fp == NULL) return;
+
+	flushBlock();
+
+	Footer footer;
+	footer.index_offset = offset;
+	footer.num_blocks = index.size();
+	footer.magic = INDEX_MAGIC;
+
+	if (index.size()) fwrite(index.data(), sizeof(IndexEntry), index.size(), fp);
+	fwrite(&footer, sizeof(footer), 1, fp);
+
+	fclose(fp);
+	fp = NULL;
+}
+
+bool ofxNatNetTakeWriter::write(const ofxNatNetCompactFrame& frame)
+{
+	if (fp == NULL || !frame.isValid()) return false;
+
+	const CF::Header& h = frame.getHeader();
+	const float inv_step = 1.0 / position_step;
+	const int64_t timestamp_us = toMicros(h.timestamp);
+
+	if (block_header.num_frames == 0)
+	{
+		state.reset();
+		block.clear();
+
+		block_header.first_frame_number = h.frame_number;
+		block_header.first_timestamp = h.timestamp;
+	}
+
+	block_header.last_frame_number = h.frame_number;
+	block_header.last_timestamp = h.timestamp;
+	block_header.num_frames++;
+
+	putSigned(block, (int64_t)h.frame_number - state.frame_number);
+	putSigned(block, timestamp_us - state.timestamp_us);
+	state.frame_number = h.frame_number;
+	state.timestamp_us = timestamp_us;
+
+	size_t n = block.size();
+	block.resize(n + 4);
+	memcpy(&block[n], &h.latency, 4);
+
+	putVarint(block, h.timecode);
+	putVarint(block, h.timecode_sub);
+	putVarint(block, h.flags);
+
+	const uint32_t num_markers = h.num_markers + h.num_filterd_markers + h.num_markerset_markers;
+
+	putVarint(block, h.num_markers);
+	putVarint(block, h.num_filterd_markers);
+	putVarint(block, h.num_markerset_markers);
+	putVarint(block, h.num_markersets);
+	putVarint(block, h.num_rigidbodies);
+	putVarint(block, h.num_skeletons);
+	putVarint(block, h.num_joints);
+
+	// markers, against the same index in the previous frame
+	const CF::Marker* markers = frame.getMarkers();
+	const size_t num_prev = state.markers.size() / 3;
+	state.markers.resize(num_markers * 3);
+
+	for (uint32_t i = 0; i < num_markers; i++)
+	{
+		const float* p = &markers[i].x;
+		for (int k = 0; k < 3; k++)
+		{
+			int32_t q = quantize(p[k], inv_step);
+			int32_t prev = i < num_prev ? state.markers[i * 3 + k] : 0;
+			putSigned(block, (int64_t)q - prev);
+			state.markers[i * 3 + k] = q;
+		}
+	}
+
+	const CF::MarkerSet* markersets = frame.getMarkerSets();
+	for (uint32_t i = 0; i < h.num_markersets; i++)
+		putVarint(block, markersets[i].num_markers);
+
+	int32_t prev_id = 0;
+
+	const CF::RigidBody* rigidbodies = frame.getRigidBodies();
+	for (uint32_t i = 0; i < h.num_rigidbodies; i++)
+	{
+		const CF::RigidBody& RB = rigidbodies[i];
+		putSigned(block, (int64_t)RB.id - prev_id);
+		prev_id = RB.id;
+		encodePose(block, state, poseKey(0, RB.id, false), RB, inv_step);
+	}
+
+	const CF::Skeleton* skeletons = frame.getSkeletons();
+	const CF::RigidBody* joints = frame.getJoints();
+	prev_id = 0;
+
+	for (uint32_t i = 0; i < h.num_skeletons; i++)
+	{
+		const CF::Skeleton& S = skeletons[i];
+		putSigned(block, (int64_t)S.id - prev_id);
+		putVarint(block, S.num_joints);
+		prev_id = S.id;
+
+		int32_t prev_joint_id = 0;
+		for (uint32_t j = 0; j < S.num_joints; j++)
+		{
+			const CF::RigidBody& RB = joints[S.first_joint + j];
+			putSigned(block, (int64_t)RB.id - prev_joint_id);
+			prev_joint_id = RB.id;
+			encodePose(block, state, poseKey(S.id, RB.id, true), RB, inv_step);
+		}
+	}
+
+	num_frames++;
+
+	if (block_header.num_frames >= frames_per_block) return flushBlock();
+	return true;
+}
+
+bool ofxNatNetTakeWriter::flushBlock()
+{
+	if (block_header.num_frames == 0) return true;
+
+	block_header.magic = BLOCK_MAGIC;
+	block_header.payload_size = block.size();
+	block_header.reserved = 0;
+
+	IndexEntry entry;
+	entry.offset = offset;
+	entry.first_frame_number = block_header.first_frame_number;
+	entry.last_frame_number = block_header.last_frame_number;
+	entry.first_timestamp = block_header.first_timestamp;
+	entry.last_timestamp = block_header.last_timestamp;
+	entry.num_frames = block_header.num_frames;
+	entry.reserved = 0;
+
+	bool ok = fwrite(&block_header, sizeof(block_header), 1, fp) == 1
+		&& (block.empty() || fwrite(block.data(), block.size(), 1, fp) == 1);
+
+	if (ok)
+	{
+		index.push_back(entry);
+		offset += sizeof(block_header) + block.size();
+	}
+
+	block_header.num_frames = 0;
+	block.clear();
+
+	return ok;
+}
+
+// reader
+
+ofxNatNetTakeReader::ofxNatNetTakeReader()
+	: fp(NULL)
+	, block_index(0)
+	, block_ptr(NULL)
+	, block_frames_left(0)
+	, has_pending(false)
+{
+	memset(&file_header, 0, sizeof(file_header));
+}
+
+bool ofxNatNetTakeReader::open(const std::string& path)
+{
+	close();
+
+	fp = fopen(path.c_str(), "rb");
+	if (fp == NULL) return false;
+
+	if (fread(&file_header, sizeof(file_header), 1, fp) != 1
+		|| file_header.magic != FILE_MAGIC || file_header.version != VERSION
+		|| file_header.header_size < sizeof(FileHeader)
+		|| !(file_header.position_step > 0)
+		|| !buildIndex())
+	{
+		close();
+		return false;
+	}
+
+	block_index = 0;
+	block_frames_left = 0;
+	has_pending = false;
+
+	return true;
+}
+
+void ofxNatNetTakeReader::close()
+{
+	if (fp) fclose(fp);
+	fp = NULL;
+
+	index.clear();
+	block.clear();
+	block_ptr = NULL;
+	block_frames_left = 0;
+	has_pending = false;
+}
+
+bool ofxNatNetTakeReader::buildIndex()
+{
+	index.clear();
+
+	const uint64_t size = fileSize(fp);
+
+	// index written by close()
+	Footer footer;
+	if (size >= file_header.header_size + sizeof(Footer)
+		&& seekTo(fp, size - sizeof(Footer))
+		&& fread(&footer, sizeof(footer), 1, fp) == 1
+		&& footer.magic == INDEX_MAGIC
+		&& footer.index_offset + (uint64_t)footer.num_blocks * sizeof(IndexEntry) + sizeof(Footer) == size)
+	{
+		index.resize(footer.num_blocks);
+		if (index.empty()) return true;
+		if (seekTo(fp, footer.index_offset)
+			&& fread(index.data(), sizeof(IndexEntry), index.size(), fp) == index.size())
+			return true;
+	}
+
+	// interrupted recording, walk the blocks
+	index.clear();
+
+	uint64_t offset = file_header.header_size;
+	BlockHeader bh;
+
+	while (offset + sizeof(BlockHeader) <= size && seekTo(fp, offset)
+		   && fread(&bh, sizeof(bh), 1, fp) == 1 && bh.magic == BLOCK_MAGIC
+		   && offset + sizeof(bh) + bh.payload_size <= size)
+	{
+		IndexEntry entry;
+		entry.offset = offset;
+		entry.first_frame_number = bh.first_frame_number;
+		entry.last_frame_number = bh.last_frame_number;
+		entry.first_timestamp = bh.first_timestamp;
+		entry.last_timestamp = bh.last_timestamp;
+		entry.num_frames = bh.num_frames;
+		entry.reserved = 0;
+		index.push_back(entry);
+
+		offset += sizeof(bh) + bh.payload_size;
+	}
+
+	return true;
+}
+
+size_t ofxNatNetTakeReader::getNumFrames() const
+{
+	size_t n = 0;
+	for (size_t i = 0; i < index.size(); i++) n += index[i].num_frames;
+	return n;
+}
+
+int ofxNatNetTakeReader::getFirstFrameNumber() const
+{
+	return index.empty() ? 0 : index.front().first_frame_number;
+}
+
+int ofxNatNetTakeReader::getLastFrameNumber() const
+{
+	return index.empty() ? 0 : index.back().last_frame_number;
+}
+
+double ofxNatNetTakeReader::getStartTime() const
+{
+	return index.empty() ? 0 : index.front().first_timestamp;
+}
+
+double ofxNatNetTakeReader::getEndTime() const
+{
+	return index.empty() ? 0 : index.back().last_timestamp;
+}
+
+bool ofxNatNetTakeReader::loadBlock(size_t i)
+{
+	block_index = i + 1;
+	block_frames_left = 0;
+
+	BlockHeader bh;
+	if (!seekTo(fp, index[i].offset) || fread(&bh, sizeof(bh), 1, fp) != 1
+		|| bh.magic != BLOCK_MAGIC)
+		return false;
+
+	block.resize(bh.payload_size);
+	if (bh.payload_size && fread(block.data(), bh.payload_size, 1, fp) != 1)
+		return false;
+
+	block_ptr = block.data();
+	block_frames_left = bh.num_frames;
+	state.reset();
+
+	return true;
+}
+
+bool ofxNatNetTakeReader::decodeFrame(ofxNatNetCompactFrame& frame)
+{
+	const uint8_t* ptr = block_ptr;
+	const uint8_t* end = block.data() + block.size();
+	const float step = file_header.position_step;
+
+	int64_t d;
+	uint64_t v;
+
+	if (!getSigned(ptr, end, d)) return false;
+	state.frame_number += (int32_t)d;
+	if (!getSigned(ptr, end, d)) return false;
+	state.timestamp_us += d;
+
+	if (end - ptr < 4) return false;
+	float latency;
+	memcpy(&latency, ptr, 4);
+	ptr += 4;
+
+	uint64_t counts[10];
+	for (int i = 0; i < 10; i++)
+	{
+		if (!getVarint(ptr, end, counts[i]) || counts[i] > 0xffffffff) return false;
+	}
+
+	CF::Header h;
+	memset(&h, 0, sizeof(h));
+	h.magic = CF::MAGIC;
+	h.version = CF::VERSION;
+	h.header_size = sizeof(CF::Header);
+	h.frame_number = state.frame_number;
+	h.timestamp = state.timestamp_us * 1e-6;
+	h.latency = latency;
+	h.timecode = counts[0];
+	h.timecode_sub = counts[1];
+	h.flags = counts[2];
+	h.num_markers = counts[3];
+	h.num_filterd_markers = counts[4];
+	h.num_markerset_markers = counts[5];
+	h.num_markersets = counts[6];
+	h.num_rigidbodies = counts[7];
+	h.num_skeletons = counts[8];
+	h.num_joints = counts[9];
+
+	const uint64_t num_markers = counts[3] + counts[4] + counts[5];
+
+	// every entry takes at least one byte per field, so anything larger
+	// than the rest of the block is corrupt
+	if (num_markers * 3 + counts[6] + (counts[7] + counts[9]) * 10 + counts[8] * 2
+		> (uint64_t)(end - ptr))
+		return false;
+
+	h.size = CF::computeSize(num_markers, h.num_markersets, h.num_rigidbodies,
+							 h.num_skeletons, h.num_joints);
+
+	frame.data.resize(h.size);
+	memcpy(frame.data.data(), &h, sizeof(h));
+
+	CF::Marker* markers = (CF::Marker*)(frame.data.data() + sizeof(CF::Header));
+	const size_t num_prev = state.markers.size() / 3;
+	state.markers.resize(num_markers * 3);
+
+	for (uint64_t i = 0; i < num_markers; i++)
+	{
+		float* p = &markers[i].x;
+		for (int k = 0; k < 3; k++)
+		{
+			if (!getSigned(ptr, end, d)) return false;
+			int32_t prev = i < num_prev ? state.markers[i * 3 + k] : 0;
+			int32_t q = prev + (int32_t)d;
+			state.markers[i * 3 + k] = q;
+			p[k] = q * step;
+		}
+	}
+
+	CF::MarkerSet* markersets = (CF::MarkerSet*)(markers + num_markers);
+	uint32_t first_marker = 0;
+	for (uint32_t i = 0; i < h.num_markersets; i++)
+	{
+		if (!getVarint(ptr, end, v)) return false;
+		markersets[i].first_marker = first_marker;
+		markersets[i].num_markers = v;
+		first_marker += v;
+	}
+	if (first_marker != h.num_markerset_markers) return false;
+
+	CF::RigidBody* rigidbodies = (CF::RigidBody*)(markersets + h.num_markersets);
+	int32_t prev_id = 0;
+
+	for (uint32_t i = 0; i < h.num_rigidbodies; i++)
+	{
+		CF::RigidBody& RB = rigidbodies[i];
+		if (!getSigned(ptr, end, d)) return false;
+		RB.id = prev_id + (int32_t)d;
+		prev_id = RB.id;
+		if (!decodePose(ptr, end, state, poseKey(0, RB.id, false), RB, step)) return false;
+	}
+
+	CF::Skeleton* skeletons = (CF::Skeleton*)(rigidbodies + h.num_rigidbodies);
+	CF::RigidBody* joints = (CF::RigidBody*)(skeletons + h.num_skeletons);
+	uint32_t first_joint = 0;
+	prev_id = 0;
+
+	for (uint32_t i = 0; i < h.num_skeletons; i++)
+	{
+		CF::Skeleton& S = skeletons[i];
+		if (!getSigned(ptr, end, d) || !getVarint(ptr, end, v)) return false;
+		S.id = prev_id + (int32_t)d;
+		prev_id = S.id;
+
+		if (first_joint + v > h.num_joints) return false;
+		S.first_joint = first_joint;
+		S.num_joints = v;
+
+		int32_t prev_joint_id = 0;
+		for (uint32_t j = 0; j < S.num_joints; j++)
+		{
+			CF::RigidBody& RB = joints[first_joint + j];
+			if (!getSigned(ptr, end, d)) return false;
+			RB.id = prev_joint_id + (int32_t)d;
+			prev_joint_id = RB.id;
+			if (!decodePose(ptr, end, state, poseKey(S.id, RB.id, true), RB, step)) return false;
+		}
+
+		first_joint += S.num_joints;
+	}
+	if (first_joint != h.num_joints) return false;
+
+	block_ptr = ptr;
+	block_frames_left--;
+
+	return true;
+}
+
+bool ofxNatNetTakeReader::read(ofxNatNetCompactFrame& frame)
+{
+	if (fp == NULL) return false;
+
+	if (has_pending)
+	{
+		frame.data.swap(pending.data);
+		has_pending = false;
+		return true;
+	}
+
+	while (block_frames_left == 0)
+	{
+		if (block_index >= index.size()) return false;
+		loadBlock(block_index);
+	}
+
+	if (!decodeFrame(frame))
+	{
+		// skip the rest of a corrupt block
+		block_frames_left = 0;
+		return read(frame);
+	}
+
+	return true;
+}
+
+static bool compareLastFrameNumber(const IndexEntry& e, int frame_number)
+{
+	return e.last_frame_number < frame_number;
+}
+
+static bool compareLastTimestamp(const IndexEntry& e, int64_t timestamp_us)
+{
+	return toMicros(e.last_timestamp) < timestamp_us;
+}
+
+bool ofxNatNetTakeReader::seekToFrameNumber(int frame_number)
+{
+	if (fp == NULL) return false;
+
+	has_pending = false;
+
+	size_t i = std::lower_bound(index.begin(), index.end(), frame_number,
+								compareLastFrameNumber) - index.begin();
+	if (i >= index.size() || !loadBlock(i))
+	{
+		block_index = index.size();
+		block_frames_left = 0;
+		return false;
+	}
+
+	while (read(pending))
+	{
+		if (pending.getHeader().frame_number >= frame_number)
+		{
+			has_pending = true;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ofxNatNetTakeReader::seekToTime(double timestamp)
+{
+	if (fp == NULL) return false;
+
+	has_pending = false;
+
+	// in stored precision: a frame read back can be up to half a
+	// microsecond off the timestamp it was recorded with
+	const int64_t timestamp_us = toMicros(timestamp);
+
+	size_t i = std::lower_bound(index.begin(), index.end(), timestamp_us,
+								compareLastTimestamp) - index.begin();
+	if (i >= index.size() || !loadBlock(i))
+	{
+		block_index = index.size();
+		block_frames_left = 0;
+		return false;
+	}
+
+	while (read(pending))
+	{
+		if (toMicros(pending.getHeader().timestamp) >= timestamp_us)
+		{
+			has_pending = true;
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t ofxNatNetTakeReader::readRange(double t0, double t1,
+									  std::vector<ofxNatNetCompactFrame>& frames)
+{
+	size_t n = 0;
+	const int64_t t1_us = toMicros(t1);
+
+	if (seekToTime(t0))
+	{
+		for (;;)
+		{
+			if (n >= frames.size()) frames.resize(n + 1);
+			if (!read(frames[n])) break;
+
+			if (toMicros(frames[n].getHeader().timestamp) > t1_us)
+			{
+				// keep it for the next read()
+				pending.data.swap(frames[n].data);
+				has_pending = true;
+				break;
+			}
+			n++;
+		}
+	}
+
+	frames.resize(n);
+	return n;
+}
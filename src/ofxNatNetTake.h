@@ -0,0 +1,201 @@
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ofxNatNetCompactFrame.h"
+
+// compact on-disk recording of ofxNatNetCompactFrame streams.
+//
+// positions are quantized to a fixed step (position_step, in the units of
+// the stream after ofxNatNet's transform) and quaternion components to
+// 1 / 32767. every value is written as a zigzag varint delta against the
+// same entity in the previous frame: rigid bodies by id, joints by
+// skeleton / joint id, markers by index. frames are grouped in blocks
+// that start from an empty state, so each block decodes on its own.
+//
+// file layout:
+//   FileHeader
+//   { BlockHeader, payload } * num_blocks
+//   IndexEntry[num_blocks]
+//   Footer
+//
+// the index maps frame numbers and timestamps to block offsets, so a
+// reader only touches the blocks covering the range it asks for. a file
+// without a footer (recording interrupted) is indexed by walking the
+// block headers instead.
+//
+// recording from a live ofxNatNet, on a thread of your own:
+//
+//   natnet.setFrameHistorySize(512);
+//   ofxNatNetFrameRing::Reader reader = natnet.createFrameReader();
+//   ofxNatNetTakeWriter take;
+//   take.open("take.nntk");
+//   ofxNatNetCompactFrame frame;
+//   while (reader.read(frame)) take.write(frame);
+
+namespace ofxNatNetTake
+{
+	enum
+	{
+		FILE_MAGIC = 0x4b544e4e,  // "NNTK"
+		BLOCK_MAGIC = 0x4b424e4e,  // "NNBK"
+		INDEX_MAGIC = 0x49544e4e,  // "NNTI"
+		VERSION = 1
+	};
+
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint16_t version;
+		uint16_t header_size;
+		float position_step;
+		uint32_t frames_per_block;
+		uint32_t reserved[2];
+	};
+
+	struct BlockHeader
+	{
+		uint32_t magic;
+		uint32_t num_frames;
+		uint32_t payload_size;
+		int32_t first_frame_number;
+		int32_t last_frame_number;
+		uint32_t reserved;
+		double first_timestamp;
+		double last_timestamp;
+	};
+
+	struct IndexEntry
+	{
+		uint64_t offset;  // of the BlockHeader
+		int32_t first_frame_number;
+		int32_t last_frame_number;
+		double first_timestamp;
+		double last_timestamp;
+		uint32_t num_frames;
+		uint32_t reserved;
+	};
+
+	struct Footer
+	{
+		uint64_t index_offset;
+		uint32_t num_blocks;
+		uint32_t magic;
+	};
+
+	// delta state shared by the encoder and the decoder
+	struct Pose
+	{
+		int32_t position[3];
+		int32_t orientation[4];
+		int32_t error;
+	};
+
+	struct State
+	{
+		int32_t frame_number;
+		int64_t timestamp_us;
+		std::vector<int32_t> markers;
+		std::unordered_map<int64_t, Pose> poses;
+
+		void reset();
+	};
+}
+
+class ofxNatNetTakeWriter
+{
+public:
+	ofxNatNetTakeWriter();
+	~ofxNatNetTakeWriter() { close(); }
+
+	// position_step: quantization step for positions and marker errors
+	bool open(const std::string& path, float position_step = 0.0001,
+			  size_t frames_per_block = 240);
+
+	// flushes the last block and writes the index
+	void close();
+
+	inline bool isOpen() const { return fp != NULL; }
+
+	bool write(const ofxNatNetCompactFrame& frame);
+
+	inline size_t getNumFrames() const { return num_frames; }
+	inline uint64_t getNumBytesWritten() const { return offset; }
+
+private:
+	FILE* fp;
+	uint64_t offset;
+	size_t num_frames;
+
+	float position_step;
+	size_t frames_per_block;
+
+	std::vector<uint8_t> block;
+	ofxNatNetTake::BlockHeader block_header;
+	ofxNatNetTake::State state;
+
+	std::vector<ofxNatNetTake::IndexEntry> index;
+
+	bool flushBlock();
+
+	ofxNatNetTakeWriter(const ofxNatNetTakeWriter&);
+	ofxNatNetTakeWriter& operator=(const ofxNatNetTakeWriter&);
+};
+
+class ofxNatNetTakeReader
+{
+public:
+	ofxNatNetTakeReader();
+	~ofxNatNetTakeReader() { close(); }
+
+	bool open(const std::string& path);
+	void close();
+
+	inline bool isOpen() const { return fp != NULL; }
+
+	inline size_t getNumBlocks() const { return index.size(); }
+	size_t getNumFrames() const;
+
+	int getFirstFrameNumber() const;
+	int getLastFrameNumber() const;
+	double getStartTime() const;
+	double getEndTime() const;
+
+	// position the reader so the next read() returns the first frame with
+	// a frame number (timestamp) not smaller than the argument. only the
+	// block containing it is loaded. timestamps compare in whole
+	// microseconds, the precision they are stored in.
+	bool seekToFrameNumber(int frame_number);
+	bool seekToTime(double timestamp);
+
+	// next frame in file order, false at the end of the take
+	bool read(ofxNatNetCompactFrame& frame);
+
+	// decodes [t0, t1] into frames, reusing its elements
+	size_t readRange(double t0, double t1, std::vector<ofxNatNetCompactFrame>& frames);
+
+private:
+	FILE* fp;
+	ofxNatNetTake::FileHeader file_header;
+	std::vector<ofxNatNetTake::IndexEntry> index;
+
+	size_t block_index;  // next block to load
+	std::vector<uint8_t> block;
+	const uint8_t* block_ptr;
+	uint32_t block_frames_left;
+
+	ofxNatNetTake::State state;
+
+	bool has_pending;
+	ofxNatNetCompactFrame pending;
+
+	bool buildIndex();
+	bool loadBlock(size_t i);
+	bool decodeFrame(ofxNatNetCompactFrame& frame);
+
+	ofxNatNetTakeReader(const ofxNatNetTakeReader&);
+	ofxNatNetTakeReader& operator=(const ofxNatNetTakeReader&);
+};
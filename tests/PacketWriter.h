@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string.h>
+
+#include <vector>
+
+#include "natnet/Parser.h"
+
+// builds NatNet packets field by field for the tests. the caller writes
+// the fields in the order of the protocol version under test.
+//
+//   PacketWriter w(NAT_FRAMEOFDATA);
+//   w.write((int)frame_number);
+//   ...
+//   size_t size = w.finish();
+//   client.decodePacket(w.data.data(), size);
+
+class PacketWriter
+{
+public:
+	std::vector<char> data;
+
+	explicit PacketWriter(int message_id)
+	{
+		write((short)message_id);
+		write((short)0);  // payload size, patched by finish()
+	}
+
+	template <typename T>
+	void write(T value)
+	{
+		size_t n = data.size();
+		data.resize(n + sizeof(T));
+		memcpy(&data[n], &value, sizeof(T));
+	}
+
+	void writeVec3(float x, float y, float z)
+	{
+		write(x);
+		write(y);
+		write(z);
+	}
+
+	void writeString(const char* s) { data.insert(data.end(), s, s + strlen(s) + 1); }
+
+	// placeholder for a 4.1 byte count of what follows it, patched by
+	// endSize() with the bytes written in between
+	size_t beginSize()
+	{
+		write((int)0);
+		return data.size();
+	}
+
+	void endSize(size_t begin)
+	{
+		int bytes = data.size() - begin;
+		memcpy(&data[begin - sizeof(int)], &bytes, sizeof(bytes));
+	}
+
+	// patches the payload size and returns the datagram length. data is
+	// zero-padded to a full packet buffer, as the parser expects
+	size_t finish()
+	{
+		size_t size = data.size();
+		short payload = size - 4;
+		memcpy(&data[2], &payload, sizeof(payload));
+		data.resize(NatNet::Parser::PACKET_BUFFER_SIZE, 0);
+		return size;
+	}
+};
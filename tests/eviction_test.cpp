@@ -0,0 +1,215 @@
+// eviction_test: NatNet::Client::Eviction of rigid bodies and skeletons
+// that leave the stream
+//
+// usage: eviction_test
+//
+// decodes 3.0 frames offline in which bodies disappear and reappear, and
+// checks the state's entries against the unseen frames policy, against
+// the max_bytes budget (least recently seen first, the current frame's
+// ids kept) and after frame numbers go back, which restarts the count.
+
+#include "natnet/Client.h"
+#include "PacketWriter.h"
+
+#include <stdio.h>
+
+#include <vector>
+
+using namespace std;
+using namespace NatNet;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "FAILED: %s\n", what);
+	failures++;
+}
+
+// 3.0 rigid body, at (id, frame_number, 0)
+static void writeRigidBody(PacketWriter& w, int id, int frame_number)
+{
+	w.write(id);
+	w.writeVec3(id, frame_number, 0);
+	w.write(0.0f);  // orientation
+	w.write(0.0f);
+	w.write(0.0f);
+	w.write(1.0f);
+	w.write(0.001f);    // mean error
+	w.write((short)1);  // tracked
+}
+
+static void decodeFrame(Client& client, int frame_number, const vector<int>& rigidbodies,
+						const vector<int>& skeletons = vector<int>())
+{
+	PacketWriter w(NAT_FRAMEOFDATA);
+	w.write(frame_number);
+
+	w.write((int)0);  // marker sets
+	w.write((int)0);  // unlabeled markers
+
+	w.write((int)rigidbodies.size());
+	for (int i = 0; i < rigidbodies.size(); i++) writeRigidBody(w, rigidbodies[i], frame_number);
+
+	// two joints each
+	w.write((int)skeletons.size());
+	for (int i = 0; i < skeletons.size(); i++)
+	{
+		w.write(skeletons[i]);
+		w.write((int)2);
+		writeRigidBody(w, (skeletons[i] << 16) | 1, frame_number);
+		writeRigidBody(w, (skeletons[i] << 16) | 2, frame_number);
+	}
+
+	w.write((int)0);  // labeled markers
+	w.write((int)0);  // force plates
+	w.write((int)0);  // devices
+
+	w.write((unsigned int)0);  // timecode
+	w.write((unsigned int)0);
+	w.write(0.0);  // timestamp
+	w.write((uint64_t)0);
+	w.write((uint64_t)0);
+	w.write((uint64_t)0);
+	w.write((short)0);  // params
+	w.write((int)0);    // end of data
+
+	size_t size = w.finish();
+	check(client.decodePacket(w.data.data(), size), "frame decoded");
+}
+
+static vector<int> ids(int a = -1, int b = -1, int c = -1)
+{
+	vector<int> v;
+	if (a >= 0) v.push_back(a);
+	if (b >= 0) v.push_back(b);
+	if (c >= 0) v.push_back(c);
+	return v;
+}
+
+static bool hasRigidBody(Client& client, int id)
+{
+	client.lock();
+	bool found = client.getState().rigidbodies.count(id) && client.getState().rigidbody_info.count(id);
+	client.unlock();
+	return found;
+}
+
+static bool hasSkeleton(Client& client, int id)
+{
+	client.lock();
+	bool found = client.getState().skeletons.count(id) && client.getState().skeleton_info.count(id);
+	client.unlock();
+	return found;
+}
+
+// frame number the stored pose of a rigid body was streamed in
+static int poseFrame(Client& client, int id)
+{
+	client.lock();
+	const map<int, RigidBody>& rigidbodies = client.getState().rigidbodies;
+	int frame_number = rigidbodies.count(id) ? (int)rigidbodies.find(id)->second.raw_position.y : -1;
+	client.unlock();
+	return frame_number;
+}
+
+static void testUnseenFrames()
+{
+	Client client;
+	client.setupOffline(3, 0);
+
+	Client::Eviction eviction;
+	eviction.max_unseen_frames = 3;
+	client.setEviction(eviction);
+
+	decodeFrame(client, 1, ids(1, 2, 3), ids(10));
+	decodeFrame(client, 2, ids(1, 2));
+	decodeFrame(client, 3, ids(1));
+	check(hasRigidBody(client, 3) && hasSkeleton(client, 10), "unseen: kept for fewer frames");
+
+	decodeFrame(client, 4, ids(1));
+	check(!hasRigidBody(client, 3), "unseen: rigid body evicted after max_unseen_frames");
+	check(!hasSkeleton(client, 10), "unseen: skeleton evicted after max_unseen_frames");
+	check(hasRigidBody(client, 2), "unseen: seen later, kept");
+	check(client.getFootprint().num_evicted == 2, "unseen: evictions counted");
+
+	// back with a new pose, while 2 goes
+	decodeFrame(client, 5, ids(1, 3));
+	check(hasRigidBody(client, 3) && poseFrame(client, 3) == 5, "unseen: reappearing body stored again");
+	check(!hasRigidBody(client, 2), "unseen: next one evicted");
+
+	Client::Footprint footprint = client.getFootprint();
+	check(footprint.num_rigidbodies == 2 && footprint.num_skeletons == 0 && footprint.num_evicted == 3,
+		  "unseen: footprint counts");
+
+	// take looped: 3 counts from the new frame 0, not from 5
+	decodeFrame(client, 0, ids(1));
+	check(hasRigidBody(client, 3), "rewind: not evicted on the jump back");
+	decodeFrame(client, 1, ids(1));
+	decodeFrame(client, 2, ids(1));
+	check(hasRigidBody(client, 3), "rewind: kept for fewer frames");
+	decodeFrame(client, 3, ids(1));
+	check(!hasRigidBody(client, 3), "rewind: evicted counting from the jump back");
+	check(hasRigidBody(client, 1) && poseFrame(client, 1) == 3, "rewind: streamed body kept");
+
+	// 0 never evicts
+	client.setEviction(Client::Eviction());
+	decodeFrame(client, 4, ids(4));
+	decodeFrame(client, 1000, ids(5));
+	check(hasRigidBody(client, 1) && hasRigidBody(client, 4), "unseen: 0 keeps everything");
+}
+
+static void testMaxBytes()
+{
+	Client client;
+	client.setupOffline(3, 0);
+
+	// sizes of one skeleton and one rigid body, as accounted
+	decodeFrame(client, 1, ids(), ids(1));
+	size_t skeleton_bytes = client.getFootprint().bytes;
+	decodeFrame(client, 2, ids(1));
+	size_t rigidbody_bytes = client.getFootprint().bytes - skeleton_bytes;
+	check(rigidbody_bytes > 0 && skeleton_bytes >= rigidbody_bytes, "max_bytes: sizes accounted");
+
+	Client::Eviction eviction;
+	eviction.max_bytes = skeleton_bytes + 2 * rigidbody_bytes;
+	client.setEviction(eviction);
+
+	decodeFrame(client, 3, ids(2));
+	check(hasSkeleton(client, 1) && hasRigidBody(client, 1) && hasRigidBody(client, 2), "max_bytes: within budget");
+
+	// over budget: the skeleton was seen least recently, and shares its
+	// id with a rigid body that stays
+	decodeFrame(client, 4, ids(3));
+	check(!hasSkeleton(client, 1), "max_bytes: least recently seen evicted");
+	check(hasRigidBody(client, 1) && hasRigidBody(client, 2) && hasRigidBody(client, 3),
+		  "max_bytes: the rest kept");
+
+	// 1 seen again, so 2 is now the oldest
+	decodeFrame(client, 5, ids(1, 4));
+	check(!hasRigidBody(client, 2), "max_bytes: oldest evicted");
+	check(hasRigidBody(client, 1) && hasRigidBody(client, 3) && hasRigidBody(client, 4),
+		  "max_bytes: recently seen kept");
+
+	Client::Footprint footprint = client.getFootprint();
+	check(footprint.bytes <= eviction.max_bytes, "max_bytes: footprint within budget");
+	check(footprint.bytes == 3 * rigidbody_bytes, "max_bytes: bytes follow the entries");
+	check(footprint.num_evicted == 2, "max_bytes: evictions counted");
+
+	// the current frame's ids stay over any budget
+	eviction.max_bytes = 1;
+	client.setEviction(eviction);
+	decodeFrame(client, 6, ids(5, 6));
+	footprint = client.getFootprint();
+	check(footprint.num_rigidbodies == 2 && hasRigidBody(client, 5) && hasRigidBody(client, 6),
+		  "max_bytes: current frame kept");
+	check(footprint.bytes == 2 * rigidbody_bytes, "max_bytes: bytes of the current frame");
+}
+
+int main(int argc, char** argv)
+{
+	testUnseenFrames();
+	testMaxBytes();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+// filter_markers_test: Frame::filterd_markers against a NatNet 3.0 frame
+//
+// usage: filter_markers_test
+//
+// builds a 3.0 frame packet with unlabeled markers, two rigid bodies and
+// labeled markers of those bodies and of an asset that is not streamed,
+// then checks that the serial and the parallel decoder drop exactly the
+// rigid bodies' labeled markers once the removal distance is set.
+
+#include "natnet/Parser.h"
+#include "natnet/WorkerPool.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+using namespace std;
+using namespace NatNet;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "FAILED: %s\n", what);
+	failures++;
+}
+
+class Writer
+{
+public:
+	vector<char> data;
+
+	template <typename T>
+	void write(T value)
+	{
+		size_t n = data.size();
+		data.resize(n + sizeof(T));
+		memcpy(&data[n], &value, sizeof(T));
+	}
+
+	void writeVec3(float x, float y, float z)
+	{
+		write(x);
+		write(y);
+		write(z);
+	}
+};
+
+// labeled marker ids: asset id in the upper 16 bits, member in the lower
+static int labeledId(int asset_id, int member) { return (asset_id << 16) | member; }
+
+struct LabeledMarker
+{
+	int id;
+	float x;
+};
+
+static const int NUM_UNLABELED = 3;
+static const int RIGIDBODY_IDS[] = {1, 7};
+static const LabeledMarker LABELED[] = {
+	{labeledId(1, 1), 10}, {labeledId(1, 2), 11}, {labeledId(7, 1), 12},
+	{labeledId(3, 1), 13},  // asset 3 is not a streamed rigid body
+	{labeledId(7, 2), 14},
+};
+static const int NUM_LABELED = sizeof(LABELED) / sizeof(LABELED[0]);
+
+static vector<char> makeFramePacket()
+{
+	Writer w;
+	w.write((short)NAT_FRAMEOFDATA);
+	w.write((short)0);  // payload size, patched below
+
+	w.write((int)100);  // frame number
+	w.write((int)0);    // marker sets
+
+	w.write((int)NUM_UNLABELED);
+	for (int i = 0; i < NUM_UNLABELED; i++) w.writeVec3(i, 0, 0);
+
+	w.write((int)2);
+	for (int i = 0; i < 2; i++)
+	{
+		w.write((int)RIGIDBODY_IDS[i]);
+		w.writeVec3(0, 1, 0);
+		w.writeVec3(0, 0, 0);  // orientation
+		w.write(1.0f);
+		w.write(0.001f);  // mean marker error
+		w.write((short)1);  // tracked
+	}
+
+	w.write((int)0);  // skeletons
+
+	w.write((int)NUM_LABELED);
+	for (int i = 0; i < NUM_LABELED; i++)
+	{
+		w.write(LABELED[i].id);
+		w.writeVec3(LABELED[i].x, 0, 0);
+		w.write(0.01f);     // size
+		w.write((short)0);  // params
+		w.write(0.0f);      // residual
+	}
+
+	w.write((int)0);  // force plates
+	w.write((int)0);  // devices
+
+	w.write((unsigned int)0);  // timecode
+	w.write((unsigned int)0);
+	w.write(1.5);  // timestamp
+	w.write((uint64_t)0);
+	w.write((uint64_t)0);
+	w.write((uint64_t)0);
+	w.write((short)0);  // params
+	w.write((int)0);    // end of data
+
+	short payload = w.data.size() - 4;
+	memcpy(&w.data[2], &payload, sizeof(payload));
+	return w.data;
+}
+
+static void checkFrame(const Frame& frame, const char* decoder)
+{
+	printf("%s: %d markers, %d filtered\n", decoder, (int)frame.markers.size(), (int)frame.filterd_markers.size());
+
+	check(frame.markers.size() == NUM_UNLABELED + NUM_LABELED, "all markers decoded");
+	check(frame.rigidbodies.size() == 2, "rigid bodies decoded");
+
+	// unlabeled markers, then the marker of asset 3
+	check(frame.filterd_markers.size() == NUM_UNLABELED + 1, "rigid body markers removed");
+	if (frame.filterd_markers.size() != NUM_UNLABELED + 1) return;
+
+	for (int i = 0; i < NUM_UNLABELED; i++) check(frame.filterd_markers[i].x == i, "unlabeled markers kept");
+	check(frame.filterd_markers[NUM_UNLABELED].x == 13, "other asset's marker kept");
+}
+
+int main(int argc, char** argv)
+{
+	vector<char> packet = makeFramePacket();
+	size_t size = packet.size();
+	packet.resize(Parser::PACKET_BUFFER_SIZE);
+
+	Parser parser;
+	parser.setNatNetVersion(3, 0);
+
+	// no removal distance: no filtering
+	Frame frame;
+	check(parser.parseFrame(packet.data(), frame, size), "frame parsed");
+	check(frame.filterd_markers.size() == frame.markers.size(), "unfiltered without a distance");
+
+	parser.setDuplicatedPointRemovalDistance(5);
+
+	check(parser.parseFrame(packet.data(), frame, size), "frame parsed");
+	checkFrame(frame, "serial");
+
+	parser.setParallelDecode(std::make_shared<WorkerPool>(2), 0);
+
+	Frame parallel_frame;
+	check(parser.parseFrame(packet.data(), parallel_frame, size), "frame parsed");
+	checkFrame(parallel_frame, "parallel");
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+// marker_index_bench: cost of NatNet::MarkerIndex::build against marker count
+//
+// usage: marker_index_bench [iterations] [queries]
+//
+// builds indices over 100, 1000 and 10000 random markers spread like a
+// capture volume in mm, checks findInRadius, findNearest and findInBox
+// against brute force for random queries, then times build() and the
+// queries. exits non-zero when a check fails, so it also runs under ctest.
+
+#include "natnet/MarkerIndex.h"
+#include "natnet/Clock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace NatNet;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "FAILED: %s\n", what);
+	failures++;
+}
+
+// deterministic across platforms, unlike rand()
+static unsigned int seed = 12345;
+
+static float randomFloat(float min, float max)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return min + (max - min) * ((seed >> 8) / 16777216.0f);
+}
+
+static Vec3 randomPoint()
+{
+	return makeVec3(randomFloat(-3000, 3000), randomFloat(0, 2500), randomFloat(-3000, 3000));
+}
+
+static void makeMarkers(vector<Marker>& markers, int n)
+{
+	markers.resize(n);
+	for (int i = 0; i < n; i++) markers[i] = randomPoint();
+
+	// a few exact duplicates, as with overlapping marker sets
+	for (int i = 0; i + 7 < n; i += 97) markers[i + 7] = markers[i];
+}
+
+static float distanceSquared(const Vec3& a, const Vec3& b) { return lengthSquared(a - b); }
+
+static bool inBox(const Vec3& p, const Vec3& min, const Vec3& max)
+{
+	return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y && p.z >= min.z && p.z <= max.z;
+}
+
+static void checkQueries(const MarkerIndex& index, const vector<Marker>& markers, int num_queries)
+{
+	vector<int> result, expected;
+
+	for (int q = 0; q < num_queries; q++)
+	{
+		Vec3 center = q % 4 == 0 ? markers[q % markers.size()] : randomPoint();
+		float radius = randomFloat(10, 800);
+
+		index.findInRadius(center, radius, result);
+		expected.clear();
+		for (int i = 0; i < markers.size(); i++)
+			if (distanceSquared(markers[i], center) <= radius * radius) expected.push_back(i);
+		sort(result.begin(), result.end());
+		check(result == expected, "findInRadius matches brute force");
+
+		Vec3 size = makeVec3(randomFloat(10, 1500), randomFloat(10, 1500), randomFloat(10, 1500));
+		Vec3 lo = center - size * 0.5f;
+		Vec3 hi = center + size * 0.5f;
+
+		index.findInBox(lo, hi, result);
+		expected.clear();
+		for (int i = 0; i < markers.size(); i++)
+			if (inBox(markers[i], lo, hi)) expected.push_back(i);
+		sort(result.begin(), result.end());
+		check(result == expected, "findInBox matches brute force");
+
+		// ties make the order ambiguous, so compare distances
+		int k = 1 + q % 8;
+		index.findNearest(center, k, result);
+
+		vector<float> distances(markers.size());
+		for (int i = 0; i < markers.size(); i++) distances[i] = distanceSquared(markers[i], center);
+		vector<float> sorted = distances;
+		sort(sorted.begin(), sorted.end());
+
+		bool same = result.size() == min(k, (int)markers.size());
+		for (int i = 0; same && i < result.size(); i++)
+			same = distances[result[i]] == sorted[i];
+		check(same, "findNearest matches brute force");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 200;
+	int num_queries = argc > 2 ? atoi(argv[2]) : 100;
+	if (iterations < 1) iterations = 1;
+
+	static const int COUNTS[] = {100, 1000, 10000};
+
+	MarkerIndex index;
+	vector<Marker> markers;
+	vector<int> result;
+
+	for (int c = 0; c < 3; c++)
+	{
+		int n = COUNTS[c];
+		makeMarkers(markers, n);
+
+		index.build(markers, c);
+		check(index.size() == n && index.getFrameNumber() == c, "index size");
+		bool kept = true;
+		for (int i = 0; i < n; i++) kept = kept && lengthSquared(index.getPoint(i) - markers[i]) == 0;
+		check(kept, "getPoint() by build index");
+
+		checkQueries(index, markers, num_queries);
+		if (failures) return 1;
+
+		// builds into the storage of the previous one, as the client does
+		Nanos start = getTimeNanos();
+		for (int i = 0; i < iterations; i++) index.build(markers, i);
+		Nanos build_nanos = (getTimeNanos() - start) / iterations;
+
+		start = getTimeNanos();
+		size_t found = 0;
+		for (int i = 0; i < iterations; i++) found += index.findInRadius(markers[i % n], 50, result);
+		Nanos radius_nanos = (getTimeNanos() - start) / iterations;
+
+		start = getTimeNanos();
+		for (int i = 0; i < iterations; i++) index.findNearest(markers[i % n], 4, result);
+		Nanos nearest_nanos = (getTimeNanos() - start) / iterations;
+
+		printf("%5d markers: build %8.2f us (%5.1f ns / marker), radius 50 %6.2f us (%.1f found), "
+			   "4 nearest %6.2f us\n",
+			   n, build_nanos / 1000.0, (double)build_nanos / n, radius_nanos / 1000.0,
+			   (double)found / iterations, nearest_nanos / 1000.0);
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,231 @@
+// marker_tracker_test: NatNet::MarkerTracker ids across frames
+//
+// usage: marker_tracker_test
+//
+// moves a grid of markers at constant velocity, shuffled and with some
+// dropped every frame, and checks every marker keeps its id. then checks
+// coasting and dropping after max_misses, the max_tracks cap, restarts on
+// a frame number that jumps back or too far ahead, and that a distance of
+// 0 or less is ignored.
+
+#include "natnet/MarkerTracker.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace NatNet;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "FAILED: %s\n", what);
+	failures++;
+}
+
+// deterministic across platforms, unlike rand()
+static unsigned int seed = 12345;
+
+static int randomInt(int n)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return (seed >> 8) % n;
+}
+
+static MarkerTracker::Settings makeSettings(int max_misses, int max_tracks)
+{
+	MarkerTracker::Settings s;
+	s.max_distance = 0.03f;
+	s.max_misses = max_misses;
+	s.max_tracks = max_tracks;
+	return s;
+}
+
+static void testShuffleAndDropouts()
+{
+	MarkerTracker tracker;
+	tracker.setEnabled(true);
+	tracker.setSettings(makeSettings(10, 10000));
+
+	// 5 x 5 grid, 0.5 apart, moving 5 mm per frame
+	const int N = 25;
+	vector<Marker> start(N);
+	for (int i = 0; i < N; i++) start[i] = makeVec3((i % 5) * 0.5f, 1, (i / 5) * 0.5f);
+	Vec3 velocity = makeVec3(0.005f, 0, -0.003f);
+
+	vector<int> first_ids(N, -1);
+	vector<int> order(N);
+	vector<Marker> markers;
+	vector<int> ids, ages;
+
+	for (int f = 0; f < 60; f++)
+	{
+		for (int i = 0; i < N; i++) order[i] = i;
+		for (int i = N - 1; i > 0; i--) swap(order[i], order[randomInt(i + 1)]);
+
+		// after the first frame, two markers are missing each frame
+		if (f > 0) order.resize(N - 2);
+
+		markers.clear();
+		for (int i = 0; i < order.size(); i++) markers.push_back(start[order[i]] + velocity * f);
+
+		tracker.apply(markers.data(), markers.size(), 100 + f, ids, ages);
+		check(ids.size() == markers.size() && ages.size() == markers.size(), "shuffled: an id per marker");
+
+		bool stable = true;
+		for (int i = 0; i < order.size(); i++)
+		{
+			int m = order[i];
+			if (f == 0)
+				first_ids[m] = ids[i];
+			else
+				stable = stable && ids[i] == first_ids[m] && ages[i] == f;
+		}
+		check(stable, "shuffled: ids kept under reordering and dropouts");
+		order.resize(N);
+	}
+
+	check(tracker.getNumTracks() == N, "shuffled: no extra tracks");
+
+	vector<int> sorted = first_ids;
+	sort(sorted.begin(), sorted.end());
+	check(unique(sorted.begin(), sorted.end()) == sorted.end() && sorted[0] >= 0, "shuffled: ids unique");
+}
+
+static void testCoasting()
+{
+	MarkerTracker tracker;
+	tracker.setEnabled(true);
+	tracker.setSettings(makeSettings(3, 10000));
+
+	// a stays, b is gone for 3 frames (max_misses), c for 4
+	Marker a = makeVec3(0, 0, 0), b = makeVec3(1, 0, 0), c = makeVec3(2, 0, 0);
+	vector<int> ids, ages;
+
+	Marker all[] = {a, b, c};
+	tracker.apply(all, 3, 0, ids, ages);
+	int id_b = ids[1], id_c = ids[2];
+
+	for (int f = 1; f <= 3; f++)
+	{
+		tracker.apply(&a, 1, f, ids, ages);
+		check(tracker.getNumTracks() == 3, "coasting: tracks kept up to max_misses");
+	}
+
+	Marker a_b[] = {a, b};
+	tracker.apply(a_b, 2, 4, ids, ages);
+	check(ids[1] == id_b && ages[1] == 4, "coasting: id kept after max_misses frames");
+	check(tracker.getNumTracks() == 2, "coasting: dropped after max_misses");
+
+	tracker.apply(all, 3, 5, ids, ages);
+	check(ids[1] == id_b, "coasting: kept track continues");
+	check(ids[2] != id_c && ids[2] >= 0 && ages[2] == 0, "coasting: dropped track gets a new id");
+}
+
+static void testMaxTracks()
+{
+	MarkerTracker tracker;
+	tracker.setEnabled(true);
+	tracker.setSettings(makeSettings(10, 5));
+
+	vector<Marker> markers(8);
+	for (int i = 0; i < 8; i++) markers[i] = makeVec3(i, 0, 0);
+
+	vector<int> ids, ages;
+	tracker.apply(markers.data(), 8, 0, ids, ages);
+
+	int tracked = 0, untracked = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		if (ids[i] >= 0) tracked++;
+		else untracked++;
+	}
+	check(tracked == 5 && untracked == 3, "max_tracks: markers beyond the cap get -1");
+	check(tracker.getNumTracks() == 5, "max_tracks: tracks capped");
+
+	// the tracked ones keep their ids while the cap is full
+	vector<int> first = ids;
+	tracker.apply(markers.data(), 8, 1, ids, ages);
+	check(ids == first, "max_tracks: ids stable at the cap");
+}
+
+static void testRestart()
+{
+	MarkerTracker tracker;
+	tracker.setEnabled(true);
+	tracker.setSettings(makeSettings(3, 10000));
+
+	Marker m = makeVec3(0.2f, 0.3f, 0.4f);
+	vector<int> ids, ages;
+
+	tracker.apply(&m, 1, 50, ids, ages);
+	int id = ids[0];
+	tracker.apply(&m, 1, 51, ids, ages);
+	check(ids[0] == id && ages[0] == 1, "restart: same id on the next frame");
+
+	// take looped
+	tracker.apply(&m, 1, 10, ids, ages);
+	check(ids[0] != id && ages[0] == 0, "restart: new track after the frame number jumps back");
+	id = ids[0];
+
+	tracker.apply(&m, 1, 10, ids, ages);
+	check(ids[0] != id, "restart: new track on a repeated frame number");
+	id = ids[0];
+
+	// further than any track coasts
+	tracker.apply(&m, 1, 15, ids, ages);
+	check(ids[0] != id && ages[0] == 0, "restart: new track after a gap beyond max_misses");
+	id = ids[0];
+
+	tracker.apply(&m, 1, 19, ids, ages);
+	check(ids[0] == id && ages[0] == 4, "restart: a gap of max_misses + 1 is bridged");
+
+	tracker.reset();
+	tracker.apply(&m, 1, 20, ids, ages);
+	check(ids[0] != id && ages[0] == 0, "restart: reset() drops tracks");
+}
+
+static void testDistance()
+{
+	MarkerTracker tracker;
+	tracker.setEnabled(true);
+
+	MarkerTracker::Settings s = makeSettings(10, 10000);
+	s.max_distance = 5;
+	tracker.setSettings(s);
+
+	s.max_distance = 0;
+	tracker.setSettings(s);
+	check(tracker.getSettings().max_distance == 5, "distance: 0 ignored");
+
+	s.max_distance = -1;
+	s.velocity_smoothing = 3;
+	tracker.setSettings(s);
+	check(tracker.getSettings().max_distance == 5, "distance: negative ignored");
+	check(tracker.getSettings().velocity_smoothing == 1, "distance: smoothing clamped");
+
+	// mm far from the origin, with a cell size that used to overflow int
+	s.max_distance = 1e-7f;
+	tracker.setSettings(s);
+
+	Marker markers[] = {makeVec3(5000, 1200, -4000), makeVec3(-9e6f, 3e7f, 1e9f)};
+	vector<int> ids, ages;
+	tracker.apply(markers, 2, 0, ids, ages);
+	vector<int> first = ids;
+	tracker.apply(markers, 2, 1, ids, ages);
+	check(ids == first && ages[0] == 1 && ages[1] == 1, "distance: tiny cells keep far markers");
+}
+
+int main(int argc, char** argv)
+{
+	testShuffleAndDropouts();
+	testCoasting();
+	testMaxTracks();
+	testRestart();
+	testDistance();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+// markerset_slots_test: description slot -> marker set resolution in
+// NatNet::Client::State::markerset_slots
+//
+// usage: markerset_slots_test
+//
+// decodes descriptions of marker sets A, B and C offline, then frames that
+// stream them in order, reordered and with one renamed, without new
+// descriptions in between, and checks that every slot still leads to the
+// set of its name.
+
+#include "natnet/Client.h"
+#include "PacketWriter.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace NatNet;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "FAILED: %s\n", what);
+	failures++;
+}
+
+static const char* DESCRIBED[] = {"A", "B", "C"};
+
+static void decodeDescriptions(Client& client)
+{
+	PacketWriter w(NAT_MODELDEF);
+	w.write((int)3);
+	for (int i = 0; i < 3; i++)
+	{
+		w.write((int)0);  // marker set
+		w.writeString(DESCRIBED[i]);
+		w.write((int)0);  // marker names
+	}
+
+	size_t size = w.finish();
+	check(client.decodePacket(w.data.data(), size), "descriptions decoded");
+}
+
+// a 3.0 frame with the given marker sets. set "X" streams one marker at
+// x = the index of X in DESCRIBED (or 9), so slots can be told apart
+static void decodeFrame(Client& client, int frame_number, const vector<string>& names)
+{
+	PacketWriter w(NAT_FRAMEOFDATA);
+	w.write(frame_number);
+
+	w.write((int)names.size());
+	for (int i = 0; i < names.size(); i++)
+	{
+		w.writeString(names[i].c_str());
+		w.write((int)1);
+		w.writeVec3(names[i][0] - 'A', 0, 0);
+	}
+
+	w.write((int)0);  // unlabeled markers
+	w.write((int)0);  // rigid bodies
+	w.write((int)0);  // skeletons
+	w.write((int)0);  // labeled markers
+	w.write((int)0);  // force plates
+	w.write((int)0);  // devices
+
+	w.write((unsigned int)0);  // timecode
+	w.write((unsigned int)0);
+	w.write(0.0);  // timestamp
+	w.write((uint64_t)0);
+	w.write((uint64_t)0);
+	w.write((uint64_t)0);
+	w.write((short)0);  // params
+	w.write((int)0);    // end of data
+
+	size_t size = w.finish();
+	check(client.decodePacket(w.data.data(), size), "frame decoded");
+}
+
+// the set a description slot resolves to, by its marker's x, -1 if none
+static int resolve(Client& client, int slot)
+{
+	client.lock();
+	const Client::State& state = client.getState();
+
+	int x = -1;
+	if (state.markerset_slots_version == state.description_version && slot < state.markerset_slots.size())
+	{
+		int index = state.markerset_slots[slot];
+		if (index >= 0 && index < state.markers_set.size() && state.markers_set[index].size())
+			x = state.markers_set[index][0].x;
+	}
+
+	client.unlock();
+	return x;
+}
+
+static vector<string> names(const char* a, const char* b, const char* c)
+{
+	vector<string> v;
+	v.push_back(a);
+	v.push_back(b);
+	v.push_back(c);
+	return v;
+}
+
+int main(int argc, char** argv)
+{
+	Client client;
+	client.setupOffline(3, 0);
+
+	// names are only valid during the callback; copied there
+	vector<string> seen;
+	client.setFrameCallback([&](const Frame& frame) {
+		seen.assign(frame.markerset_names.begin(), frame.markerset_names.end());
+	});
+
+	decodeDescriptions(client);
+
+	decodeFrame(client, 1, names("A", "B", "C"));
+	check(seen.size() == 3 && seen[2] == "C", "names seen in the callback");
+	for (int slot = 0; slot < 3; slot++) check(resolve(client, slot) == slot, "in order");
+
+	// same count, new order, no new descriptions
+	decodeFrame(client, 2, names("C", "A", "B"));
+	for (int slot = 0; slot < 3; slot++) check(resolve(client, slot) == slot, "reordered");
+
+	// same count, C replaced by a set that is not described
+	decodeFrame(client, 3, names("B", "Z", "A"));
+	check(resolve(client, 0) == 0 && resolve(client, 1) == 1, "renamed: described sets kept");
+	check(resolve(client, 2) == -1, "renamed: missing set unresolved");
+
+	// and back
+	decodeFrame(client, 4, names("A", "C", "B"));
+	for (int slot = 0; slot < 3; slot++) check(resolve(client, slot) == slot, "restored");
+
+	return failures ? 1 : 0;
+}
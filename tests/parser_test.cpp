@@ -0,0 +1,486 @@
+// parser_test: NatNet::Parser against hand-built 2.9, 3.0 and 4.1 packets
+//
+// usage: parser_test
+//
+// builds the same frame in each version's layout: 2.9 with rigid body
+// markers and the latency float, 3.0 with clock ticks, 4.1 with a byte
+// size after every section count and an asset section the parser skips.
+// every section is followed by the frame suffix, so a section stepped over
+// wrongly shows up as a wrong timecode, timestamp or latency. the frames
+// are decoded serially, in parallel and with sections and ids filtered
+// out. then descriptions of types 0 - 5 are parsed in each layout (sized
+// in 4.1, walked before), and the clock frequency is read from ping
+// responses.
+
+#include "natnet/Parser.h"
+#include "natnet/WorkerPool.h"
+#include "PacketWriter.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+using namespace std;
+using namespace NatNet;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "FAILED: %s\n", what);
+	failures++;
+}
+
+static bool isSized(int major, int minor) { return major > 4 || (major == 4 && minor >= 1); }
+
+// a 4.1 section size placeholder, nothing before
+static size_t beginSection(PacketWriter& w, int major, int minor)
+{
+	return isSized(major, minor) ? w.beginSize() : 0;
+}
+
+static void endSection(PacketWriter& w, int major, int minor, size_t begin)
+{
+	if (isSized(major, minor)) w.endSize(begin);
+}
+
+// frame contents
+
+static const int FRAME_NUMBER = 77;
+static const unsigned int TIMECODE = 0x01020304;
+static const unsigned int TIMECODE_SUB = 5;
+static const double TIMESTAMP = 12.5;
+static const float LATENCY_2 = 0.0125f;  // software latency, before 3.0
+
+// 3.0 and later: exposure to transmit in ticks of a 10 MHz clock
+static const uint64_t CLOCK_FREQUENCY = 10000000;
+static const uint64_t EXPOSURE = 50000000;
+static const uint64_t TRANSMITTED = 50042000;  // 4.2 ms
+
+static void writeRigidBody(PacketWriter& w, int major, int id, float x, bool tracked)
+{
+	w.write(id);
+	w.writeVec3(x, 0, 0);
+	w.write(0.0f);  // orientation
+	w.write(0.0f);
+	w.write(0.0f);
+	w.write(1.0f);
+
+	// marker positions, ids and sizes, dropped in 3.0
+	if (major < 3)
+	{
+		w.write((int)2);
+		w.writeVec3(x, 1, 0);
+		w.writeVec3(x, 2, 0);
+		w.write((int)1);
+		w.write((int)2);
+		w.write(0.01f);
+		w.write(0.01f);
+	}
+
+	w.write(0.001f);                     // mean marker error
+	w.write((short)(tracked ? 1 : 0));  // params
+}
+
+// id, one channel of two samples
+static void writeChannelData(PacketWriter& w, int id)
+{
+	w.write(id);
+	w.write((int)1);
+	w.write((int)2);
+	w.write(1.0f);
+	w.write(2.0f);
+}
+
+static size_t writeFrame(PacketWriter& w, int major, int minor)
+{
+	size_t s;
+
+	w.write(FRAME_NUMBER);
+
+	w.write((int)1);  // marker sets
+	s = beginSection(w, major, minor);
+	w.writeString("set");
+	w.write((int)2);
+	w.writeVec3(1, 2, 3);
+	w.writeVec3(4, 5, 6);
+	endSection(w, major, minor, s);
+
+	w.write((int)2);  // unlabeled markers
+	s = beginSection(w, major, minor);
+	w.writeVec3(10, 0, 0);
+	w.writeVec3(11, 0, 0);
+	endSection(w, major, minor, s);
+
+	w.write((int)2);  // rigid bodies
+	s = beginSection(w, major, minor);
+	writeRigidBody(w, major, 1, 1, true);
+	writeRigidBody(w, major, 2, 2, false);
+	endSection(w, major, minor, s);
+
+	w.write((int)1);  // skeletons
+	s = beginSection(w, major, minor);
+	w.write((int)5);
+	w.write((int)2);
+	writeRigidBody(w, major, (5 << 16) | 1, 30, true);
+	writeRigidBody(w, major, (5 << 16) | 2, 31, true);
+	endSection(w, major, minor, s);
+
+	// assets, 4.1 and later: not decoded, only their size is trusted
+	if (isSized(major, minor))
+	{
+		w.write((int)2);
+		s = w.beginSize();
+		for (int i = 0; i < 6; i++) w.write((int)-1);
+		w.endSize(s);
+	}
+
+	w.write((int)1);  // labeled markers
+	s = beginSection(w, major, minor);
+	w.write((int)((1 << 16) | 1));
+	w.writeVec3(20, 0, 0);
+	w.write(0.01f);     // size
+	w.write((short)0);  // params
+	if (major >= 3) w.write(0.0f);  // residual
+	endSection(w, major, minor, s);
+
+	// force plates, then devices from 2.11. sized sections carry 4 bytes
+	// more than the channel data, which only the size steps over
+	w.write((int)1);
+	s = beginSection(w, major, minor);
+	writeChannelData(w, 1);
+	if (isSized(major, minor)) w.write((int)-1);
+	endSection(w, major, minor, s);
+
+	if (major >= 3)
+	{
+		w.write((int)1);
+		s = beginSection(w, major, minor);
+		writeChannelData(w, 2);
+		if (isSized(major, minor)) w.write((int)-1);
+		endSection(w, major, minor, s);
+	}
+
+	if (major < 3) w.write(LATENCY_2);
+	w.write(TIMECODE);
+	w.write(TIMECODE_SUB);
+	w.write(TIMESTAMP);
+	if (major >= 3)
+	{
+		w.write(EXPOSURE);
+		w.write((uint64_t)(EXPOSURE + 10000));  // received
+		w.write(TRANSMITTED);
+	}
+	if (isSized(major, minor))
+	{
+		w.write((unsigned int)12);  // precision timestamp
+		w.write((unsigned int)0);
+	}
+	w.write((short)0);  // params
+	w.write((int)0);    // end of data
+
+	return w.finish();
+}
+
+static void checkFrame(const Frame& frame, int major, float latency, const Subscription& subscription)
+{
+	bool markersets = subscription.sections & DECODE_MARKERSETS;
+	bool skeletons = subscription.sections & DECODE_SKELETONS;
+	bool all_bodies = subscription.rigidbody_ids.empty();
+
+	check(frame.frame_number == FRAME_NUMBER, "frame number");
+
+	if (markersets)
+	{
+		check(frame.markers_set.size() == 1 && frame.markerset_names.size() == 1
+			  && strcmp(frame.markerset_names[0], "set") == 0, "marker set");
+		check(frame.markers_set.size() == 1 && frame.markers_set[0].size() == 2 && frame.markers_set[0][1].x == 4,
+			  "marker set markers");
+	}
+	else
+		check(frame.markers_set.empty() && frame.markerset_names.empty(), "marker sets skipped");
+
+	check(frame.num_unlabeled_markers == 2 && frame.markers.size() == 3, "unlabeled and labeled markers");
+	check(frame.markers.size() == 3 && frame.markers[1].x == 11 && frame.markers[2].x == 20, "marker positions");
+
+	const vector<RigidBody>& R = frame.rigidbodies;
+	size_t num_markers = major < 3 ? 2 : 0;
+	if (all_bodies)
+	{
+		check(R.size() == 2 && R[0].id == 1 && R[1].id == 2, "rigid bodies");
+		check(R.size() == 2 && R[0].active && !R[1].active, "rigid body tracking");
+		check(R.size() == 2 && R[1].position.x == 2 && R[1].orientation.w == 1, "rigid body pose");
+		check(R.size() == 2 && R[0].markers.size() == num_markers, "rigid body markers");
+		if (num_markers)
+			check(R.size() == 2 && R[0].markers[1].y == 2 && R[1].markers[0].x == 2, "rigid body marker positions");
+	}
+	else
+		check(R.size() == 1 && R[0].id == 2 && R[0].position.x == 2, "rigid bodies filtered");
+
+	if (skeletons)
+	{
+		check(frame.skeletons.size() == 1 && frame.skeletons[0].id == 5, "skeleton");
+		check(frame.skeletons.size() == 1 && frame.skeletons[0].joints.size() == 2
+			  && frame.skeletons[0].joints[1].raw_position.x == 31
+			  && frame.skeletons[0].joints[1].markers.size() == num_markers, "skeleton joints");
+	}
+	else
+		check(frame.skeletons.empty(), "skeletons skipped");
+
+	// the suffix comes last: a section misread shows here
+	check(frame.timecode == TIMECODE && frame.timecode_sub == TIMECODE_SUB, "timecode");
+	check(frame.timestamp == TIMESTAMP, "timestamp");
+	check(fabsf(frame.latency - latency) < 1e-6f, "latency");
+}
+
+static void testFrame(int major, int minor)
+{
+	PacketWriter w(NAT_FRAMEOFDATA);
+	size_t size = writeFrame(w, major, minor);
+
+	Parser parser;
+	parser.setNatNetVersion(major, minor);
+
+	// before 3.0 the latency is streamed, from 3.0 it needs the clock
+	float latency = major < 3 ? LATENCY_2 : 0;
+
+	Frame frame;
+	Subscription all;
+	check(parser.parseFrame(w.data.data(), frame, size), "frame parsed");
+	checkFrame(frame, major, latency, all);
+
+	if (major >= 3)
+	{
+		latency = (float)(TRANSMITTED - EXPOSURE) / CLOCK_FREQUENCY;
+		parser.setServerClockFrequency(CLOCK_FREQUENCY);
+		check(parser.parseFrame(w.data.data(), frame, size), "frame parsed");
+		checkFrame(frame, major, latency, all);
+	}
+
+	// sections and ids left out: stepped over by size in 4.1, walked before
+	Subscription some;
+	some.sections = DECODE_ALL & ~(DECODE_MARKERSETS | DECODE_SKELETONS);
+	some.rigidbody_ids.push_back(2);
+	parser.setSubscription(some);
+
+	check(parser.parseFrame(w.data.data(), frame, size), "filtered frame parsed");
+	checkFrame(frame, major, latency, some);
+
+	// the parallel decoder indexes the packet first, with its own walk
+	parser.setParallelDecode(make_shared<WorkerPool>(2), 0);
+
+	Frame parallel_frame;
+	check(parser.parseFrame(w.data.data(), parallel_frame, size), "filtered frame parsed in parallel");
+	checkFrame(parallel_frame, major, latency, some);
+
+	parser.setSubscription(all);
+	check(parser.parseFrame(w.data.data(), parallel_frame, size), "frame parsed in parallel");
+	checkFrame(parallel_frame, major, latency, all);
+}
+
+static void testLatency()
+{
+	PacketWriter w(NAT_FRAMEOFDATA);
+	size_t size = writeFrame(w, 3, 0);
+
+	Parser parser;
+	parser.setNatNetVersion(3, 0);
+	parser.setServerClockFrequency(CLOCK_FREQUENCY);
+
+	Frame frame;
+	check(parser.parseFrame(w.data.data(), frame, size) && fabsf(frame.latency - 0.0042f) < 1e-6f,
+		  "latency from clock ticks");
+
+	// transmitted before exposure, as when the clock wrapped: no latency
+	uint64_t early = EXPOSURE - 1;
+	size_t offset = size - sizeof(int) - sizeof(short) - sizeof(uint64_t);
+	memcpy(&w.data[offset], &early, sizeof(early));
+	check(parser.parseFrame(w.data.data(), frame, size) && frame.latency == 0, "no latency when the clock goes back");
+}
+
+// descriptions
+
+static void writeJoint(PacketWriter& w, int major, const char* name, int id, int parent_id, float y, int num_markers)
+{
+	w.writeString(name);
+	w.write(id);
+	w.write(parent_id);
+	w.writeVec3(0, y, 0);
+
+	// 3.0 and later: marker offsets and labels, names from 4.0
+	if (major < 3) return;
+
+	w.write(num_markers);
+	for (int i = 0; i < num_markers; i++) w.writeVec3(i, 0, 0);
+	for (int i = 0; i < num_markers; i++) w.write(i + 1);
+	if (major >= 4)
+	{
+		for (int i = 0; i < num_markers; i++) w.writeString(i ? "m2" : "m1");
+	}
+}
+
+static size_t writeDescriptions(PacketWriter& w, int major, int minor)
+{
+	size_t s;
+
+	w.write((int)7);
+
+	w.write((int)0);  // marker set
+	s = beginSection(w, major, minor);
+	w.writeString("set");
+	w.write((int)2);
+	w.writeString("a");
+	w.writeString("b");
+	endSection(w, major, minor, s);
+
+	// rigid body. sized ones carry a field this parser doesn't know
+	w.write((int)1);
+	s = beginSection(w, major, minor);
+	writeJoint(w, major, "body", 1, -1, 0, 2);
+	if (isSized(major, minor)) w.write((int)-1);
+	endSection(w, major, minor, s);
+
+	w.write((int)2);  // skeleton
+	s = beginSection(w, major, minor);
+	w.writeString("skel");
+	w.write((int)5);
+	w.write((int)2);
+	writeJoint(w, major, "knee", 2, 1, -0.5f, 0);
+	writeJoint(w, major, "hip", 1, 0, 1, 0);
+	endSection(w, major, minor, s);
+
+	// force plate: id, serial, dimensions, origin, calibration, corners,
+	// plate and channel data type (3.0 and later), channel names
+	w.write((int)3);
+	s = beginSection(w, major, minor);
+	w.write((int)1);
+	w.writeString("FP-1");
+	for (int i = 0; i < 2 + 3 + 12 * 12 + 4 * 3; i++) w.write(0.5f);
+	if (major >= 3)
+	{
+		w.write((int)1);
+		w.write((int)0);
+	}
+	w.write((int)2);
+	w.writeString("Fx");
+	w.writeString("Fy");
+	endSection(w, major, minor, s);
+
+	// device: id, name, serial, device and channel data type, channel names
+	w.write((int)4);
+	s = beginSection(w, major, minor);
+	w.write((int)2);
+	w.writeString("daq");
+	w.writeString("D-1");
+	w.write((int)0);
+	w.write((int)0);
+	w.write((int)1);
+	w.writeString("ch");
+	endSection(w, major, minor, s);
+
+	// camera: name, position, orientation
+	w.write((int)5);
+	s = beginSection(w, major, minor);
+	w.writeString("cam");
+	for (int i = 0; i < 7; i++) w.write(0.25f);
+	endSection(w, major, minor, s);
+
+	// after everything skipped
+	w.write((int)1);
+	s = beginSection(w, major, minor);
+	writeJoint(w, major, "tail", 9, -1, 0, 0);
+	endSection(w, major, minor, s);
+
+	return w.finish();
+}
+
+static void testDescriptions(int major, int minor)
+{
+	PacketWriter w(NAT_MODELDEF);
+	writeDescriptions(w, major, minor);
+
+	Parser parser;
+	parser.setNatNetVersion(major, minor);
+
+	Descriptions d;
+	check(parser.parseDescriptions(w.data.data(), d), "descriptions parsed");
+
+	check(d.markersets.size() == 1 && d.markersets[0].name == "set" && d.markersets[0].marker_names.size() == 2
+		  && d.markersets[0].marker_names[1] == "b", "marker set description");
+
+	check(d.rigidbodies.size() == 2, "rigid body descriptions");
+	if (d.rigidbodies.size() == 2)
+	{
+		const RigidBodyDescription& body = d.rigidbodies[0];
+		check(body.name == "body" && body.id == 1 && body.parent_id == -1, "rigid body description");
+		check(body.marker_offsets.size() == (major >= 3 ? 2 : 0), "rigid body marker offsets");
+		if (major >= 3) check(body.marker_offsets[1].x == 1, "rigid body marker offset");
+		check(body.marker_names.size() == (major >= 4 ? 2 : 0), "rigid body marker names");
+		if (major >= 4) check(body.marker_names[1] == "m2", "rigid body marker name");
+
+		check(d.rigidbodies[1].name == "tail" && d.rigidbodies[1].id == 9, "description after the skipped ones");
+	}
+
+	check(d.skeletons.size() == 1 && d.skeletons[0].name == "skel" && d.skeletons[0].id == 5
+		  && d.skeletons[0].joints.size() == 2, "skeleton description");
+	if (d.skeletons.size() == 1 && d.skeletons[0].joints.size() == 2)
+	{
+		const SkeletonDescription& skel = d.skeletons[0];
+		check(skel.joints[0].name == "knee" && skel.joints[1].offset.y == 1, "skeleton joints");
+		check(skel.parent_indices[0] == 1 && skel.parent_indices[1] == -1, "skeleton hierarchy");
+	}
+
+	check(d.rigidbody_index.count("tail") && d.skeleton_index.count("skel"), "description index");
+}
+
+// ping response: sender name, app and NatNet versions, then from 3.0 the
+// server clock frequency
+static void testPingResponse(int major, int minor, bool with_frequency)
+{
+	PacketWriter w(NAT_PINGRESPONSE);
+
+	char name[256];
+	memset(name, 0, sizeof(name));
+	strcpy(name, "Motive");
+	for (int i = 0; i < 256; i++) w.write(name[i]);
+
+	unsigned char version[] = {3, 1, 0, 0};
+	for (int i = 0; i < 4; i++) w.write(version[i]);
+	unsigned char natnet[] = {(unsigned char)major, (unsigned char)minor, 0, 0};
+	for (int i = 0; i < 4; i++) w.write(natnet[i]);
+
+	if (with_frequency) w.write(CLOCK_FREQUENCY);
+	w.finish();
+
+	Parser parser;
+	parser.setServerClockFrequency(1);
+	check(parser.parsePingResponse(w.data.data()), "ping response parsed");
+	check(parser.getNatNetMajor() == major && parser.getNatNetMinor() == minor, "NatNet version");
+	check(parser.getServerMajor() == 3 && parser.getServerMinor() == 1, "server version");
+
+	uint64_t frequency = major >= 3 && with_frequency ? CLOCK_FREQUENCY : 0;
+	check(parser.getServerClockFrequency() == frequency, "server clock frequency");
+}
+
+int main(int argc, char** argv)
+{
+	static const int VERSIONS[][2] = {{2, 9}, {3, 0}, {4, 1}};
+
+	for (int i = 0; i < 3; i++)
+	{
+		testFrame(VERSIONS[i][0], VERSIONS[i][1]);
+		testDescriptions(VERSIONS[i][0], VERSIONS[i][1]);
+	}
+
+	testLatency();
+
+	testPingResponse(2, 9, false);
+	testPingResponse(3, 0, true);
+	testPingResponse(3, 0, false);
+	testPingResponse(4, 1, true);
+
+	return failures ? 1 : 0;
+}
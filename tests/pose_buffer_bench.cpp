@@ -0,0 +1,162 @@
+// pose_buffer_bench: cost of NatNet::PoseBuffer::fill for a synthetic frame
+//
+// usage: pose_buffer_bench [iterations] [markers] [rigid bodies] [skeletons]
+//
+// each rigid body has 5 markers, each skeleton 21 solved joints. checks
+// the layout of the filled buffer, then times fills from a Frame and from
+// per-id maps (Client::State) into a buffer kept across iterations.
+// exits non-zero when the check fails, so it also runs under ctest.
+
+#include "natnet/PoseBuffer.h"
+#include "natnet/Clock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <map>
+
+using namespace std;
+using namespace NatNet;
+
+static const int MARKERS_PER_BODY = 5;
+static const int JOINTS_PER_SKELETON = 21;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "FAILED: %s\n", what);
+	failures++;
+}
+
+static void makeFrame(Frame& frame, int num_markers, int num_rigidbodies, int num_skeletons)
+{
+	frame.frame_number = 42;
+
+	frame.markers.resize(num_markers);
+	for (int i = 0; i < num_markers; i++) frame.markers[i] = makeVec3(i, i * 0.5f, -i);
+
+	frame.filterd_markers.assign(frame.markers.begin(), frame.markers.begin() + num_markers / 2);
+
+	frame.rigidbodies.resize(num_rigidbodies);
+	for (int i = 0; i < num_rigidbodies; i++)
+	{
+		RigidBody& RB = frame.rigidbodies[i];
+		RB.id = i + 1;
+		RB.position = makeVec3(i, 2 * i, 3 * i);
+		RB.orientation = makeQuat(0, 0.70710678f, 0, 0.70710678f);
+		RB.active = i % 2 == 0;
+		RB.mean_marker_error = 0.001f * i;
+		RB.markers.resize(MARKERS_PER_BODY);
+		for (int n = 0; n < MARKERS_PER_BODY; n++) RB.markers[n] = makeVec3(i, n, 0);
+	}
+
+	frame.skeletons.resize(num_skeletons);
+	for (int i = 0; i < num_skeletons; i++)
+	{
+		Skeleton& S = frame.skeletons[i];
+		S.id = 100 + i;
+		S.world_matrices.assign(JOINTS_PER_SKELETON, identityMatrix());
+		for (int n = 0; n < JOINTS_PER_SKELETON; n++)
+			setTranslation(S.world_matrices[n], makeVec3(i, n, 1));
+	}
+}
+
+static void checkLayout(const PoseBuffer& buffer, const Frame& frame)
+{
+	size_t num_rigidbody_markers = frame.rigidbodies.size() * MARKERS_PER_BODY;
+	size_t num_joints = frame.skeletons.size() * JOINTS_PER_SKELETON;
+
+	check(buffer.frame_number == frame.frame_number, "frame number");
+	check(buffer.num_markers == frame.markers.size(), "marker count");
+	check(buffer.num_filterd_markers == frame.filterd_markers.size(), "filtered marker count");
+	check(buffer.num_rigidbody_markers == num_rigidbody_markers, "rigid body marker count");
+	check(buffer.num_rigidbodies == frame.rigidbodies.size(), "rigid body count");
+	check(buffer.num_joints == num_joints, "joint count");
+	check(buffer.markers.size() == frame.markers.size() + frame.filterd_markers.size() + num_rigidbody_markers,
+		  "marker records");
+	check(buffer.transforms.size() == frame.rigidbodies.size() + num_joints, "transform records");
+
+	for (size_t i = 0; i < buffer.num_markers; i++)
+	{
+		const MarkerInstance& m = buffer.markers[i];
+		check(match(m.position, frame.markers[i], 1e-6f) && m.id == -1, "marker record");
+	}
+
+	const MarkerInstance* rm = buffer.getRigidBodyMarkers();
+	for (size_t i = 0; i < frame.rigidbodies.size(); i++)
+	{
+		const RigidBody& RB = frame.rigidbodies[i];
+		for (int n = 0; n < MARKERS_PER_BODY; n++, rm++)
+			check(match(rm->position, RB.markers[n], 1e-6f) && rm->id == RB.id, "rigid body marker record");
+
+		const TransformInstance& t = buffer.transforms[i];
+		Matrix4x4 expected = RB.getMatrix();
+		bool same = true;
+		for (int k = 0; k < 16; k++) same = same && t.matrix.m[k] == expected.m[k];
+		check(same, "rigid body matrix");
+		check(t.params[0] == RB.id && t.params[1] == (RB.active ? 1 : 0)
+			  && t.params[2] == RB.mean_marker_error, "rigid body params");
+	}
+
+	const TransformInstance* joint = buffer.getJoints();
+	for (size_t i = 0; i < frame.skeletons.size(); i++)
+	{
+		const Skeleton& S = frame.skeletons[i];
+		for (int n = 0; n < JOINTS_PER_SKELETON; n++, joint++)
+		{
+			check(match(getTranslation(joint->matrix), getTranslation(S.world_matrices[n]), 1e-6f),
+				  "joint matrix");
+			check(joint->params[0] == n && joint->params[3] == S.id, "joint params");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+	int num_markers = argc > 2 ? atoi(argv[2]) : 1000;
+	int num_rigidbodies = argc > 3 ? atoi(argv[3]) : 100;
+	int num_skeletons = argc > 4 ? atoi(argv[4]) : 4;
+
+	Frame frame;
+	makeFrame(frame, num_markers, num_rigidbodies, num_skeletons);
+
+	map<int, RigidBody> rigidbodies;
+	map<int, Skeleton> skeletons;
+	for (size_t i = 0; i < frame.rigidbodies.size(); i++) rigidbodies[frame.rigidbodies[i].id] = frame.rigidbodies[i];
+	for (size_t i = 0; i < frame.skeletons.size(); i++) skeletons[frame.skeletons[i].id] = frame.skeletons[i];
+
+	PoseBuffer buffer;
+	buffer.fill(frame);
+	checkLayout(buffer, frame);
+
+	buffer.clear();
+	buffer.fill(frame.frame_number, frame.markers, frame.filterd_markers, rigidbodies, skeletons);
+	checkLayout(buffer, frame);
+
+	if (failures) return 1;
+
+	size_t num_records = buffer.markers.size() + buffer.transforms.size();
+	size_t num_bytes = buffer.markers.size() * sizeof(MarkerInstance)
+		+ buffer.transforms.size() * sizeof(TransformInstance);
+
+	printf("%d markers, %d rigid bodies, %d skeletons: %d records, %d bytes\n",
+		   num_markers, num_rigidbodies, num_skeletons, (int)num_records, (int)num_bytes);
+
+	Nanos start = getTimeNanos();
+	for (int i = 0; i < iterations; i++) buffer.fill(frame);
+	Nanos frame_nanos = (getTimeNanos() - start) / (iterations > 0 ? iterations : 1);
+
+	start = getTimeNanos();
+	for (int i = 0; i < iterations; i++)
+		buffer.fill(frame.frame_number, frame.markers, frame.filterd_markers, rigidbodies, skeletons);
+	Nanos state_nanos = (getTimeNanos() - start) / (iterations > 0 ? iterations : 1);
+
+	printf("fill from frame: %.2f us (%.1f ns / record)\n", frame_nanos / 1000.0,
+		   (double)frame_nanos / num_records);
+	printf("fill from state: %.2f us (%.1f ns / record)\n", state_nanos / 1000.0,
+		   (double)state_nanos / num_records);
+	return 0;
+}
@@ -0,0 +1,118 @@
+// shared_memory_test: ofxNatNetSharedMemory writer to reader round trip
+//
+// usage: shared_memory_test
+//
+// writes frames into a small segment and reads them back in order, laps
+// the reader to check the overrun count, then restarts the writer: once
+// over a segment whose writer is still mapped (as after a crash), with a
+// smaller layout, and once after the name was unlinked behind a live
+// segment, which the reader only notices by the segment's identity.
+
+#include "ofxNatNetSharedMemory.h"
+#include "ofxNatNetSharedMemoryReader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "FAILED: %s\n", what);
+	failures++;
+}
+
+// frame payloads are opaque to the segment: a counter and a fill byte
+static bool writeFrame(ofxNatNetSharedMemory& memory, uint32_t n, size_t size)
+{
+	char data[256];
+	memset(data, (int)(n & 0xff), size);
+	memcpy(data, &n, sizeof(n));
+	return memory.write(data, size);
+}
+
+static bool readFrame(ofxNatNetSharedMemoryReader& reader, uint32_t& n)
+{
+	ofxNatNetCompactFrame frame;
+	if (!reader.read(frame) || frame.data.size() < sizeof(n)) return false;
+	memcpy(&n, frame.data.data(), sizeof(n));
+
+	for (size_t i = sizeof(n); i < frame.data.size(); i++)
+		if ((unsigned char)frame.data[i] != (n & 0xff)) return false;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	char name[64];
+	// unique per run, so parallel runs do not share a segment
+	long long stamp = chrono::steady_clock::now().time_since_epoch().count();
+	snprintf(name, sizeof(name), "natnet_test_%llx", stamp);
+
+	ofxNatNetSharedMemory writer;
+	check(writer.create(name, 4, 64), "segment created");
+
+	ofxNatNetSharedMemoryReader reader;
+	check(reader.open(name), "reader attached");
+
+	// in order
+	for (uint32_t i = 0; i < 3; i++) writeFrame(writer, i, 32);
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		uint32_t n = 0;
+		check(readFrame(reader, n) && n == i, "frames read in order");
+	}
+	uint32_t n = 0;
+	check(!readFrame(reader, n), "nothing past the head");
+	check(!writeFrame(writer, 99, 65), "oversized frame refused");
+
+	// lapped: 10 frames into 4 slots lose the oldest 6
+	for (uint32_t i = 3; i < 13; i++) writeFrame(writer, i, 48);
+	for (uint32_t i = 9; i < 13; i++) check(readFrame(reader, n) && n == i, "newest frames kept when lapped");
+	check(reader.getNumOverruns() == 6, "overruns counted");
+
+	// a second writer on the name, the first still mapped as after a
+	// crash: the old segment is retired, not shrunk under the reader
+	ofxNatNetSharedMemory restarted;
+	check(restarted.create(name, 2, 16), "writer restarted with a smaller layout");
+	check(!readFrame(reader, n), "nothing new after the restart");
+
+	for (uint32_t i = 100; i < 102; i++) writeFrame(restarted, i, 16);
+	check(readFrame(reader, n) && n == 100, "restarted segment read");
+	check(readFrame(reader, n) && n == 101, "restarted segment read in order");
+
+	// the old writer's writes go nowhere and its close() leaves the name
+	writeFrame(writer, 7, 32);
+	writer.close();
+	writeFrame(restarted, 102, 16);
+	check(readFrame(reader, n) && n == 102, "old writer's close keeps the new segment");
+
+#ifndef _WIN32
+	// the name unlinked behind a live, valid segment and created again:
+	// only the segment's identity tells the reader
+	shm_unlink(("/" + string(name)).c_str());
+
+	ofxNatNetSharedMemory replacement;
+	check(replacement.create(name, 4, 64), "segment recreated");
+	writeFrame(replacement, 200, 32);
+
+	this_thread::sleep_for(chrono::milliseconds(150));
+	check(!readFrame(reader, n), "reattached to the replacement");
+	writeFrame(replacement, 201, 32);
+	check(readFrame(reader, n) && n == 201, "replacement read");
+#endif
+
+	printf("%d overruns\n", (int)reader.getNumOverruns());
+	return failures ? 1 : 0;
+}
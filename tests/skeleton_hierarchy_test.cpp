@@ -0,0 +1,161 @@
+// skeleton_hierarchy_test: NatNet::Parser::buildSkeletonHierarchy
+//
+// usage: skeleton_hierarchy_test
+//
+// checks the joint order and parent indices for joints listed children
+// first, for parents that are not in the description, for a joint that
+// names itself as parent and for a parent cycle, whose joints are demoted
+// to roots. then solves a small chain to check that world matrices follow
+// the order.
+
+#include "natnet/Parser.h"
+
+#include <stdio.h>
+
+#include <vector>
+
+using namespace std;
+using namespace NatNet;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "FAILED: %s\n", what);
+	failures++;
+}
+
+static void addJoint(SkeletonDescription& desc, int id, int parent_id, const Vec3& offset = makeVec3(0, 0, 0))
+{
+	RigidBodyDescription joint;
+	joint.id = id;
+	joint.parent_id = parent_id;
+	joint.offset = offset;
+	desc.joints.push_back(joint);
+}
+
+// every joint appears once and after its parent
+static bool isOrdered(const SkeletonDescription& desc)
+{
+	int n = desc.joints.size();
+	if (desc.joint_order.size() != n) return false;
+
+	vector<int> position(n, -1);
+	for (int i = 0; i < n; i++)
+	{
+		int j = desc.joint_order[i];
+		if (j < 0 || j >= n || position[j] >= 0) return false;
+		position[j] = i;
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		int parent = desc.parent_indices[i];
+		if (parent >= 0 && position[parent] > position[i]) return false;
+	}
+	return true;
+}
+
+static void testChildrenFirst()
+{
+	// listed leaf first: 3 -> 2 -> 1 (root), and 4 -> 1
+	SkeletonDescription desc;
+	addJoint(desc, 3, 2);
+	addJoint(desc, 2, 1);
+	addJoint(desc, 4, 1);
+	addJoint(desc, 1, 0);  // 0 is no joint: root
+
+	Parser::buildSkeletonHierarchy(desc);
+
+	check(isOrdered(desc), "children first: parents precede children");
+	check(desc.parent_indices[0] == 1 && desc.parent_indices[1] == 3 && desc.parent_indices[2] == 3
+		  && desc.parent_indices[3] == -1, "children first: parent indices");
+	check(desc.joint_order.size() == 4 && desc.joint_order[0] == 3, "children first: root first");
+	check(desc.joint_index_by_id.size() == 5 && desc.joint_index_by_id[3] == 0 && desc.joint_index_by_id[0] == -1,
+		  "children first: index by id");
+}
+
+static void testMissingParents()
+{
+	// 2's parent 9 is not described, 5 names itself, 4 hangs off 2.
+	// skeleton ids in the upper 16 bits are ignored
+	SkeletonDescription desc;
+	addJoint(desc, (7 << 16) | 4, (7 << 16) | 2);
+	addJoint(desc, (7 << 16) | 2, (7 << 16) | 9);
+	addJoint(desc, 5, 5);
+
+	Parser::buildSkeletonHierarchy(desc);
+
+	check(isOrdered(desc), "missing parents: ordered");
+	check(desc.parent_indices[0] == 1, "missing parents: child of a root keeps its parent");
+	check(desc.parent_indices[1] == -1, "missing parent: root");
+	check(desc.parent_indices[2] == -1, "own parent: root");
+}
+
+static void testCycle()
+{
+	// 1 root -> 2; 3 -> 4 -> 5 -> 3 is a cycle with 6 hanging off 4
+	SkeletonDescription desc;
+	addJoint(desc, 1, 0);
+	addJoint(desc, 2, 1);
+	addJoint(desc, 3, 5);
+	addJoint(desc, 4, 3);
+	addJoint(desc, 5, 4);
+	addJoint(desc, 6, 4);
+
+	Parser::buildSkeletonHierarchy(desc);
+
+	check(isOrdered(desc), "cycle: every joint ordered once");
+
+	int roots = 0;
+	for (int i = 0; i < desc.joints.size(); i++) roots += desc.parent_indices[i] < 0;
+	check(roots == 2, "cycle: one cycle joint demoted to root");
+	check(desc.parent_indices[2] == -1, "cycle: first joint of the cycle demoted");
+	check(desc.parent_indices[3] == 2 && desc.parent_indices[4] == 3 && desc.parent_indices[5] == 3,
+		  "cycle: the rest keeps its parents");
+}
+
+static void testSolve()
+{
+	// chain 1 -> 2 -> 3 with unit offsets along y, listed leaf first
+	SkeletonDescription desc;
+	addJoint(desc, 3, 2, makeVec3(0, 1, 0));
+	addJoint(desc, 2, 1, makeVec3(0, 1, 0));
+	addJoint(desc, 1, 0, makeVec3(5, 0, 0));
+	Parser::buildSkeletonHierarchy(desc);
+
+	// streamed in local coordinates: positions relative to the parent
+	Skeleton S;
+	S.id = 1;
+	int ids[] = {1, 2, 3};
+	Vec3 positions[] = {makeVec3(5, 0, 0), makeVec3(0, 1, 0), makeVec3(0, 2, 0)};
+	for (int i = 0; i < 3; i++)
+	{
+		RigidBody joint;
+		joint.id = ids[i];
+		joint.raw_position = positions[i];
+		joint.raw_orientation = makeQuat(0, 0, 0, 1);
+		S.joints.push_back(joint);
+	}
+
+	Parser parser;
+	parser.solveSkeleton(S, desc);
+
+	check(S.world_matrices.size() == 3, "solve: a matrix per joint");
+	if (S.world_matrices.size() != 3) return;
+
+	// indexed like desc.joints
+	check(match(getTranslation(S.world_matrices[2]), makeVec3(5, 0, 0), 1e-5f), "solve: root");
+	check(match(getTranslation(S.world_matrices[1]), makeVec3(5, 1, 0), 1e-5f), "solve: child");
+	check(match(getTranslation(S.world_matrices[0]), makeVec3(5, 3, 0), 1e-5f), "solve: grandchild");
+}
+
+int main(int argc, char** argv)
+{
+	testChildrenFirst();
+	testMissingParents();
+	testCycle();
+	testSolve();
+	return failures ? 1 : 0;
+}
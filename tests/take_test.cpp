@@ -0,0 +1,336 @@
+// take_test: ofxNatNetTakeWriter to ofxNatNetTakeReader round trip
+//
+// usage: take_test
+//
+// records a synthetic take over several blocks, with markers changing in
+// number and rigid bodies and skeletons appearing and disappearing, and
+// reads it back: every value within the quantization step, seeks by frame
+// number and by time at the block edges, readRange() across a block edge,
+// and recovery of takes truncated before the footer and inside a block.
+
+#include "ofxNatNetTake.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef ofxNatNetCompactFrame CF;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+	if (ok) return;
+	fprintf(stderr, "FAILED: %s\n", what);
+	failures++;
+}
+
+static const float STEP = 0.0001f;
+static const int FRAMES_PER_BLOCK = 16;
+static const int NUM_FRAMES = 100;  // 6 full blocks and 4 frames
+static const int FIRST_FRAME = 1000;
+
+static double frameTime(int i) { return 10.0 + i / 120.0; }
+
+// deterministic across platforms, unlike rand()
+static unsigned int seed = 12345;
+
+static float randomFloat(float min, float max)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return min + (max - min) * ((seed >> 8) / 16777216.0f);
+}
+
+static CF::RigidBody makeRigidBody(int id, int i)
+{
+	CF::RigidBody RB;
+	RB.id = id;
+	RB.position[0] = randomFloat(-3, 3);
+	RB.position[1] = randomFloat(0, 2.5f);
+	RB.position[2] = randomFloat(-3, 3);
+
+	float q[4], length = 0;
+	for (int k = 0; k < 4; k++) q[k] = randomFloat(-1, 1), length += q[k] * q[k];
+	for (int k = 0; k < 4; k++) RB.orientation[k] = q[k] / sqrtf(length);
+
+	RB.mean_marker_error = randomFloat(0, 0.002f);
+	RB.flags = i % 3 ? CF::RIGIDBODY_ACTIVE : 0;
+	return RB;
+}
+
+// frame i of the take. rigid body k streams in runs of 7 + k frames with
+// every third run missing; skeleton 1 is gone for 8 frames out of 20
+static void makeFrame(int i, CF& frame)
+{
+	vector<CF::Marker> markers(3 + i % 5 + 2);
+	for (int k = 0; k < markers.size(); k++)
+	{
+		markers[k].x = randomFloat(-3, 3);
+		markers[k].y = randomFloat(0, 2.5f);
+		markers[k].z = randomFloat(-3, 3);
+	}
+
+	vector<CF::RigidBody> rigidbodies;
+	for (int k = 1; k <= 4; k++)
+		if ((i / (7 + k)) % 3 != 2) rigidbodies.push_back(makeRigidBody(k, i));
+
+	vector<CF::Skeleton> skeletons;
+	vector<CF::RigidBody> joints;
+	for (int s = 1; s <= 2; s++)
+	{
+		if (s == 1 && i % 20 >= 12) continue;
+
+		CF::Skeleton S;
+		S.id = s;
+		S.first_joint = joints.size();
+		S.num_joints = 3;
+		for (int j = 0; j < 3; j++) joints.push_back(makeRigidBody(j + 1, i));
+		skeletons.push_back(S);
+	}
+
+	// the last two markers go to one marker set
+	CF::Header h;
+	memset(&h, 0, sizeof(h));
+	h.magic = CF::MAGIC;
+	h.version = CF::VERSION;
+	h.header_size = sizeof(CF::Header);
+	h.frame_number = FIRST_FRAME + i;
+	h.timestamp = frameTime(i);
+	h.latency = 0.004f + i * 1e-5f;
+	h.timecode = i * 3;
+	h.timecode_sub = i % 2;
+	h.flags = i % 4 == 0 ? CF::FRAME_TRACKING_CHANGED : 0;
+	h.num_markers = markers.size() - 2;
+	h.num_filterd_markers = 0;
+	h.num_markerset_markers = 2;
+	h.num_markersets = 1;
+	h.num_rigidbodies = rigidbodies.size();
+	h.num_skeletons = skeletons.size();
+	h.num_joints = joints.size();
+	h.size = CF::computeSize(markers.size(), 1, rigidbodies.size(), skeletons.size(), joints.size());
+
+	CF::MarkerSet set;
+	set.first_marker = 0;
+	set.num_markers = 2;
+
+	frame.data.resize(h.size);
+	char* ptr = frame.data.data();
+	memcpy(ptr, &h, sizeof(h));
+	ptr += sizeof(h);
+	memcpy(ptr, markers.data(), markers.size() * sizeof(CF::Marker));
+	ptr += markers.size() * sizeof(CF::Marker);
+	memcpy(ptr, &set, sizeof(set));
+	ptr += sizeof(set);
+	if (rigidbodies.size()) memcpy(ptr, rigidbodies.data(), rigidbodies.size() * sizeof(CF::RigidBody));
+	ptr += rigidbodies.size() * sizeof(CF::RigidBody);
+	memcpy(ptr, skeletons.data(), skeletons.size() * sizeof(CF::Skeleton));
+	ptr += skeletons.size() * sizeof(CF::Skeleton);
+	memcpy(ptr, joints.data(), joints.size() * sizeof(CF::RigidBody));
+}
+
+static bool within(float a, float b, float tolerance) { return fabsf(a - b) <= tolerance; }
+
+static bool samePose(const CF::RigidBody& a, const CF::RigidBody& b)
+{
+	// rounded to the nearest step, plus float error
+	const float p = STEP / 2 + 1e-6f;
+	const float q = 0.5f / 32767 + 1e-6f;
+
+	bool same = a.id == b.id && a.flags == b.flags && within(a.mean_marker_error, b.mean_marker_error, p);
+	for (int k = 0; k < 3; k++) same = same && within(a.position[k], b.position[k], p);
+	for (int k = 0; k < 4; k++) same = same && within(a.orientation[k], b.orientation[k], q);
+	return same;
+}
+
+static bool sameFrame(const CF& a, const CF& b)
+{
+	if (!a.isValid() || !b.isValid()) return false;
+
+	const CF::Header& ha = a.getHeader();
+	const CF::Header& hb = b.getHeader();
+
+	if (ha.frame_number != hb.frame_number || fabs(ha.timestamp - hb.timestamp) > 1e-6
+		|| ha.latency != hb.latency || ha.timecode != hb.timecode || ha.timecode_sub != hb.timecode_sub
+		|| ha.flags != hb.flags || ha.size != hb.size || ha.num_markers != hb.num_markers
+		|| ha.num_markerset_markers != hb.num_markerset_markers || ha.num_markersets != hb.num_markersets
+		|| ha.num_rigidbodies != hb.num_rigidbodies || ha.num_skeletons != hb.num_skeletons
+		|| ha.num_joints != hb.num_joints)
+		return false;
+
+	const float p = STEP / 2 + 1e-6f;
+	int num_markers = ha.num_markers + ha.num_filterd_markers + ha.num_markerset_markers;
+	for (int i = 0; i < num_markers; i++)
+	{
+		const CF::Marker& ma = a.getMarkers()[i];
+		const CF::Marker& mb = b.getMarkers()[i];
+		if (!within(ma.x, mb.x, p) || !within(ma.y, mb.y, p) || !within(ma.z, mb.z, p)) return false;
+	}
+
+	for (int i = 0; i < ha.num_markersets; i++)
+		if (a.getMarkerSets()[i].first_marker != b.getMarkerSets()[i].first_marker
+			|| a.getMarkerSets()[i].num_markers != b.getMarkerSets()[i].num_markers)
+			return false;
+
+	for (int i = 0; i < ha.num_rigidbodies; i++)
+		if (!samePose(a.getRigidBodies()[i], b.getRigidBodies()[i])) return false;
+
+	for (int i = 0; i < ha.num_skeletons; i++)
+		if (a.getSkeletons()[i].id != b.getSkeletons()[i].id
+			|| a.getSkeletons()[i].first_joint != b.getSkeletons()[i].first_joint
+			|| a.getSkeletons()[i].num_joints != b.getSkeletons()[i].num_joints)
+			return false;
+
+	for (int i = 0; i < ha.num_joints; i++)
+		if (!samePose(a.getJoints()[i], b.getJoints()[i])) return false;
+
+	return true;
+}
+
+// reads on from the reader's position, expecting frames[first ...]
+static int readFrom(ofxNatNetTakeReader& reader, const vector<CF>& frames, int first)
+{
+	CF frame;
+	int i = first;
+	while (reader.read(frame))
+	{
+		if (i >= frames.size() || !sameFrame(frame, frames[i])) return -1;
+		i++;
+	}
+	return i - first;
+}
+
+static void testSeek(ofxNatNetTakeReader& reader, const vector<CF>& frames)
+{
+	CF frame;
+
+	// each block's first frame, the frame before it and the one after
+	for (int b = 0; b * FRAMES_PER_BLOCK < NUM_FRAMES; b++)
+	{
+		int edge = b * FRAMES_PER_BLOCK;
+		for (int i = edge - 1; i <= edge + 1; i++)
+		{
+			if (i < 0 || i >= NUM_FRAMES) continue;
+
+			check(reader.seekToFrameNumber(FIRST_FRAME + i) && reader.read(frame) && sameFrame(frame, frames[i]),
+				  "seek by frame number at a block edge");
+			check(reader.seekToTime(frameTime(i)) && reader.read(frame) && sameFrame(frame, frames[i]),
+				  "seek by time at a block edge");
+
+			// between two frames: the later one
+			check(reader.seekToTime(frameTime(i) - 0.5 / 120) && reader.read(frame)
+				  && sameFrame(frame, frames[i]), "seek by time between frames");
+		}
+	}
+
+	// reading goes on across blocks after a seek
+	check(reader.seekToFrameNumber(FIRST_FRAME + FRAMES_PER_BLOCK - 1)
+		  && readFrom(reader, frames, FRAMES_PER_BLOCK - 1) == NUM_FRAMES - FRAMES_PER_BLOCK + 1,
+		  "read on after a seek");
+
+	check(reader.seekToFrameNumber(0) && reader.read(frame) && sameFrame(frame, frames[0]), "seek before the take");
+	check(!reader.seekToFrameNumber(FIRST_FRAME + NUM_FRAMES), "seek past the last frame number");
+	check(!reader.seekToTime(frameTime(NUM_FRAMES)), "seek past the end time");
+
+	// a range across the first block edge, then the frame after it
+	vector<CF> range;
+	int first = FRAMES_PER_BLOCK - 3, last = FRAMES_PER_BLOCK + 2;
+	size_t n = reader.readRange(frameTime(first), frameTime(last), range);
+	bool same = n == last - first + 1;
+	for (int i = 0; same && i < n; i++) same = sameFrame(range[i], frames[first + i]);
+	check(same, "readRange across a block edge");
+	check(reader.read(frame) && sameFrame(frame, frames[last + 1]), "read after readRange");
+}
+
+static bool readFile(const string& path, vector<char>& data)
+{
+	FILE* fp = fopen(path.c_str(), "rb");
+	if (fp == NULL) return false;
+	fseek(fp, 0, SEEK_END);
+	data.resize(ftell(fp));
+	fseek(fp, 0, SEEK_SET);
+	bool ok = data.empty() || fread(data.data(), data.size(), 1, fp) == 1;
+	fclose(fp);
+	return ok;
+}
+
+static bool writeFile(const string& path, const vector<char>& data, size_t size)
+{
+	FILE* fp = fopen(path.c_str(), "wb");
+	if (fp == NULL) return false;
+	bool ok = size == 0 || fwrite(data.data(), size, 1, fp) == 1;
+	fclose(fp);
+	return ok;
+}
+
+static void testTruncated(const string& path, const string& truncated_path, const vector<CF>& frames)
+{
+	vector<char> data;
+	check(readFile(path, data), "take read back");
+
+	ofxNatNetTake::Footer footer;
+	memcpy(&footer, &data[data.size() - sizeof(footer)], sizeof(footer));
+	check(footer.magic == ofxNatNetTake::INDEX_MAGIC && footer.num_blocks == 7, "footer written");
+
+	ofxNatNetTakeReader reader;
+
+	// recording interrupted before the index: every block recovered
+	check(writeFile(truncated_path, data, footer.index_offset) && reader.open(truncated_path),
+		  "opened without a footer");
+	check(reader.getNumBlocks() == 7 && reader.getNumFrames() == NUM_FRAMES, "blocks recovered");
+	check(readFrom(reader, frames, 0) == NUM_FRAMES, "frames recovered");
+	check(reader.seekToTime(frameTime(FRAMES_PER_BLOCK * 3)) && readFrom(reader, frames, FRAMES_PER_BLOCK * 3)
+		  == NUM_FRAMES - FRAMES_PER_BLOCK * 3, "seek in a recovered take");
+
+	// and inside the last block: the complete blocks are kept
+	check(writeFile(truncated_path, data, footer.index_offset - 5) && reader.open(truncated_path),
+		  "opened with a partial block");
+	check(reader.getNumBlocks() == 6 && reader.getLastFrameNumber() == FIRST_FRAME + 6 * FRAMES_PER_BLOCK - 1,
+		  "partial block dropped");
+	check(readFrom(reader, frames, 0) == 6 * FRAMES_PER_BLOCK, "complete blocks recovered");
+
+	// or the footer only partly written
+	check(writeFile(truncated_path, data, data.size() - 3) && reader.open(truncated_path)
+		  && reader.getNumFrames() == NUM_FRAMES, "partial footer ignored");
+
+	reader.close();
+}
+
+int main(int argc, char** argv)
+{
+	// unique per run, so parallel runs do not share a file
+	char stamp[32];
+	snprintf(stamp, sizeof(stamp), "%llx", (long long)chrono::steady_clock::now().time_since_epoch().count());
+	string path = string("take_test_") + stamp + ".nntk";
+	string truncated_path = string("take_test_") + stamp + "_truncated.nntk";
+
+	vector<CF> frames(NUM_FRAMES);
+	for (int i = 0; i < NUM_FRAMES; i++) makeFrame(i, frames[i]);
+
+	ofxNatNetTakeWriter writer;
+	check(writer.open(path, STEP, FRAMES_PER_BLOCK), "take opened for writing");
+	for (int i = 0; i < NUM_FRAMES; i++) check(writer.write(frames[i]), "frame written");
+	writer.close();
+
+	ofxNatNetTakeReader reader;
+	check(reader.open(path), "take opened for reading");
+	check(reader.getNumBlocks() == 7 && reader.getNumFrames() == NUM_FRAMES, "block and frame counts");
+	check(reader.getFirstFrameNumber() == FIRST_FRAME && reader.getLastFrameNumber() == FIRST_FRAME + NUM_FRAMES - 1,
+		  "frame number range");
+	check(reader.getStartTime() == frameTime(0) && reader.getEndTime() == frameTime(NUM_FRAMES - 1), "time range");
+
+	check(readFrom(reader, frames, 0) == NUM_FRAMES, "every frame read back within the step");
+	testSeek(reader, frames);
+	reader.close();
+
+	testTruncated(path, truncated_path, frames);
+
+	remove(path.c_str());
+	remove(truncated_path.c_str());
+	return failures ? 1 : 0;
+}